@@ -0,0 +1,91 @@
+//——————————————————————————————————————————————————————————————————————————————
+//  ACAN2517 chip select benchmark, in internal loopback mode
+//  Compares digitalWrite and direct port register chip select (mUseFastChipSelect)
+//  for a register access and a full frame (send + isr + receive).
+//  Run it on an AVR (Arduino Uno, Mega) and on an ARM (Arduino Zero, Teensy 3.x) board;
+//  extras/host/ChipSelectBenchmark.cpp is a host variant, with a simulated controller.
+//——————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517.h>
+
+//——————————————————————————————————————————————————————————————————————————————
+//  MCP2517 connections: adapt theses settings to your design
+//  This sketch uses the default SPI
+//  CS input of MCP2517 should be connected to a digital output port
+//  INT output of MCP2517 should be connected to a digital input port, with interrupt capability
+//——————————————————————————————————————————————————————————————————————————————
+
+static const byte MCP2517_CS  = 10 ; // CS input of MCP2517
+static const byte MCP2517_INT =  3 ; // INT output of MCP2517
+
+//——————————————————————————————————————————————————————————————————————————————
+//  MCP2517 Driver object
+//——————————————————————————————————————————————————————————————————————————————
+
+ACAN2517 can (MCP2517_CS, SPI, MCP2517_INT) ;
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static const uint32_t ITERATIONS = 1000 ;
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static void printCycles (const char * inTitle, const uint32_t inDurationMicros) {
+  const uint32_t cyclesPerMicro = F_CPU / 1000000UL ;
+  Serial.print (inTitle) ;
+  Serial.print (inDurationMicros * cyclesPerMicro / ITERATIONS) ;
+  Serial.println (" cycles") ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static void runBenchmark (const bool inFastChipSelect) {
+  ACAN2517Settings settings (ACAN2517Settings::OSC_4MHz10xPLL, 1000 * 1000) ; // CAN bit rate 1 Mb/s
+  settings.mRequestedMode = ACAN2517Settings::InternalLoopBack ;
+  settings.mUseFastChipSelect = inFastChipSelect ;
+  const uint32_t errorCode = can.begin (settings, [] { can.isr () ; }) ;
+  if (errorCode != 0) {
+    Serial.print ("Configuration error 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }else{
+    Serial.println (inFastChipSelect ? "Fast chip select" : "digitalWrite chip select") ;
+  //--- Register access
+    uint32_t start = micros () ;
+    for (uint32_t i=0 ; i<ITERATIONS ; i++) {
+      can.readErrorCounters () ;
+    }
+    printCycles ("  Register read: ", micros () - start) ;
+  //--- Frame: tryToSend, isr, receive
+    CANMessage frame ;
+    frame.len = 8 ;
+    start = micros () ;
+    for (uint32_t i=0 ; i<ITERATIONS ; i++) {
+      frame.id = i & 0x7FF ;
+      while (!can.tryToSend (frame)) {}
+      while (!can.receive (frame)) {}
+    }
+    printCycles ("  Frame round trip (includes bus time): ", micros () - start) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+//   SETUP
+//——————————————————————————————————————————————————————————————————————————————
+
+void setup () {
+//--- Start serial
+  Serial.begin (38400) ;
+  while (!Serial) {}
+//--- Begin SPI
+  SPI.begin () ;
+//--- Run benchmarks
+  runBenchmark (false) ;
+  runBenchmark (true) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+void loop () {
+}
+
+//——————————————————————————————————————————————————————————————————————————————
@@ -0,0 +1,215 @@
+//——————————————————————————————————————————————————————————————————————————————
+//  ACAN2517 latency benchmark, in internal loopback mode
+//  Every frame is dated when it is submitted (tryToSend), when it is written
+//  in the controller transmit FIFO and when it is read from the controller
+//  receive FIFO (frame trace call back), and when the application gets it
+//  (receive). For every buffer configuration, latency histograms (p50, p99,
+//  max) are printed for:
+//    - transmit path: submit -> written in controller;
+//    - bus and controller: written in controller -> read by receive isr;
+//    - receive path: read by receive isr -> receive;
+//    - end to end: submit -> receive.
+//  Set MODE to ExternalLoopBack to include the transceiver.
+//——————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517.h>
+#include "LatencyHistogram.h"
+
+//——————————————————————————————————————————————————————————————————————————————
+//  MCP2517 connections: adapt theses settings to your design
+//  This sketch uses the default SPI
+//  CS input of MCP2517 should be connected to a digital output port
+//  INT output of MCP2517 should be connected to a digital input port, with interrupt capability
+//——————————————————————————————————————————————————————————————————————————————
+
+static const byte MCP2517_CS  = 10 ; // CS input of MCP2517
+static const byte MCP2517_INT =  3 ; // INT output of MCP2517
+
+//——————————————————————————————————————————————————————————————————————————————
+//  MCP2517 Driver object
+//——————————————————————————————————————————————————————————————————————————————
+
+ACAN2517 can (MCP2517_CS, SPI, MCP2517_INT) ;
+
+//——————————————————————————————————————————————————————————————————————————————
+//  Traffic pattern: bursts of BURST_LENGTH frames, every BURST_PERIOD µs
+//——————————————————————————————————————————————————————————————————————————————
+
+static const ACAN2517Settings::RequestedMode MODE = ACAN2517Settings::InternalLoopBack ;
+static const uint32_t BIT_RATE = 1000 * 1000 ;
+static const uint32_t FRAME_COUNT = 2000 ; // For every configuration
+static const uint8_t BURST_LENGTH = 8 ;
+static const uint32_t BURST_PERIOD = 2000 ; // µs
+static const uint8_t FRAME_LENGTH = 8 ; // 2 ... 8 (sequence number is in the first two bytes)
+static const bool EXTENDED_FRAMES = false ;
+
+//——————————————————————————————————————————————————————————————————————————————
+//  Buffer configurations
+//——————————————————————————————————————————————————————————————————————————————
+
+class Configuration {
+  public: uint16_t mDriverTransmitFIFOSize ;
+  public: uint8_t mControllerTransmitFIFOSize ;
+  public: uint16_t mDriverReceiveFIFOSize ;
+  public: uint8_t mControllerReceiveFIFOSize ;
+} ;
+
+static const Configuration CONFIGURATIONS [] = {
+  {16, 32, 32, 32}, // Default settings
+  {32,  2, 32,  2},
+  { 0, 16,  8, 16},
+  {32,  1,  1,  1}
+} ;
+
+static const uint8_t CONFIGURATION_COUNT = sizeof (CONFIGURATIONS) / sizeof (CONFIGURATIONS [0]) ;
+
+//——————————————————————————————————————————————————————————————————————————————
+//  Frame dates, indexed by sequence number; at most IN_FLIGHT frames are pending
+//——————————————————————————————————————————————————————————————————————————————
+
+static const uint16_t IN_FLIGHT = 64 ; // Power of 2
+
+class FrameDates {
+  public: uint32_t mSubmit ;
+  public: uint32_t mController ;
+  public: uint32_t mReceiveISR ;
+} ;
+
+static FrameDates gDates [IN_FLIGHT] ;
+
+static LatencyHistogram gTransmitPath ;
+static LatencyHistogram gBusAndController ;
+static LatencyHistogram gReceivePath ;
+static LatencyHistogram gEndToEnd ;
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static uint16_t sequenceNumber (const CANMessage & inFrame) {
+  return (uint16_t) (inFrame.data [0] | (inFrame.data [1] << 8)) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static void frameTrace (const CANMessage & inFrame, const ACAN2517::FrameTracePoint inTracePoint) {
+  const uint32_t now = micros () ;
+  FrameDates & dates = gDates [sequenceNumber (inFrame) % IN_FLIGHT] ;
+  if (inTracePoint == ACAN2517::FrameWrittenInController) {
+    dates.mController = now ;
+  }else{
+    dates.mReceiveISR = now ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static void printHistogram (const char * inTitle, const LatencyHistogram & inHistogram) {
+  Serial.print (inTitle) ;
+  Serial.print (" p50 ") ;
+  Serial.print (inHistogram.percentile (500)) ;
+  Serial.print (" us, p99 ") ;
+  Serial.print (inHistogram.percentile (990)) ;
+  Serial.print (" us, max ") ;
+  Serial.print (inHistogram.max ()) ;
+  Serial.println (" us") ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static void runConfiguration (const Configuration & inConfiguration) {
+  ACAN2517Settings settings (ACAN2517Settings::OSC_4MHz10xPLL, BIT_RATE) ;
+  settings.mRequestedMode = MODE ;
+  settings.mDriverTransmitFIFOSize = inConfiguration.mDriverTransmitFIFOSize ;
+  settings.mControllerTransmitFIFOSize = inConfiguration.mControllerTransmitFIFOSize ;
+  settings.mDriverReceiveFIFOSize = inConfiguration.mDriverReceiveFIFOSize ;
+  settings.mControllerReceiveFIFOSize = inConfiguration.mControllerReceiveFIFOSize ;
+  const uint32_t errorCode = can.begin (settings, [] { can.isr () ; }) ;
+  Serial.print ("Driver TX ") ;
+  Serial.print (inConfiguration.mDriverTransmitFIFOSize) ;
+  Serial.print (", controller TX ") ;
+  Serial.print (inConfiguration.mControllerTransmitFIFOSize) ;
+  Serial.print (", driver RX ") ;
+  Serial.print (inConfiguration.mDriverReceiveFIFOSize) ;
+  Serial.print (", controller RX ") ;
+  Serial.println (inConfiguration.mControllerReceiveFIFOSize) ;
+  if (errorCode != 0) {
+    Serial.print ("  Configuration error 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }else{
+    can.setFrameTraceCallBack (frameTrace) ;
+    gTransmitPath.clear () ;
+    gBusAndController.clear () ;
+    gReceivePath.clear () ;
+    gEndToEnd.clear () ;
+    CANMessage frame ;
+    frame.ext = EXTENDED_FRAMES ;
+    frame.len = FRAME_LENGTH ;
+    uint32_t sent = 0 ;
+    uint32_t received = 0 ;
+    uint8_t burstRemaining = 0 ;
+    uint32_t nextBurstDate = micros () ;
+    uint32_t lastActivityDate = millis () ;
+    while ((received < FRAME_COUNT) && ((millis () - lastActivityDate) < 1000)) {
+    //--- Submit
+      if ((burstRemaining == 0) && (sent < FRAME_COUNT) && (((int32_t) (micros () - nextBurstDate)) >= 0)) {
+        burstRemaining = BURST_LENGTH ;
+        nextBurstDate += BURST_PERIOD ;
+      }
+      if ((burstRemaining > 0) && (sent < FRAME_COUNT) && ((sent - received) < IN_FLIGHT)) {
+        frame.id = sent & 0x7FF ;
+        frame.data [0] = (uint8_t) sent ;
+        frame.data [1] = (uint8_t) (sent >> 8) ;
+        gDates [sent % IN_FLIGHT].mSubmit = micros () ;
+        if (can.tryToSend (frame)) {
+          sent += 1 ;
+          burstRemaining -= 1 ;
+        }
+      }
+    //--- Receive
+      CANMessage receivedFrame ;
+      if (can.receive (receivedFrame)) {
+        const uint32_t now = micros () ;
+        noInterrupts () ;
+          const FrameDates dates = gDates [sequenceNumber (receivedFrame) % IN_FLIGHT] ;
+        interrupts () ;
+        gTransmitPath.record (dates.mController - dates.mSubmit) ;
+        gBusAndController.record (dates.mReceiveISR - dates.mController) ;
+        gReceivePath.record (now - dates.mReceiveISR) ;
+        gEndToEnd.record (now - dates.mSubmit) ;
+        received += 1 ;
+        lastActivityDate = millis () ;
+      }
+    }
+    can.setFrameTraceCallBack (NULL) ;
+    Serial.print ("  Sent ") ;
+    Serial.print (sent) ;
+    Serial.print (", received ") ;
+    Serial.println (received) ;
+    printHistogram ("  Transmit path:     ", gTransmitPath) ;
+    printHistogram ("  Bus and controller:", gBusAndController) ;
+    printHistogram ("  Receive path:      ", gReceivePath) ;
+    printHistogram ("  End to end:        ", gEndToEnd) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+//   SETUP
+//——————————————————————————————————————————————————————————————————————————————
+
+void setup () {
+//--- Start serial
+  Serial.begin (38400) ;
+  while (!Serial) {}
+//--- Begin SPI
+  SPI.begin () ;
+//--- Run benchmarks
+  for (uint8_t i=0 ; i<CONFIGURATION_COUNT ; i++) {
+    runConfiguration (CONFIGURATIONS [i]) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+void loop () {
+}
+
+//——————————————————————————————————————————————————————————————————————————————
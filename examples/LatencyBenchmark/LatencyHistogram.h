@@ -0,0 +1,83 @@
+//——————————————————————————————————————————————————————————————————————————————
+//  Latency histogram, in µs
+//  Buckets are exact below 16 µs, then 8 buckets per power of 2 (12.5% width);
+//  values >= 65536 µs go to the last bucket. Percentiles return the bucket
+//  upper bound, max is exact.
+//——————————————————————————————————————————————————————————————————————————————
+
+#pragma once
+
+//——————————————————————————————————————————————————————————————————————————————
+
+#include <Arduino.h>
+
+//——————————————————————————————————————————————————————————————————————————————
+
+class LatencyHistogram {
+  public: static const uint16_t BUCKET_COUNT = 16 + 12 * 8 ;
+
+  public: void clear (void) {
+    for (uint16_t i=0 ; i<BUCKET_COUNT ; i++) {
+      mBuckets [i] = 0 ;
+    }
+    mCount = 0 ;
+    mMax = 0 ;
+  }
+
+  public: void record (const uint32_t inValue) {
+    mBuckets [bucketIndex (inValue)] += 1 ;
+    mCount += 1 ;
+    if (mMax < inValue) {
+      mMax = inValue ;
+    }
+  }
+
+  public: uint32_t count (void) const { return mCount ; }
+
+  public: uint32_t max (void) const { return mMax ; }
+
+//--- inPerMille: 500 for p50, 990 for p99
+  public: uint32_t percentile (const uint16_t inPerMille) const {
+    const uint32_t rank = (uint32_t) (((uint64_t) mCount * inPerMille + 999) / 1000) ;
+    uint32_t cumulated = 0 ;
+    uint16_t idx = 0 ;
+    while ((idx < (BUCKET_COUNT - 1)) && ((cumulated + mBuckets [idx]) < rank)) {
+      cumulated += mBuckets [idx] ;
+      idx += 1 ;
+    }
+    const uint32_t upperBound = bucketUpperBound (idx) ;
+    return (upperBound < mMax) ? upperBound : mMax ;
+  }
+
+  private: static uint16_t bucketIndex (const uint32_t inValue) {
+    uint16_t result = BUCKET_COUNT - 1 ;
+    if (inValue < 16) {
+      result = (uint16_t) inValue ;
+    }else if (inValue < 65536) {
+      uint8_t shift = 1 ;
+      while ((inValue >> shift) >= 16) {
+        shift += 1 ;
+      }
+      result = (uint16_t) (16 + (shift - 1) * 8 + ((inValue >> shift) - 8)) ;
+    }
+    return result ;
+  }
+
+  private: static uint32_t bucketUpperBound (const uint16_t inIndex) {
+    uint32_t result = UINT32_MAX ;
+    if (inIndex < 16) {
+      result = inIndex ;
+    }else if (inIndex < (BUCKET_COUNT - 1)) {
+      const uint8_t shift = (uint8_t) ((inIndex - 16) / 8 + 1) ;
+      const uint32_t mantissa = 8 + (inIndex - 16) % 8 ;
+      result = ((mantissa + 1) << shift) - 1 ;
+    }
+    return result ;
+  }
+
+  private: uint16_t mBuckets [BUCKET_COUNT] ;
+  private: uint32_t mCount = 0 ;
+  private: uint32_t mMax = 0 ;
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————
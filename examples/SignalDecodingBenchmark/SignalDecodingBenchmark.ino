@@ -0,0 +1,91 @@
+//——————————————————————————————————————————————————————————————————————————————
+//  ACANSignal benchmark (no MCP2517FD needed)
+//  Compares a bit by bit signal decoder, as often written by hand, with
+//  ACANSignal compile time descriptors, for an Intel and a Motorola signal.
+//——————————————————————————————————————————————————————————————————————————————
+
+#include <ACANSignal.h>
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static const uint32_t ITERATIONS = 10000 ;
+
+typedef ACANSignal <24, 16, kIntel, false> EngineSpeed ;  // DBC: 24|16@1+
+typedef ACANSignal <13, 12, kMotorola, true> Temperature ; // DBC: 13|12@0-
+
+//——————————————————————————————————————————————————————————————————————————————
+//  Bit by bit decoder
+//——————————————————————————————————————————————————————————————————————————————
+
+static uint32_t naiveDecode (const CANMessage & inFrame,
+                             const uint8_t inStartBit,
+                             const uint8_t inLength,
+                             const bool inIntel) {
+  uint32_t result = 0 ;
+  uint8_t bit = inStartBit ;
+  for (uint8_t i=0 ; i<inLength ; i++) {
+    const uint32_t bitValue = (inFrame.data [bit / 8] >> (bit % 8)) & 1 ;
+    if (inIntel) {
+      result |= bitValue << i ;
+      bit += 1 ;
+    }else{
+      result = (result << 1) | bitValue ;
+      bit = ((bit % 8) == 0) ? (bit + 15) : (bit - 1) ;
+    }
+  }
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static void printCycles (const char * inTitle, const uint32_t inDurationMicros) {
+  const uint32_t cyclesPerMicro = F_CPU / 1000000UL ;
+  Serial.print (inTitle) ;
+  Serial.print (inDurationMicros * cyclesPerMicro / ITERATIONS) ;
+  Serial.println (" cycles") ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+//   SETUP
+//——————————————————————————————————————————————————————————————————————————————
+
+void setup () {
+//--- Start serial
+  Serial.begin (38400) ;
+  while (!Serial) {}
+//--- Frame
+  CANMessage frame ;
+  frame.len = 8 ;
+  EngineSpeed::setRawValue (frame, 12000) ;
+  Temperature::setRawValue (frame, -321) ;
+//--- Check both decoders agree
+  const uint32_t naiveTemperature = naiveDecode (frame, 13, 12, false) ;
+  const int32_t signedNaiveTemperature = ((int32_t) (naiveTemperature << 20)) >> 20 ;
+  if ((naiveDecode (frame, 24, 16, true) != EngineSpeed::rawValue (frame))
+   || (signedNaiveTemperature != Temperature::rawValue (frame))) {
+    Serial.println ("Decoders disagree") ;
+  }
+//--- Bit by bit
+  volatile uint32_t sink = 0 ;
+  uint32_t start = micros () ;
+  for (uint32_t i=0 ; i<ITERATIONS ; i++) {
+    frame.data [7] = (uint8_t) i ;
+    sink = naiveDecode (frame, 24, 16, true) + naiveDecode (frame, 13, 12, false) ;
+  }
+  printCycles ("Bit by bit: ", micros () - start) ;
+//--- ACANSignal
+  start = micros () ;
+  for (uint32_t i=0 ; i<ITERATIONS ; i++) {
+    frame.data [7] = (uint8_t) i ;
+    sink = EngineSpeed::rawValue (frame) + (uint32_t) Temperature::rawValue (frame) ;
+  }
+  printCycles ("ACANSignal: ", micros () - start) ;
+  (void) sink ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+void loop () {
+}
+
+//——————————————————————————————————————————————————————————————————————————————
@@ -0,0 +1,190 @@
+//——————————————————————————————————————————————————————————————————————————————
+//  ACAN2517 saturation throughput benchmark, in internal loopback mode
+//  For every combination of bit rate, frame length, frame format, SPI clock
+//  and buffer configuration, the sketch sends as many frames as the driver
+//  accepts during RUN_DURATION ms, and prints one CSV line:
+//    - frames_per_s: received frames per second;
+//    - nominal_frames_per_s: bus limit, without bit stuffing;
+//    - isr_per_mille: time spent in isr, in per-mille of run duration;
+//    - dropped: sent - received;
+//    - peak_drv_tx, peak_drv_rx: driver buffers peak occupancy.
+//  Lines can be diffed between library versions.
+//——————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517.h>
+
+//——————————————————————————————————————————————————————————————————————————————
+//  MCP2517 connections: adapt theses settings to your design
+//  This sketch uses the default SPI
+//  CS input of MCP2517 should be connected to a digital output port
+//  INT output of MCP2517 should be connected to a digital input port, with interrupt capability
+//——————————————————————————————————————————————————————————————————————————————
+
+static const byte MCP2517_CS  = 10 ; // CS input of MCP2517
+static const byte MCP2517_INT =  3 ; // INT output of MCP2517
+
+//——————————————————————————————————————————————————————————————————————————————
+//  MCP2517 Driver object
+//——————————————————————————————————————————————————————————————————————————————
+
+ACAN2517 can (MCP2517_CS, SPI, MCP2517_INT) ;
+
+//——————————————————————————————————————————————————————————————————————————————
+//  Benchmark matrix
+//——————————————————————————————————————————————————————————————————————————————
+
+static const uint32_t RUN_DURATION = 500 ; // ms, for every combination
+
+static const uint32_t BIT_RATES [] = {125 * 1000, 250 * 1000, 500 * 1000, 1000 * 1000} ;
+static const uint8_t FRAME_LENGTHS [] = {0, 4, 8} ;
+static const uint32_t SPI_CLOCKS [] = {0, 4 * 1000 * 1000} ; // 0: SYSCLK / 2
+
+class BufferConfiguration {
+  public: uint16_t mDriverTransmitFIFOSize ;
+  public: uint8_t mControllerTransmitFIFOSize ;
+  public: uint16_t mDriverReceiveFIFOSize ;
+  public: uint8_t mControllerReceiveFIFOSize ;
+} ;
+
+static const BufferConfiguration BUFFER_CONFIGURATIONS [] = {
+  {16, 32, 32, 32}, // Default settings
+  {32,  4, 64,  4}
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————
+
+#define ARRAY_COUNT(a) (sizeof (a) / sizeof ((a) [0]))
+
+//——————————————————————————————————————————————————————————————————————————————
+//  Time spent in isr
+//——————————————————————————————————————————————————————————————————————————————
+
+static volatile uint32_t gISRDuration ;
+
+static void canISR (void) {
+  const uint32_t start = micros () ;
+  can.isr () ;
+  gISRDuration += micros () - start ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+//  Nominal frame duration, in bits (3 bit interframe space, no bit stuffing)
+//——————————————————————————————————————————————————————————————————————————————
+
+static uint32_t frameBitCount (const uint8_t inLength, const bool inExtended) {
+  return (inExtended ? 67 : 47) + 8 * inLength ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+static void runBenchmark (const uint32_t inBitRate,
+                          const uint8_t inLength,
+                          const bool inExtended,
+                          const uint32_t inSPIClock,
+                          const BufferConfiguration & inConfiguration) {
+  ACAN2517Settings settings (ACAN2517Settings::OSC_4MHz10xPLL, inBitRate) ;
+  settings.mRequestedMode = ACAN2517Settings::InternalLoopBack ;
+  settings.mSPIClock = inSPIClock ;
+  settings.mDriverTransmitFIFOSize = inConfiguration.mDriverTransmitFIFOSize ;
+  settings.mControllerTransmitFIFOSize = inConfiguration.mControllerTransmitFIFOSize ;
+  settings.mDriverReceiveFIFOSize = inConfiguration.mDriverReceiveFIFOSize ;
+  settings.mControllerReceiveFIFOSize = inConfiguration.mControllerReceiveFIFOSize ;
+  const uint32_t errorCode = can.begin (settings, canISR) ;
+//--- Parameters
+  Serial.print (inBitRate) ;
+  Serial.print (",") ;
+  Serial.print (inLength) ;
+  Serial.print (inExtended ? ",ext," : ",std,") ;
+  Serial.print (inSPIClock) ;
+  Serial.print (",") ;
+  Serial.print (inConfiguration.mDriverTransmitFIFOSize) ;
+  Serial.print (",") ;
+  Serial.print (inConfiguration.mControllerTransmitFIFOSize) ;
+  Serial.print (",") ;
+  Serial.print (inConfiguration.mDriverReceiveFIFOSize) ;
+  Serial.print (",") ;
+  Serial.print (inConfiguration.mControllerReceiveFIFOSize) ;
+  Serial.print (",") ;
+  if (errorCode != 0) {
+    Serial.print ("error 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }else{
+  //--- Saturate bus during RUN_DURATION, then receive pending frames
+    CANMessage frame ;
+    frame.ext = inExtended ;
+    frame.len = inLength ;
+    uint32_t sent = 0 ;
+    uint32_t received = 0 ;
+    noInterrupts () ;
+      gISRDuration = 0 ;
+    interrupts () ;
+    const uint32_t start = millis () ;
+    while ((millis () - start) < RUN_DURATION) {
+      frame.id = sent & (inExtended ? 0x1FFFFFFF : 0x7FF) ;
+      if (can.tryToSend (frame)) {
+        sent += 1 ;
+      }
+      CANMessage receivedFrame ;
+      while (can.receive (receivedFrame)) {
+        received += 1 ;
+      }
+    }
+    noInterrupts () ;
+      const uint32_t isrDuration = gISRDuration ;
+    interrupts () ;
+    const uint32_t receivedDuringRun = received ;
+    const uint32_t drainStart = millis () ;
+    while ((millis () - drainStart) < 100) {
+      CANMessage receivedFrame ;
+      while (can.receive (receivedFrame)) {
+        received += 1 ;
+      }
+    }
+  //--- Results
+    Serial.print (receivedDuringRun * 1000 / RUN_DURATION) ;
+    Serial.print (",") ;
+    Serial.print (inBitRate / frameBitCount (inLength, inExtended)) ;
+    Serial.print (",") ;
+    Serial.print (isrDuration / RUN_DURATION) ; // µs / ms --> per-mille
+    Serial.print (",") ;
+    Serial.print (sent - received) ;
+    Serial.print (",") ;
+    Serial.print (can.driverTransmitBufferPeakCount ()) ;
+    Serial.print (",") ;
+    Serial.println (can.driverReceiveBufferPeakCount ()) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+//   SETUP
+//——————————————————————————————————————————————————————————————————————————————
+
+void setup () {
+//--- Start serial
+  Serial.begin (115200) ;
+  while (!Serial) {}
+//--- Begin SPI
+  SPI.begin () ;
+//--- Run benchmarks
+  Serial.println ("bit_rate,length,format,spi_clock,drv_tx,ctrl_tx,drv_rx,ctrl_rx,"
+                  "frames_per_s,nominal_frames_per_s,isr_per_mille,dropped,peak_drv_tx,peak_drv_rx") ;
+  for (uint8_t b=0 ; b<ARRAY_COUNT (BIT_RATES) ; b++) {
+    for (uint8_t l=0 ; l<ARRAY_COUNT (FRAME_LENGTHS) ; l++) {
+      for (uint8_t e=0 ; e<2 ; e++) {
+        for (uint8_t s=0 ; s<ARRAY_COUNT (SPI_CLOCKS) ; s++) {
+          for (uint8_t c=0 ; c<ARRAY_COUNT (BUFFER_CONFIGURATIONS) ; c++) {
+            runBenchmark (BIT_RATES [b], FRAME_LENGTHS [l], e != 0, SPI_CLOCKS [s], BUFFER_CONFIGURATIONS [c]) ;
+          }
+        }
+      }
+    }
+  }
+  Serial.println ("done") ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————
+
+void loop () {
+}
+
+//——————————————————————————————————————————————————————————————————————————————
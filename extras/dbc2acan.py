@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+# Generates ACANSignal descriptors (see src/ACANSignal.h) from a DBC file
+# by Pierre Molinaro
+#
+# Usage: python3 dbc2acan.py network.dbc > network.h
+#
+# Every BO_ message becomes a class with its identifier, format and length; every SG_ signal becomes a
+# nested class deriving from ACANSignal, with value / setValue methods applying factor and offset.
+# Multiplexed signals are generated as plain signals, the multiplexor value is written in a comment.
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+import re
+import sys
+
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+MESSAGE_RE = re.compile (r'^BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)\s+(\w+)')
+SIGNAL_RE = re.compile (
+  r'^SG_\s+(\w+)\s*(M|m\d+)?\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*'
+  r'\(\s*([^,]+)\s*,\s*([^)]+)\s*\)\s*\[\s*([^|]*)\|([^\]]*)\]\s*"([^"]*)"'
+)
+
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+def identifier (inName) :
+  name = re.sub (r'\W', '_', inName)
+  if name [0].isdigit () :
+    name = '_' + name
+  return name
+
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+def floatLiteral (inValue) :
+  s = repr (float (inValue))
+  if ('e' not in s) and ('.' not in s) :
+    s += '.0'
+  return s + 'f'
+
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+def parse (inLines) :
+  messages = []
+  for line in inLines :
+    line = line.strip ()
+    m = MESSAGE_RE.match (line)
+    if m :
+      rawId = int (m.group (1))
+      messages.append ({
+        'id' : rawId & 0x1FFFFFFF,
+        'extended' : (rawId & 0x80000000) != 0,
+        'name' : identifier (m.group (2)),
+        'length' : int (m.group (3)),
+        'signals' : []
+      })
+    else:
+      s = SIGNAL_RE.match (line)
+      if s and messages :
+        messages [-1]['signals'].append ({
+          'name' : identifier (s.group (1)),
+          'mux' : s.group (2),
+          'start' : int (s.group (3)),
+          'length' : int (s.group (4)),
+          'intel' : s.group (5) == '1',
+          'signed' : s.group (6) == '-',
+          'factor' : float (s.group (7)),
+          'offset' : float (s.group (8)),
+          'unit' : s.group (11)
+        })
+  return messages
+
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+def generate (inMessages, inSourceName) :
+  out = []
+  out.append ('//' + '—' * 118)
+  out.append ('// Generated by dbc2acan.py from ' + inSourceName + ', do not edit')
+  out.append ('//' + '—' * 118)
+  out.append ('')
+  out.append ('#pragma once')
+  out.append ('')
+  out.append ('#include <ACANSignal.h>')
+  for message in inMessages :
+    out.append ('')
+    out.append ('//' + '—' * 118)
+    out.append ('')
+    out.append ('class ' + message ['name'] + ' {')
+    out.append ('  public: static const uint32_t kIdentifier = 0x%X ;' % message ['id'])
+    out.append ('  public: static const tFrameFormat kFormat = %s ;' % ('kExtended' if message ['extended'] else 'kStandard'))
+    out.append ('  public: static const uint8_t kLength = %d ;' % message ['length'])
+    for signal in message ['signals'] :
+      order = 'kIntel' if signal ['intel'] else 'kMotorola'
+      signedness = 'true' if signal ['signed'] else 'false'
+      factor = floatLiteral (signal ['factor'])
+      offset = floatLiteral (signal ['offset'])
+      comment = []
+      if signal ['unit'] :
+        comment.append ('unit: ' + signal ['unit'])
+      if signal ['mux'] == 'M' :
+        comment.append ('multiplexor')
+      elif signal ['mux'] :
+        comment.append ('multiplexed, multiplexor value ' + signal ['mux'][1:])
+      out.append ('')
+      if comment :
+        out.append ('//--- ' + ', '.join (comment))
+      out.append ('  public: class %s : public ACANSignal <%d, %d, %s, %s> {' % (
+        signal ['name'], signal ['start'], signal ['length'], order, signedness))
+      out.append ('    public: static float value (const CANMessage & inMessage) {')
+      out.append ('      return ((float) rawValue (inMessage)) * %s + %s ;' % (factor, offset))
+      out.append ('    }')
+      out.append ('    public: static void setValue (CANMessage & ioMessage, const float inValue) {')
+      out.append ('      const float raw = (inValue - %s) / %s ;' % (offset, factor))
+      out.append ('      setRawValue (ioMessage, (RawType) (raw + ((raw >= 0.0f) ? 0.5f : -0.5f))) ;')
+      out.append ('    }')
+      out.append ('  } ;')
+    out.append ('} ;')
+  out.append ('')
+  out.append ('//' + '—' * 118)
+  return '\n'.join (out) + '\n'
+
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+if __name__ == '__main__' :
+  if len (sys.argv) != 2 :
+    sys.stderr.write ('Usage: python3 dbc2acan.py network.dbc > network.h\n')
+    sys.exit (1)
+  with open (sys.argv [1], encoding = 'latin-1') as f :
+    messages = parse (f.readlines ())
+  sys.stdout.write (generate (messages, sys.argv [1]))
+
+#———————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
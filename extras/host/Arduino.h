@@ -0,0 +1,77 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Host Arduino core subset, for the host programs of extras/host (not an Arduino core)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_HOST_ARDUINO_DEFINED
+#define ACAN2517_HOST_ARDUINO_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+typedef uint8_t byte ;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LOW_LEVEL 0
+#define FALLING 2
+#define NOT_AN_INTERRUPT -1
+#define LED_BUILTIN 13
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Time: steady clock, from first call; with ACAN2517_HOST_SIMULATION defined, simulated time, advanced by the
+//  program that simulates a controller (see MCP2517FDSimulator.h)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifdef ACAN2517_HOST_SIMULATION
+  uint64_t hostNanos (void) ;
+  void hostElapse (const uint64_t inNanos) ;
+
+  inline void delay (const uint32_t inMillis) { hostElapse ((uint64_t) inMillis * 1000000) ; }
+  inline void delayMicroseconds (const uint32_t inMicros) { hostElapse ((uint64_t) inMicros * 1000) ; }
+  inline void yield (void) { hostElapse (0) ; }
+#else
+  inline uint64_t hostNanos (void) {
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now () ;
+    return (uint64_t) std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::steady_clock::now () - origin).count () ;
+  }
+
+  inline void delay (const uint32_t inMillis) { std::this_thread::sleep_for (std::chrono::milliseconds (inMillis)) ; }
+  inline void delayMicroseconds (const uint32_t inMicros) { std::this_thread::sleep_for (std::chrono::microseconds (inMicros)) ; }
+  inline void yield (void) { std::this_thread::yield () ; }
+#endif
+
+inline uint32_t micros (void) { return (uint32_t) (hostNanos () / 1000) ; }
+inline uint32_t millis (void) { return (uint32_t) (hostNanos () / 1000000) ; }
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Pins and interrupts: a host program that simulates a controller defines hostDigitalWrite (chip select);
+//  interrupt masking is a no-op (host programs are multi-threaded, they do not use interrupts)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void hostDigitalWrite (const uint8_t inPin, const uint8_t inValue) ;
+
+inline void pinMode (const uint8_t, const uint8_t) {}
+inline void digitalWrite (const uint8_t inPin, const uint8_t inValue) { hostDigitalWrite (inPin, inValue) ; }
+inline int digitalRead (const uint8_t) { return HIGH ; }
+inline int8_t digitalPinToInterrupt (const uint8_t inPin) { return (int8_t) inPin ; }
+inline void attachInterrupt (const uint8_t, void (*) (void), const int) {}
+inline void detachInterrupt (const uint8_t) {}
+inline void noInterrupts (void) {}
+inline void interrupts (void) {}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
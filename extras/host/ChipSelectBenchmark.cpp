@@ -0,0 +1,140 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Host variant of the ChipSelectBenchmark sketch: the driver runs with a simulated MCP2517FD (MCP2517FDSimulator.h)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// Build and run (from extras/host):
+//   g++ -std=gnu++11 -O2 -DACAN2517_HOST_SIMULATION -I. -I../../src ChipSelectBenchmark.cpp ../../src/ACAN2517.cpp
+//       ../../src/ACAN2517Settings.cpp -o chipselect
+//   ./chipselect
+//
+// The host has no port registers, so the fast chip select code is not compiled: the simulator counts the CS
+// writes of a register read and of a loopback frame (tryToSend, isr, receive), and runs the frame loop twice per
+// board model, with the CS write cost of digitalWrite and with the cost of a direct port write. The CS write costs
+// below are model inputs (cycle counts of the CS write code path), not measurements: every printed cycle count
+// and saving is a modeled estimate. Run the sketch on a board for measurements.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517.h>
+#include "MCP2517FDSimulator.h"
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Board models
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class BoardModel {
+  public: const char * mName ;
+  public: uint32_t mCPUClock ; // Hz
+  public: uint32_t mSPIMaxClock ; // Hz
+  public: uint32_t mDigitalWriteCycles ; // pin lookup, timer check, interrupt-safe read-modify-write
+  public: uint32_t mFastWriteCycles ; // cached port register and mask
+  public: uint32_t mInterruptEntryCycles ;
+} ;
+
+static const BoardModel BOARD_MODELS [] = {
+  {"AVR 16 MHz (Uno)",          16 * 1000 * 1000,  8 * 1000 * 1000, 56, 10, 80},
+  {"SAMD21 48 MHz (Zero)",      48 * 1000 * 1000, 12 * 1000 * 1000, 60,  4, 40},
+  {"Teensy 3.2 96 MHz",         96 * 1000 * 1000, 20 * 1000 * 1000, 20,  2, 40}
+} ;
+
+static const uint8_t BOARD_MODEL_COUNT = sizeof (BOARD_MODELS) / sizeof (BOARD_MODELS [0]) ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint8_t MCP2517_CS  = 10 ;
+static const uint8_t MCP2517_INT =  3 ;
+static const uint32_t ITERATIONS = 1000 ;
+static const uint32_t LOOP_NANOS = 1000 ; // One polling iteration, without its SPI transfers
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static MCP2517FDSimulator simulator (MCP2517_CS, 40 * 1000 * 1000) ; // OSC_4MHz10xPLL
+static ACAN2517 can (MCP2517_CS, SPI, MCP2517_INT) ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint32_t cyclesToNanos (const uint32_t inCycles, const uint32_t inCPUClock) {
+  return (uint32_t) (((uint64_t) inCycles * 1000000000ULL) / inCPUClock) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class FrameResult {
+  public: double mChipSelectsPerRegisterRead = 0.0 ;
+  public: double mChipSelectsPerFrame = 0.0 ;
+  public: double mFrameNanos = 0.0 ;
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static bool runFrames (const uint32_t inChipSelectWriteCycles, const BoardModel & inBoard, FrameResult & outResult) {
+  simulator.mSPIMaxClock = inBoard.mSPIMaxClock ;
+  simulator.mChipSelectEdgeNanos = cyclesToNanos (inChipSelectWriteCycles, inBoard.mCPUClock) ;
+  simulator.mInterruptEntryNanos = cyclesToNanos (inBoard.mInterruptEntryCycles, inBoard.mCPUClock) ;
+  ACAN2517Settings settings (ACAN2517Settings::OSC_4MHz10xPLL, 1000 * 1000) ; // CAN bit rate 1 Mb/s
+  settings.mRequestedMode = ACAN2517Settings::InternalLoopBack ;
+  settings.mUseFastChipSelect = true ; // Ignored on the host: the CS write cost is modeled
+  const uint32_t errorCode = can.begin (settings, [] { can.isr () ; }) ;
+  if (errorCode != 0) {
+    printf ("  Configuration error 0x%X\n", errorCode) ;
+  }else{
+  //--- Register access
+    uint32_t chipSelects = simulator.mChipSelectCount ;
+    for (uint32_t i=0 ; i<ITERATIONS ; i++) {
+      can.readErrorCounters () ;
+    }
+    outResult.mChipSelectsPerRegisterRead = (double) (simulator.mChipSelectCount - chipSelects) / ITERATIONS ;
+  //--- Frame: tryToSend, isr, receive
+    CANMessage frame ;
+    frame.len = 8 ;
+    chipSelects = simulator.mChipSelectCount ;
+    const uint64_t start = simulator.now () ;
+    for (uint32_t i=0 ; i<ITERATIONS ; i++) {
+      frame.id = i & 0x7FF ;
+      while (!can.tryToSend (frame)) {
+        hostElapse (LOOP_NANOS) ;
+      }
+      while (!can.receive (frame)) {
+        hostElapse (LOOP_NANOS) ;
+      }
+    }
+    outResult.mChipSelectsPerFrame = (double) (simulator.mChipSelectCount - chipSelects) / ITERATIONS ;
+    outResult.mFrameNanos = (double) (simulator.now () - start) / ITERATIONS ;
+  }
+  return errorCode == 0 ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+int main (void) {
+  simulator.setInterruptServiceRoutine ([] { can.isr () ; }) ;
+  printf ("MODELED ESTIMATES (assumed CS write costs, fast chip select not compiled on host), not measurements\n") ;
+  printf ("Loopback frame: 8 data bytes, 1 Mbit/s, polling loop %u ns\n", LOOP_NANOS) ;
+  for (uint8_t i = 0 ; i < BOARD_MODEL_COUNT ; i++) {
+    const BoardModel & board = BOARD_MODELS [i] ;
+    printf ("%s, SPI %u MHz, assumed CS write: digitalWrite %u cycles, port register %u cycles\n",
+            board.mName,
+            board.mSPIMaxClock / 1000000,
+            board.mDigitalWriteCycles,
+            board.mFastWriteCycles) ;
+    FrameResult slow ;
+    FrameResult fast ;
+    if (runFrames (board.mDigitalWriteCycles, board, slow) && runFrames (board.mFastWriteCycles, board, fast)) {
+      const double savedCyclesPerWrite = (double) (board.mDigitalWriteCycles - board.mFastWriteCycles) ;
+      const double cyclesPerNano = (double) board.mCPUClock / 1.0e9 ;
+      printf ("  CS assertions: %.1f per register read, %.1f per frame\n",
+              slow.mChipSelectsPerRegisterRead,
+              slow.mChipSelectsPerFrame) ;
+      printf ("  Estimated cycles saved: %.0f per register read, %.0f per frame\n",
+              2.0 * slow.mChipSelectsPerRegisterRead * savedCyclesPerWrite,
+              2.0 * slow.mChipSelectsPerFrame * savedCyclesPerWrite) ;
+      printf ("  Modeled frame round trip (includes bus time): %.0f cycles with digitalWrite, %.0f cycles with port register (-%.1f%%)\n",
+              slow.mFrameNanos * cyclesPerNano,
+              fast.mFrameNanos * cyclesPerNano,
+              100.0 * (slow.mFrameNanos - fast.mFrameNanos) / slow.mFrameNanos) ;
+    }
+  }
+  return 0 ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
@@ -0,0 +1,214 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Host variant of the LatencyBenchmark sketch: the driver runs with a simulated MCP2517FD (MCP2517FDSimulator.h)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// Build and run (from extras/host):
+//   g++ -std=gnu++11 -O2 -DACAN2517_HOST_SIMULATION -I. -I../../src LatencyBenchmark.cpp ../../src/ACAN2517.cpp
+//       ../../src/ACAN2517Settings.cpp -o latency
+//   ./latency
+//
+// Same traffic pattern, buffer configurations and histograms (LatencyHistogram.h of the sketch) as the sketch,
+// in internal loop back mode. Latencies are in simulated time: SPI transfers at the SPI clock, bus frames at the
+// bit rate, and the CPU costs of the model below; the CPU time of the driver code itself is not simulated, so
+// they are lower bounds, that show how buffer sizes and SPI traffic shape the latency distribution.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517.h>
+#include "MCP2517FDSimulator.h"
+#include "../../examples/LatencyBenchmark/LatencyHistogram.h"
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Simulated board: 8 MHz SPI, digitalWrite and isr entry costs of a 16 MHz AVR; one loop iteration (without
+//  its SPI transfers) lasts LOOP_NANOS
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint8_t MCP2517_CS  = 10 ;
+static const uint8_t MCP2517_INT =  3 ;
+static const uint32_t SPI_MAX_CLOCK = 8 * 1000 * 1000 ;
+static const uint32_t CHIP_SELECT_EDGE_NANOS = 3500 ;
+static const uint32_t INTERRUPT_ENTRY_NANOS = 5000 ;
+static const uint32_t LOOP_NANOS = 2000 ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static MCP2517FDSimulator simulator (MCP2517_CS, 40 * 1000 * 1000) ; // OSC_4MHz10xPLL
+static ACAN2517 can (MCP2517_CS, SPI, MCP2517_INT) ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Traffic pattern: bursts of BURST_LENGTH frames, every BURST_PERIOD µs (same as the sketch)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint32_t BIT_RATE = 1000 * 1000 ;
+static const uint32_t FRAME_COUNT = 2000 ; // For every configuration
+static const uint8_t BURST_LENGTH = 8 ;
+static const uint32_t BURST_PERIOD = 2000 ; // µs
+static const uint8_t FRAME_LENGTH = 8 ; // 2 ... 8 (sequence number is in the first two bytes)
+static const bool EXTENDED_FRAMES = false ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Buffer configurations (same as the sketch)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class Configuration {
+  public: uint16_t mDriverTransmitFIFOSize ;
+  public: uint8_t mControllerTransmitFIFOSize ;
+  public: uint16_t mDriverReceiveFIFOSize ;
+  public: uint8_t mControllerReceiveFIFOSize ;
+} ;
+
+static const Configuration CONFIGURATIONS [] = {
+  {16, 32, 32, 32}, // Default settings
+  {32,  2, 32,  2},
+  { 0, 16,  8, 16},
+  {32,  1,  1,  1}
+} ;
+
+static const uint8_t CONFIGURATION_COUNT = sizeof (CONFIGURATIONS) / sizeof (CONFIGURATIONS [0]) ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Frame dates, indexed by sequence number; at most IN_FLIGHT frames are pending
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint16_t IN_FLIGHT = 64 ; // Power of 2
+
+class FrameDates {
+  public: uint32_t mSubmit ;
+  public: uint32_t mController ;
+  public: uint32_t mReceiveISR ;
+} ;
+
+static FrameDates gDates [IN_FLIGHT] ;
+
+static LatencyHistogram gTransmitPath ;
+static LatencyHistogram gBusAndController ;
+static LatencyHistogram gReceivePath ;
+static LatencyHistogram gEndToEnd ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint16_t sequenceNumber (const CANMessage & inFrame) {
+  return (uint16_t) (inFrame.data [0] | (inFrame.data [1] << 8)) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static void frameTrace (const CANMessage & inFrame, const ACAN2517::FrameTracePoint inTracePoint) {
+  const uint32_t now = micros () ;
+  FrameDates & dates = gDates [sequenceNumber (inFrame) % IN_FLIGHT] ;
+  if (inTracePoint == ACAN2517::FrameWrittenInController) {
+    dates.mController = now ;
+  }else{
+    dates.mReceiveISR = now ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static void printHistogram (const char * inTitle, const LatencyHistogram & inHistogram) {
+  printf ("%s p50 %u us, p99 %u us, max %u us\n",
+          inTitle,
+          inHistogram.percentile (500),
+          inHistogram.percentile (990),
+          inHistogram.max ()) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static void runConfiguration (const Configuration & inConfiguration) {
+  ACAN2517Settings settings (ACAN2517Settings::OSC_4MHz10xPLL, BIT_RATE) ;
+  settings.mRequestedMode = ACAN2517Settings::InternalLoopBack ;
+  settings.mDriverTransmitFIFOSize = inConfiguration.mDriverTransmitFIFOSize ;
+  settings.mControllerTransmitFIFOSize = inConfiguration.mControllerTransmitFIFOSize ;
+  settings.mDriverReceiveFIFOSize = inConfiguration.mDriverReceiveFIFOSize ;
+  settings.mControllerReceiveFIFOSize = inConfiguration.mControllerReceiveFIFOSize ;
+  const uint32_t errorCode = can.begin (settings, [] { can.isr () ; }) ;
+  printf ("Driver TX %u, controller TX %u, driver RX %u, controller RX %u\n",
+          inConfiguration.mDriverTransmitFIFOSize,
+          inConfiguration.mControllerTransmitFIFOSize,
+          inConfiguration.mDriverReceiveFIFOSize,
+          inConfiguration.mControllerReceiveFIFOSize) ;
+  if (errorCode != 0) {
+    printf ("  Configuration error 0x%X\n", errorCode) ;
+  }else{
+    can.setFrameTraceCallBack (frameTrace) ;
+    gTransmitPath.clear () ;
+    gBusAndController.clear () ;
+    gReceivePath.clear () ;
+    gEndToEnd.clear () ;
+    const uint32_t spiBytesAtStart = simulator.mSPIByteCount ;
+    const uint32_t chipSelectsAtStart = simulator.mChipSelectCount ;
+    const uint32_t interruptsAtStart = simulator.mInterruptCount ;
+    CANMessage frame ;
+    frame.ext = EXTENDED_FRAMES ;
+    frame.len = FRAME_LENGTH ;
+    uint32_t sent = 0 ;
+    uint32_t received = 0 ;
+    uint8_t burstRemaining = 0 ;
+    uint32_t nextBurstDate = micros () ;
+    uint32_t lastActivityDate = millis () ;
+    while ((received < FRAME_COUNT) && ((millis () - lastActivityDate) < 1000)) {
+    //--- Submit
+      if ((burstRemaining == 0) && (sent < FRAME_COUNT) && (((int32_t) (micros () - nextBurstDate)) >= 0)) {
+        burstRemaining = BURST_LENGTH ;
+        nextBurstDate += BURST_PERIOD ;
+      }
+      if ((burstRemaining > 0) && (sent < FRAME_COUNT) && ((sent - received) < IN_FLIGHT)) {
+        frame.id = sent & 0x7FF ;
+        frame.data [0] = (uint8_t) sent ;
+        frame.data [1] = (uint8_t) (sent >> 8) ;
+        gDates [sent % IN_FLIGHT].mSubmit = micros () ;
+        if (can.tryToSend (frame)) {
+          sent += 1 ;
+          burstRemaining -= 1 ;
+        }
+      }
+    //--- Receive
+      CANMessage receivedFrame ;
+      if (can.receive (receivedFrame)) {
+        const uint32_t now = micros () ;
+        const FrameDates dates = gDates [sequenceNumber (receivedFrame) % IN_FLIGHT] ;
+        gTransmitPath.record (dates.mController - dates.mSubmit) ;
+        gBusAndController.record (dates.mReceiveISR - dates.mController) ;
+        gReceivePath.record (now - dates.mReceiveISR) ;
+        gEndToEnd.record (now - dates.mSubmit) ;
+        received += 1 ;
+        lastActivityDate = millis () ;
+      }
+      hostElapse (LOOP_NANOS) ;
+    }
+    can.setFrameTraceCallBack (NULL) ;
+    printf ("  Sent %u, received %u, controller RX overflows %u\n", sent, received, simulator.mReceiveOverflowCount) ;
+    printHistogram ("  Transmit path:     ", gTransmitPath) ;
+    printHistogram ("  Bus and controller:", gBusAndController) ;
+    printHistogram ("  Receive path:      ", gReceivePath) ;
+    printHistogram ("  End to end:        ", gEndToEnd) ;
+    if (received > 0) {
+      printf ("  Per frame: %.1f SPI bytes, %.1f CS assertions, %.2f isr\n",
+              (double) (simulator.mSPIByteCount - spiBytesAtStart) / received,
+              (double) (simulator.mChipSelectCount - chipSelectsAtStart) / received,
+              (double) (simulator.mInterruptCount - interruptsAtStart) / received) ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+int main (void) {
+  simulator.mSPIMaxClock = SPI_MAX_CLOCK ;
+  simulator.mChipSelectEdgeNanos = CHIP_SELECT_EDGE_NANOS ;
+  simulator.mInterruptEntryNanos = INTERRUPT_ENTRY_NANOS ;
+  simulator.setInterruptServiceRoutine ([] { can.isr () ; }) ;
+  printf ("Simulated: SPI %u MHz, CS edge %u ns, isr entry %u ns, loop %u ns, bit rate %u kbit/s\n",
+          SPI_MAX_CLOCK / 1000000,
+          CHIP_SELECT_EDGE_NANOS,
+          INTERRUPT_ENTRY_NANOS,
+          LOOP_NANOS,
+          BIT_RATE / 1000) ;
+  for (uint8_t i = 0 ; i < CONFIGURATION_COUNT ; i++) {
+    runConfiguration (CONFIGURATIONS [i]) ;
+  }
+  return 0 ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
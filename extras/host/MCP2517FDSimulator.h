@@ -0,0 +1,528 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// MCP2517FD controller simulator, for the host programs of extras/host (build with -DACAN2517_HOST_SIMULATION)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// The simulator is the SPI slave of the driver, and it owns the simulated time. Simulated:
+//   - RESET, READ and WRITE instructions (not the CRC protected ones), at the SPI clock of the transaction;
+//   - operation mode requests (the mode is reached at once), oscillator and PLL always ready;
+//   - TXQ (if TXQEN is set), FIFO 1 and FIFO 2 (the FIFOs used by the driver), transmit or receive, with their
+//     user address, status, UINC, TXREQ, "not full / not empty" interrupts; no TEF, no time stamp;
+//   - a bus without other node and without error: a transmitted frame lasts its bit count (without stuff bits)
+//     times the bit time (C1NBTCFG), and it is received by the controller in loop back modes (filters, FIFO
+//     overflow);
+//   - INT output: the isr is called when INT is asserted, outside of SPI transactions and of isr.
+// CPU time of the driver is not simulated, except the costs of the model below (chip select edge, isr entry):
+// time only advances by SPI transfers, by these costs, and by hostElapse calls of the program.
+// Include this file in one translation unit only: it defines the host hooks of Arduino.h and SPI.h.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef MCP2517FD_SIMULATOR_DEFINED
+#define MCP2517FD_SIMULATOR_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <SPI.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class MCP2517FDSimulator {
+
+//······················································································································
+//   COST MODEL (in ns of simulated time)
+//······················································································································
+
+  public: uint32_t mSPIMaxClock = 8 * 1000 * 1000 ; // Hz: SPI clock is the lower of requested clock and this one
+  public: uint32_t mChipSelectEdgeNanos = 0 ; // CPU time of a CS pin write
+  public: uint32_t mInterruptEntryNanos = 0 ; // CPU time of entering and leaving isr
+
+//······················································································································
+//   COUNTERS
+//······················································································································
+
+  public: uint32_t mChipSelectCount = 0 ; // CS assertions
+  public: uint32_t mSPIByteCount = 0 ;
+  public: uint32_t mInterruptCount = 0 ;
+  public: uint32_t mTransmittedFrameCount = 0 ;
+  public: uint32_t mReceivedFrameCount = 0 ;
+  public: uint32_t mReceiveOverflowCount = 0 ;
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: MCP2517FDSimulator (const uint8_t inCS, const uint32_t inSysClock) :
+  mCS (inCS),
+  mSysClock (inSysClock) {
+    sCurrent = this ;
+    reset () ;
+  }
+
+//······················································································································
+//   INTERRUPT SERVICE ROUTINE (called when INT is asserted)
+//······················································································································
+
+  public: void setInterruptServiceRoutine (void (* inRoutine) (void)) { mInterruptServiceRoutine = inRoutine ; }
+
+//······················································································································
+//   TIME
+//······················································································································
+
+  public: uint64_t now (void) const { return mNow ; }
+
+//--- Advance simulated time; isr is called as soon as a frame end asserts INT
+  public: void elapse (const uint64_t inNanos) {
+    const uint64_t target = mNow + inNanos ;
+    runInterruptServiceRoutine () ;
+    while (mBusBusy && (mBusFrameEnd <= target) && (mTransactionDepth == 0) && !mInInterruptServiceRoutine) {
+      advance ((mBusFrameEnd > mNow) ? (mBusFrameEnd - mNow) : 0) ;
+      runInterruptServiceRoutine () ;
+    }
+    advance ((target > mNow) ? (target - mNow) : 0) ;
+    runInterruptServiceRoutine () ;
+  }
+
+//······················································································································
+//   HOOKS (called by host Arduino.h and SPI.h)
+//······················································································································
+
+  public: static MCP2517FDSimulator * sCurrent ;
+
+  public: void pinWrite (const uint8_t inPin, const uint8_t inValue) {
+    if (inPin == mCS) {
+      advance (mChipSelectEdgeNanos) ;
+      if (inValue == LOW) {
+        mChipSelectCount += 1 ;
+        mCommandLength = 0 ;
+      }else{
+        endCommand () ;
+      }
+    }
+  }
+
+  public: void beginTransaction (const uint32_t inClock) {
+    mSPIClock = (inClock < mSPIMaxClock) ? inClock : mSPIMaxClock ;
+    mTransactionDepth += 1 ;
+  }
+
+  public: void endTransaction (void) {
+    mTransactionDepth -= 1 ;
+    runInterruptServiceRoutine () ;
+  }
+
+  public: uint8_t transfer (const uint8_t inByte) {
+    advance (8ULL * 1000 * 1000 * 1000 / mSPIClock) ;
+    mSPIByteCount += 1 ;
+    uint8_t result = 0 ;
+    if (mCommandLength < 2) {
+      mCommand [mCommandLength] = inByte ;
+    }else{
+      const uint16_t address = (uint16_t) ((commandAddress () + mCommandLength - 2) & 0xFFF) ;
+      if (commandInstruction () == kRead) {
+        result = mMemory [address] ;
+      }else if (commandInstruction () == kWrite) {
+        writeByte (address, inByte) ;
+      }else{
+        printf ("MCP2517FDSimulator: unsupported instruction 0x%X\n", commandInstruction ()) ;
+        exit (1) ;
+      }
+    }
+    mCommandLength += 1 ;
+    return result ;
+  }
+
+//······················································································································
+//   REGISTERS
+//······················································································································
+
+  private: static const uint16_t C1CON    = 0x000 ;
+  private: static const uint16_t C1NBTCFG = 0x004 ;
+  private: static const uint16_t C1INT    = 0x01C ;
+  private: static const uint16_t C1RXIF   = 0x020 ;
+  private: static const uint16_t C1TXIF   = 0x024 ;
+  private: static const uint16_t C1TXQCON = 0x050 ;
+  private: static const uint16_t C1FLTCON = 0x1D0 ;
+  private: static const uint16_t C1FLTOBJ = 0x1F0 ;
+  private: static const uint16_t OSC      = 0xE00 ;
+
+  private: static const uint8_t kQueueCount = 3 ; // TXQ, FIFO 1, FIFO 2
+
+  private: static uint16_t queueCON (const uint8_t inQueue) { return (uint16_t) (C1TXQCON + 12 * inQueue) ; }
+
+  private: static const uint8_t kConfigurationMode = 4 ;
+
+  private: static const uint8_t kReset = 0x0 ;
+  private: static const uint8_t kWrite = 0x2 ;
+  private: static const uint8_t kRead  = 0x3 ;
+
+//······················································································································
+//   PRIVATE TYPES AND PROPERTIES
+//······················································································································
+
+  private: class Queue {
+    public: bool mEnabled = false ;
+    public: bool mTransmit = false ;
+    public: bool mRequest = false ; // TXREQ
+    public: bool mOverflow = false ; // RXOVIF
+    public: uint16_t mBase = 0 ; // RAM offset
+    public: uint8_t mObjectSize = 0 ;
+    public: uint8_t mSize = 0 ;
+    public: uint8_t mCount = 0 ;
+    public: uint8_t mHead = 0 ; // Next object written (user for transmit, controller for receive)
+    public: uint8_t mTail = 0 ; // Next object read (controller for transmit, user for receive)
+  } ;
+
+  private: const uint8_t mCS ;
+  private: const uint32_t mSysClock ;
+  private: uint8_t mMemory [4096] ;
+  private: Queue mQueues [kQueueCount] ;
+  private: uint8_t mCommand [2] ;
+  private: uint32_t mCommandLength = 0 ;
+  private: uint32_t mSPIClock = 1000 * 1000 ;
+  private: uint32_t mTransactionDepth = 0 ;
+  private: uint64_t mNow = 0 ;
+  private: bool mBusBusy = false ;
+  private: uint64_t mBusFrameEnd = 0 ;
+  private: uint8_t mBusQueue = 0 ;
+  private: void (* mInterruptServiceRoutine) (void) = NULL ;
+  private: bool mInInterruptServiceRoutine = false ;
+
+//······················································································································
+//   SPI COMMANDS
+//······················································································································
+
+  private: uint8_t commandInstruction (void) const { return mCommand [0] >> 4 ; }
+
+  private: uint16_t commandAddress (void) const { return (uint16_t) (((mCommand [0] & 0x0F) << 8) | mCommand [1]) ; }
+
+  private: void endCommand (void) {
+    if ((mCommandLength == 2) && (commandInstruction () == kReset) && (commandAddress () == 0)) {
+      reset () ;
+    }
+    mCommandLength = 0 ;
+  }
+
+  private: void writeByte (const uint16_t inAddress, const uint8_t inValue) {
+    const uint8_t mode = mMemory [C1CON + 2] >> 5 ;
+    if (inAddress == (C1CON + 2)) { // OPMOD is read only
+      mMemory [inAddress] = (uint8_t) ((mMemory [inAddress] & 0xE0) | (inValue & 0x1F)) ;
+    }else if (inAddress == (C1CON + 3)) { // REQOP: mode is reached at once
+      mMemory [inAddress] = inValue & 0xF7 ; // ABAT is ignored
+      const uint8_t requestedMode = inValue & 0x07 ;
+      mMemory [C1CON + 2] = (uint8_t) ((mMemory [C1CON + 2] & 0x1F) | (requestedMode << 5)) ;
+      if ((mode == kConfigurationMode) && (requestedMode != kConfigurationMode)) {
+        setUpQueues () ;
+      }else if (requestedMode == kConfigurationMode) {
+        for (uint8_t q = 0 ; q < kQueueCount ; q++) {
+          mQueues [q].mEnabled = false ;
+        }
+        mBusBusy = false ;
+      }
+    }else if ((inAddress == C1INT) || (inAddress == (C1INT + 1))) { // Flags are cleared by writing 0
+      mMemory [inAddress] &= inValue ;
+    }else if ((inAddress >= C1TXQCON) && (inAddress < (C1TXQCON + 12 * kQueueCount))) {
+      const uint8_t q = (uint8_t) ((inAddress - C1TXQCON) / 12) ;
+      const uint8_t offset = (uint8_t) ((inAddress - C1TXQCON) % 12) ;
+      if (offset == 1) { // UINC, TXREQ, FRESET
+        queueCommand (q, inValue) ;
+      }else if (offset == 4) { // RXOVIF is cleared by writing 0
+        mQueues [q].mOverflow = mQueues [q].mOverflow && ((inValue & (1 << 3)) != 0) ;
+      }else if (offset < 4) {
+        mMemory [inAddress] = inValue ;
+      }
+    }else{
+      mMemory [inAddress] = inValue ;
+    }
+    refresh () ;
+  }
+
+//······················································································································
+//   RESET AND QUEUE SET UP
+//······················································································································
+
+  private: void reset (void) {
+    for (uint32_t i = 0 ; i < sizeof (mMemory) ; i++) {
+      mMemory [i] = 0 ;
+    }
+    setWord (C1CON, 0x04980760) ; // Configuration mode
+    setWord (C1NBTCFG, 0x003E0F0F) ;
+    setWord (OSC, 0x00000460) ; // Oscillator ready
+    for (uint8_t q = 0 ; q < kQueueCount ; q++) {
+      mQueues [q] = Queue () ;
+    }
+    mBusBusy = false ;
+    refresh () ;
+  }
+
+  private: void setUpQueues (void) {
+    static const uint8_t payloadSize [8] = {8, 12, 16, 20, 24, 32, 48, 64} ;
+    uint16_t base = 0 ;
+    for (uint8_t q = 0 ; q < kQueueCount ; q++) {
+      Queue & queue = mQueues [q] ;
+      const uint16_t con = queueCON (q) ;
+      queue = Queue () ;
+      queue.mEnabled = (q > 0) || ((mMemory [C1CON + 2] & (1 << 4)) != 0) ; // TXQEN
+      queue.mTransmit = (q == 0) || ((mMemory [con] & (1 << 7)) != 0) ; // TXEN
+      queue.mSize = (uint8_t) ((mMemory [con + 3] & 0x1F) + 1) ;
+      queue.mObjectSize = (uint8_t) (8 + payloadSize [mMemory [con + 3] >> 5]) ;
+      queue.mBase = base ;
+      if (queue.mEnabled) {
+        base += queue.mSize * queue.mObjectSize ;
+      }
+    }
+    if (base > 2048) {
+      printf ("MCP2517FDSimulator: RAM usage %u > 2048\n", base) ;
+      exit (1) ;
+    }
+  }
+
+  private: void queueCommand (const uint8_t inQueue, const uint8_t inValue) {
+    Queue & queue = mQueues [inQueue] ;
+    if (queue.mEnabled) {
+      if ((inValue & (1 << 2)) != 0) { // FRESET
+        queue.mCount = 0 ;
+        queue.mHead = 0 ;
+        queue.mTail = 0 ;
+        queue.mRequest = false ;
+      }
+      if ((inValue & (1 << 0)) != 0) { // UINC
+        if (queue.mTransmit && (queue.mCount < queue.mSize)) {
+          queue.mHead = (uint8_t) ((queue.mHead + 1) % queue.mSize) ;
+          queue.mCount += 1 ;
+        }else if (!queue.mTransmit && (queue.mCount > 0)) {
+          queue.mTail = (uint8_t) ((queue.mTail + 1) % queue.mSize) ;
+          queue.mCount -= 1 ;
+        }
+      }
+      if (((inValue & (1 << 1)) != 0) && queue.mTransmit && (queue.mCount > 0)) { // TXREQ
+        queue.mRequest = true ;
+        startTransmission () ;
+      }
+    }
+  }
+
+//······················································································································
+//   DERIVED REGISTERS: status, user address, interrupt flags
+//······················································································································
+
+  private: void refresh (void) {
+    uint32_t transmitFlags = 0 ;
+    uint32_t receiveFlags = 0 ;
+    for (uint8_t q = 0 ; q < kQueueCount ; q++) {
+      const Queue & queue = mQueues [q] ;
+      const uint16_t con = queueCON (q) ;
+      uint8_t status = 0 ;
+      uint16_t userAddress = 0 ;
+      if (queue.mEnabled) {
+        if (queue.mTransmit) {
+          status |= (queue.mCount < queue.mSize) ? (1 << 0) : 0 ; // Not full
+          status |= (queue.mCount == 0) ? (1 << 2) : 0 ; // Empty
+          userAddress = (uint16_t) (queue.mBase + queue.mHead * queue.mObjectSize) ;
+          if (((status & 1) != 0) && ((mMemory [con] & 1) != 0)) {
+            transmitFlags |= 1UL << q ;
+          }
+        }else{
+          status |= (queue.mCount > 0) ? (1 << 0) : 0 ; // Not empty
+          status |= (queue.mCount == queue.mSize) ? (1 << 2) : 0 ; // Full
+          status |= queue.mOverflow ? (1 << 3) : 0 ;
+          userAddress = (uint16_t) (queue.mBase + queue.mTail * queue.mObjectSize) ;
+          if (((status & 1) != 0) && ((mMemory [con] & 1) != 0)) {
+            receiveFlags |= 1UL << q ;
+          }
+        }
+        status |= ((queue.mCount * 2) >= queue.mSize) ? (1 << 1) : 0 ; // Half
+      }
+      mMemory [con + 1] = queue.mRequest ? (1 << 1) : 0 ;
+      setWord ((uint16_t) (con + 4), status) ;
+      setWord ((uint16_t) (con + 8), userAddress) ;
+    }
+    setWord (C1TXIF, transmitFlags) ;
+    setWord (C1RXIF, receiveFlags) ;
+    mMemory [C1INT] = (uint8_t) ((mMemory [C1INT] & 0xFC)
+      | ((transmitFlags != 0) ? (1 << 0) : 0)
+      | ((receiveFlags != 0) ? (1 << 1) : 0)) ;
+  }
+
+  private: bool interruptAsserted (void) const {
+    return ((mMemory [C1INT] & mMemory [C1INT + 2]) | (mMemory [C1INT + 1] & mMemory [C1INT + 3])) != 0 ;
+  }
+
+  private: void runInterruptServiceRoutine (void) {
+    uint32_t count = 0 ;
+    while ((mTransactionDepth == 0) && !mInInterruptServiceRoutine
+        && (NULL != mInterruptServiceRoutine) && interruptAsserted ()) {
+      mInInterruptServiceRoutine = true ;
+      mInterruptCount += 1 ;
+      advance (mInterruptEntryNanos) ;
+      mInterruptServiceRoutine () ;
+      mInInterruptServiceRoutine = false ;
+      count += 1 ;
+      if (count > 100000) {
+        printf ("MCP2517FDSimulator: isr does not deassert INT\n") ;
+        exit (1) ;
+      }
+    }
+  }
+
+//······················································································································
+//   BUS
+//······················································································································
+
+  private: void advance (const uint64_t inNanos) {
+    mNow += inNanos ;
+    while (mBusBusy && (mBusFrameEnd <= mNow)) {
+      endTransmission () ;
+      startTransmission () ;
+    }
+  }
+
+  private: bool transmitMode (void) const {
+    const uint8_t mode = mMemory [C1CON + 2] >> 5 ;
+    return (mode == 0) || (mode == 2) || (mode == 5) || (mode == 6) ;
+  }
+
+  private: void startTransmission (void) {
+    bool found = false ;
+    for (uint8_t q = 0 ; (q < kQueueCount) && !found && !mBusBusy && transmitMode () ; q++) {
+      const Queue & queue = mQueues [q] ;
+      found = queue.mEnabled && queue.mTransmit && queue.mRequest && (queue.mCount > 0) ;
+      if (found) {
+        const uint16_t object = (uint16_t) (0x400 + queue.mBase + queue.mTail * queue.mObjectSize) ;
+        const uint32_t flags = word (object + 4) ;
+        const uint32_t length = ((flags & (1 << 5)) != 0) ? 0 : (((flags & 0x0F) > 8) ? 8 : (flags & 0x0F)) ;
+        const uint32_t bitCount = (((flags & (1 << 4)) != 0) ? 67 : 47) + 8 * length ; // With interframe space
+        const uint32_t nbtcfg = word (C1NBTCFG) ;
+        const uint64_t tq = (uint64_t) ((nbtcfg >> 24) + 1) ;
+        const uint64_t bitTq = 1 + ((nbtcfg >> 16) & 0xFF) + 1 + ((nbtcfg >> 8) & 0x7F) + 1 ;
+        const uint64_t start = (mBusFrameEnd > mNow) ? mBusFrameEnd : mNow ;
+        mBusFrameEnd = start + bitCount * tq * bitTq * 1000 * 1000 * 1000 / mSysClock ;
+        mBusQueue = q ;
+        mBusBusy = true ;
+      }
+    }
+  }
+
+  private: void endTransmission (void) {
+    mBusBusy = false ;
+    Queue & queue = mQueues [mBusQueue] ;
+    const uint16_t object = (uint16_t) (0x400 + queue.mBase + queue.mTail * queue.mObjectSize) ;
+    queue.mTail = (uint8_t) ((queue.mTail + 1) % queue.mSize) ;
+    queue.mCount -= 1 ;
+    queue.mRequest = queue.mCount > 0 ;
+    mTransmittedFrameCount += 1 ;
+    const uint8_t mode = mMemory [C1CON + 2] >> 5 ;
+    if ((mode == 2) || (mode == 5)) { // Loop back
+      receive (object) ;
+    }
+    refresh () ;
+  }
+
+  private: void receive (const uint16_t inObject) {
+    const uint32_t identifier = word (inObject) ;
+    const uint32_t flags = word (inObject + 4) ;
+    const bool extended = (flags & (1 << 4)) != 0 ;
+    bool found = false ;
+    for (uint8_t f = 0 ; (f < 32) && !found ; f++) {
+      const uint8_t control = mMemory [C1FLTCON + f] ;
+      const uint32_t acceptance = word ((uint16_t) (C1FLTOBJ + 8 * f)) ;
+      const uint32_t mask = word ((uint16_t) (C1FLTOBJ + 8 * f + 4)) ;
+      found = ((control & (1 << 7)) != 0)
+        && (((identifier ^ acceptance) & mask & 0x1FFFFFFF) == 0)
+        && (((mask & (1UL << 30)) == 0) || (((acceptance & (1UL << 30)) != 0) == extended)) ;
+      const uint8_t q = control & 0x1F ;
+      if (found && (q < kQueueCount) && mQueues [q].mEnabled && !mQueues [q].mTransmit) {
+        Queue & queue = mQueues [q] ;
+        if (queue.mCount == queue.mSize) {
+          queue.mOverflow = true ;
+          mReceiveOverflowCount += 1 ;
+        }else{
+          const uint16_t object = (uint16_t) (0x400 + queue.mBase + queue.mHead * queue.mObjectSize) ;
+          setWord (object, identifier) ;
+          setWord ((uint16_t) (object + 4), (flags & 0x1FF) | ((uint32_t) f << 11)) ; // FILHIT
+          for (uint8_t i = 8 ; i < queue.mObjectSize ; i++) {
+            mMemory [object + i] = mMemory [inObject + i] ;
+          }
+          queue.mHead = (uint8_t) ((queue.mHead + 1) % queue.mSize) ;
+          queue.mCount += 1 ;
+          mReceivedFrameCount += 1 ;
+        }
+      }
+    }
+  }
+
+//······················································································································
+//   WORD ACCESS (little endian)
+//······················································································································
+
+  private: uint32_t word (const uint16_t inAddress) const {
+    return mMemory [inAddress]
+      | ((uint32_t) mMemory [inAddress + 1] << 8)
+      | ((uint32_t) mMemory [inAddress + 2] << 16)
+      | ((uint32_t) mMemory [inAddress + 3] << 24) ;
+  }
+
+  private: void setWord (const uint16_t inAddress, const uint32_t inValue) {
+    mMemory [inAddress] = (uint8_t) inValue ;
+    mMemory [inAddress + 1] = (uint8_t) (inValue >> 8) ;
+    mMemory [inAddress + 2] = (uint8_t) (inValue >> 16) ;
+    mMemory [inAddress + 3] = (uint8_t) (inValue >> 24) ;
+  }
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: MCP2517FDSimulator (const MCP2517FDSimulator &) ;
+  private: MCP2517FDSimulator & operator = (const MCP2517FDSimulator &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Host hooks
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+MCP2517FDSimulator * MCP2517FDSimulator::sCurrent = NULL ;
+
+SPIClass SPI ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint64_t gHostNanosWithoutSimulator = 0 ;
+
+uint64_t hostNanos (void) {
+  return (NULL == MCP2517FDSimulator::sCurrent) ? gHostNanosWithoutSimulator : MCP2517FDSimulator::sCurrent->now () ;
+}
+
+void hostElapse (const uint64_t inNanos) {
+  if (NULL == MCP2517FDSimulator::sCurrent) {
+    gHostNanosWithoutSimulator += inNanos ;
+  }else{
+    MCP2517FDSimulator::sCurrent->elapse (inNanos) ;
+  }
+}
+
+void hostDigitalWrite (const uint8_t inPin, const uint8_t inValue) {
+  if (NULL != MCP2517FDSimulator::sCurrent) {
+    MCP2517FDSimulator::sCurrent->pinWrite (inPin, inValue) ;
+  }
+}
+
+void hostSPIBeginTransaction (const uint32_t inClock) {
+  MCP2517FDSimulator::sCurrent->beginTransaction (inClock) ;
+}
+
+uint8_t hostSPITransfer (const uint8_t inByte) {
+  return MCP2517FDSimulator::sCurrent->transfer (inByte) ;
+}
+
+void hostSPIEndTransaction (void) {
+  MCP2517FDSimulator::sCurrent->endTransaction () ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
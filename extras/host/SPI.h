@@ -0,0 +1,64 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Host SPI library subset, for the host programs of extras/host (not an Arduino core)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_HOST_SPI_DEFINED
+#define ACAN2517_HOST_SPI_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <Arduino.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  A host program that simulates a controller defines these functions (see MCP2517FDSimulator.h)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void hostSPIBeginTransaction (const uint32_t inClock) ;
+uint8_t hostSPITransfer (const uint8_t inByte) ;
+void hostSPIEndTransaction (void) ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class SPISettings {
+  public: SPISettings (void) {}
+
+  public: SPISettings (const uint32_t inClock, const uint8_t, const uint8_t) :
+  mClock (inClock) {
+  }
+
+  public: uint32_t mClock = 4 * 1000 * 1000 ;
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class SPIClass {
+  public: void begin (void) {}
+
+  public: void usingInterrupt (const uint8_t) {}
+
+  public: void beginTransaction (const SPISettings & inSettings) { hostSPIBeginTransaction (inSettings.mClock) ; }
+
+  public: void endTransaction (void) { hostSPIEndTransaction () ; }
+
+  public: uint8_t transfer (const uint8_t inByte) { return hostSPITransfer (inByte) ; }
+
+  public: uint16_t transfer16 (const uint16_t inValue) {
+    uint16_t result = (uint16_t) (hostSPITransfer ((uint8_t) (inValue >> 8)) << 8) ;
+    result |= hostSPITransfer ((uint8_t) inValue) ;
+    return result ;
+  }
+} ;
+
+extern SPIClass SPI ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,149 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Host variant of the SignalDecodingBenchmark sketch: ACANSignal against bit by bit decoding
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// Build and run (from extras/host):
+//   g++ -std=gnu++11 -O2 -I. -I../../src SignalDecodingBenchmark.cpp -o signals
+//   ./signals
+//
+// First checks that both decoders agree on random payloads for every signal, then times the decoding of all
+// signals of a frame, on a set of random frames, with the host steady clock.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACANSignal.h>
+#include <cstdio>
+#include <cstdlib>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Signals: Intel and Motorola, in one 32-bit half, across both halves, and wider than 32 bits
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+typedef ACANSignal <24, 16, kIntel, false> EngineSpeed ;   // DBC: 24|16@1+
+typedef ACANSignal <13, 12, kMotorola, true> Temperature ; // DBC: 13|12@0-
+typedef ACANSignal <28, 8, kIntel, true> Torque ;          // DBC: 28|8@1-  (bits 28 ... 35)
+typedef ACANSignal <35, 16, kMotorola, false> Pressure ;   // DBC: 35|16@0+ (across data [4] ... data [6])
+typedef ACANSignal <8, 40, kIntel, false> Odometer ;       // DBC: 8|40@1+
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Bit by bit decoder (same as the sketch, extended to 64 bits and sign extension)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint64_t naiveDecode (const CANMessage & inFrame,
+                             const uint8_t inStartBit,
+                             const uint8_t inLength,
+                             const bool inIntel,
+                             const bool inSigned) {
+  uint64_t result = 0 ;
+  uint8_t bit = inStartBit ;
+  for (uint8_t i=0 ; i<inLength ; i++) {
+    const uint64_t bitValue = (inFrame.data [bit / 8] >> (bit % 8)) & 1 ;
+    if (inIntel) {
+      result |= bitValue << i ;
+      bit += 1 ;
+    }else{
+      result = (result << 1) | bitValue ;
+      bit = ((bit % 8) == 0) ? (bit + 15) : (bit - 1) ;
+    }
+  }
+  if (inSigned && (inLength < 64) && (((result >> (inLength - 1)) & 1) != 0)) {
+    result |= ~ ((((uint64_t) 1) << inLength) - 1) ;
+  }
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint64_t naiveFrame (const CANMessage & inFrame) {
+  return naiveDecode (inFrame, 24, 16, true, false)
+       + naiveDecode (inFrame, 13, 12, false, true)
+       + naiveDecode (inFrame, 28, 8, true, true)
+       + naiveDecode (inFrame, 35, 16, false, false)
+       + naiveDecode (inFrame, 8, 40, true, false) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint64_t signalFrame (const CANMessage & inFrame) {
+  return (uint64_t) EngineSpeed::rawValue (inFrame)
+       + (uint64_t) (int64_t) Temperature::rawValue (inFrame)
+       + (uint64_t) (int64_t) Torque::rawValue (inFrame)
+       + (uint64_t) Pressure::rawValue (inFrame)
+       + (uint64_t) Odometer::rawValue (inFrame) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint32_t FRAME_COUNT = 1024 ; // Power of 2
+static const uint32_t ITERATIONS = 20 * 1000 * 1000 ;
+
+static CANMessage gFrames [FRAME_COUNT] ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint32_t check (void) {
+  uint32_t errorCount = 0 ;
+  for (uint32_t f = 0 ; f < FRAME_COUNT ; f++) {
+    const CANMessage & frame = gFrames [f] ;
+    if (((uint64_t) EngineSpeed::rawValue (frame) != naiveDecode (frame, 24, 16, true, false))
+     || ((uint64_t) (int64_t) Temperature::rawValue (frame) != naiveDecode (frame, 13, 12, false, true))
+     || ((uint64_t) (int64_t) Torque::rawValue (frame) != naiveDecode (frame, 28, 8, true, true))
+     || ((uint64_t) Pressure::rawValue (frame) != naiveDecode (frame, 35, 16, false, false))
+     || ((uint64_t) Odometer::rawValue (frame) != naiveDecode (frame, 8, 40, true, false))) {
+      errorCount += 1 ;
+    }
+  }
+//--- Insertion: write back every signal in a cleared frame, other bits must stay 0
+  for (uint32_t f = 0 ; f < FRAME_COUNT ; f++) {
+    const CANMessage & frame = gFrames [f] ;
+    CANMessage copy ;
+    copy.data64 = 0 ;
+    EngineSpeed::setRawValue (copy, EngineSpeed::rawValue (frame)) ;
+    Temperature::setRawValue (copy, Temperature::rawValue (frame)) ;
+    Pressure::setRawValue (copy, Pressure::rawValue (frame)) ;
+    if ((EngineSpeed::rawValue (copy) != EngineSpeed::rawValue (frame))
+     || (Temperature::rawValue (copy) != Temperature::rawValue (frame))
+     || (Pressure::rawValue (copy) != Pressure::rawValue (frame))) {
+      errorCount += 1 ;
+    }
+  }
+  return errorCount ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+template <typename DECODER> static double nanosPerFrame (DECODER inDecoder, uint64_t & ioSink) {
+  const uint64_t start = hostNanos () ;
+  for (uint32_t i=0 ; i<ITERATIONS ; i++) {
+    ioSink += inDecoder (gFrames [i & (FRAME_COUNT - 1)]) ;
+  }
+  return (double) (hostNanos () - start) / ITERATIONS ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+int main (void) {
+  srand (2517) ;
+  for (uint32_t f = 0 ; f < FRAME_COUNT ; f++) {
+    gFrames [f].len = 8 ;
+    for (uint8_t i = 0 ; i < 8 ; i++) {
+      gFrames [f].data [i] = (uint8_t) rand () ;
+    }
+  }
+  const uint32_t errorCount = check () ;
+  printf ("Check: %u frames, %u errors\n", FRAME_COUNT, errorCount) ;
+  volatile uint64_t sink = 0 ;
+  uint64_t naiveSink = 0 ;
+  uint64_t signalSink = 0 ;
+  const double naive = nanosPerFrame (naiveFrame, naiveSink) ;
+  const double signal = nanosPerFrame (signalFrame, signalSink) ;
+  sink = naiveSink + signalSink ;
+  (void) sink ;
+  printf ("5 signals per frame (16, 12, 8, 16 and 40 bits)\n") ;
+  printf ("  Bit by bit: %.2f ns per frame\n", naive) ;
+  printf ("  ACANSignal: %.2f ns per frame (x%.1f)\n", signal, naive / signal) ;
+  printf ("%s\n", ((errorCount == 0) && (naiveSink == signalSink)) ? "PASS" : "FAIL") ;
+  return (errorCount == 0) && (naiveSink == signalSink) ? 0 : 1 ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
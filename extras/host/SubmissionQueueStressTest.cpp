@@ -0,0 +1,191 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Multi-threaded host stress test of ACAN2517SubmissionQueue
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// Build and run (from extras/host):
+//   g++ -std=gnu++11 -O2 -pthread -fsanitize=thread -I. -I../../src SubmissionQueueStressTest.cpp -o stress
+//   ./stress
+//
+// Producer threads push numbered frames and then run the ACAN2517::flushSubmissionQueue protocol (acquire the
+// consumer role, drain into a bounded driver buffer, release, retry while queue is not empty unless "transmit
+// FIFO not full" interrupt is enabled). An "isr" thread plays the controller: while the driver buffer is not
+// empty (the interrupt is enabled), it sends one frame and runs the isr drain protocol. The test runs short rounds (every
+// producer pushes a few frames); after each round, once the driver buffer is empty, a frame left in the queue
+// is stranded: it would never be sent, as no interrupt is pending and no producer flushes anymore. Checks: every
+// accepted frame is sent exactly once, in push order for each producer, and no frame is ever stranded.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517SubmissionQueue.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint32_t kProducerCount = 6 ;
+static const uint32_t kRoundCount = 5000 ;
+static const uint32_t kFramesPerRound = 4 ; // Per producer
+static const uint32_t kQueueSize = 16 ;
+static const size_t kDriverBufferSize = 8 ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Driver transmit buffer: the mutex plays the SPI transaction (isr and task never run it concurrently)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static ACAN2517SubmissionQueue gQueue ;
+static std::mutex gSPI ;
+static std::vector <CANMessage> gDriverBuffer ;
+static std::atomic <uint32_t> gDriverBufferCount (0) ;
+
+//--- Preemption point: a task may be preempted anywhere; yielding here widens the race windows
+static void preemptionPoint (void) {
+  static thread_local uint32_t seed = (uint32_t) (size_t) &seed ;
+  seed = seed * 1103515245 + 12345 ;
+  if ((seed >> 16) % 3 == 0) {
+    std::this_thread::yield () ;
+  }
+}
+
+//--- "Transmit FIFO not full" interrupt is enabled (mControllerTxFIFOFull)
+static bool interruptEnabled (void) {
+  return gDriverBufferCount.load () > 0 ;
+}
+
+//--- Same as ACAN2517::drainSubmissionQueue
+static void drainSubmissionQueue (void) {
+  CANMessage message ;
+  bool ok = true ;
+  while (ok && gQueue.peek (message)) {
+    ok = gDriverBuffer.size () < kDriverBufferSize ;
+    if (ok) {
+      gDriverBuffer.push_back (message) ;
+      gDriverBufferCount.store ((uint32_t) gDriverBuffer.size ()) ;
+      gQueue.pop () ;
+    }
+  }
+}
+
+//--- Same as ACAN2517::flushSubmissionQueue
+static void flushSubmissionQueue (void) {
+  bool retry = true ;
+  while (retry && gQueue.tryAcquireConsumer ()) {
+    { std::lock_guard <std::mutex> lock (gSPI) ;
+      drainSubmissionQueue () ;
+    }
+    preemptionPoint () ;
+    gQueue.releaseConsumer () ;
+    retry = !interruptEnabled () && !gQueue.isEmpty () ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static std::atomic <bool> gDone (false) ;
+static std::vector <uint32_t> gNextSequence (kProducerCount, 0) ;
+static uint64_t gSentCount = 0 ;
+static uint64_t gOrderErrorCount = 0 ;
+
+static void isrThread (void) {
+  while (!gDone.load ()) {
+    if (interruptEnabled ()) {
+      std::lock_guard <std::mutex> lock (gSPI) ;
+      const CANMessage message = gDriverBuffer.front () ;
+      gDriverBuffer.erase (gDriverBuffer.begin ()) ;
+      gDriverBufferCount.store ((uint32_t) gDriverBuffer.size ()) ;
+      const uint32_t producer = message.id ;
+      if (message.data32 [0] != gNextSequence [producer]) {
+        gOrderErrorCount += 1 ;
+      }
+      gNextSequence [producer] = message.data32 [0] + 1 ;
+      gSentCount += 1 ;
+    //--- isr drain protocol (consumer role already held by a task: skip)
+      bool retry = true ;
+      while (retry && gQueue.tryAcquireConsumer ()) {
+        drainSubmissionQueue () ;
+        gQueue.releaseConsumer () ;
+        retry = !interruptEnabled () && !gQueue.isEmpty () ;
+      }
+    }else{
+      std::this_thread::yield () ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static std::vector <uint32_t> gPushedCount (kProducerCount, 0) ;
+
+static void producerThread (const uint32_t inProducer) {
+  uint32_t pushed = 0 ;
+  while (pushed < kFramesPerRound) {
+    CANMessage message ;
+    message.id = inProducer ;
+    message.data32 [0] = gPushedCount [inProducer] ;
+    if (gQueue.push (message)) { // A rejected frame is pushed again (send with time out)
+      gPushedCount [inProducer] += 1 ;
+      pushed += 1 ;
+      preemptionPoint () ;
+      flushSubmissionQueue () ;
+    }else{
+      std::this_thread::yield () ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+int main (void) {
+  gQueue.initWithSize (kQueueSize) ;
+  std::thread isr (isrThread) ;
+  uint32_t strandedRoundCount = 0 ;
+  for (uint32_t round = 0 ; round < kRoundCount ; round++) {
+    std::vector <std::thread> producers ;
+    for (uint32_t p = 0 ; p < kProducerCount ; p++) {
+      producers.push_back (std::thread (producerThread, p)) ;
+    }
+    for (uint32_t p = 0 ; p < kProducerCount ; p++) {
+      producers [p].join () ;
+    }
+  //--- Wait until isr has sent every frame of driver buffer; then the queue should be empty
+    bool wait = true ;
+    while (wait) {
+      std::this_thread::yield () ;
+      std::lock_guard <std::mutex> lock (gSPI) ;
+      wait = !gDriverBuffer.empty () ;
+    }
+    if (!gQueue.isEmpty ()) {
+      strandedRoundCount += 1 ;
+      flushSubmissionQueue () ; // Recover for next round
+    }
+  }
+//--- Wait until every frame is sent
+  bool wait = true ;
+  while (wait) {
+    std::this_thread::yield () ;
+    std::lock_guard <std::mutex> lock (gSPI) ;
+    wait = !gDriverBuffer.empty () || !gQueue.isEmpty () ;
+  }
+  gDone.store (true) ;
+  isr.join () ;
+//--- Results
+  uint64_t pushedCount = 0 ;
+  for (uint32_t p = 0 ; p < kProducerCount ; p++) {
+    pushedCount += gPushedCount [p] ;
+  }
+  printf ("producers %u, rounds %u, accepted %llu, sent %llu, queue full rejections %u, order errors %llu, stranded rounds %u\n",
+          kProducerCount,
+          kRoundCount,
+          (unsigned long long) pushedCount,
+          (unsigned long long) gSentCount,
+          gQueue.rejectedCount (),
+          (unsigned long long) gOrderErrorCount,
+          strandedRoundCount) ;
+  const bool ok = (pushedCount == gSentCount) && (gOrderErrorCount == 0) && (strandedRoundCount == 0) ;
+  printf ("%s\n", ok ? "PASS" : "FAIL") ;
+  return ok ? 0 : 1 ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
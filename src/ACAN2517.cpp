@@ -6,6 +6,7 @@
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 #include <ACAN2517.h>
+#include <ACAN2517CRC.h>
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 // ACAN2517 register addresses
@@ -32,6 +33,7 @@ static const uint16_t C1TXQUA_REGISTER    = 0x058 ;
 //······················································································································
 
 static const uint16_t C1INT_REGISTER = 0x01C ;
+static const uint16_t C1TXIF_REGISTER = 0x024 ;
 
 //······················································································································
 //   FIFO REGISTERS
@@ -85,12 +87,47 @@ static const uint16_t OSC_REGISTER   = 0xE00 ;
 
 static const uint16_t IOCON_REGISTER = 0xE04 ;
 
+//······················································································································
+//   CRC AND ECC REGISTERS (DS20005688B, pages 19 to 21)
+//······················································································································
+
+static const uint16_t CRC_REGISTER     = 0xE08 ;
+static const uint16_t ECCCON_REGISTER  = 0xE0C ;
+static const uint16_t ECCSTAT_REGISTER = 0xE10 ;
+
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 //    RECEIVE FIFO INDEX
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 static const uint8_t receiveFIFOIndex = 1 ;
 
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//    SPI INTEGRITY
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+//--- Attempts of a READ_CRC, or of a frame WRITE_CRC, before an error is reported
+static const uint8_t kSPICRCAttemptCount = 3 ;
+
+//--- Byte order of controller words is little endian
+static inline uint32_t wordFromBytes (const uint8_t inBytes []) {
+  return inBytes [0]
+    | (((uint32_t) inBytes [1]) <<  8)
+    | (((uint32_t) inBytes [2]) << 16)
+    | (((uint32_t) inBytes [3]) << 24) ;
+}
+
+static inline void bytesFromWord (const uint32_t inValue, uint8_t outBytes []) {
+  outBytes [0] = (uint8_t) inValue ;
+  outBytes [1] = (uint8_t) (inValue >>  8) ;
+  outBytes [2] = (uint8_t) (inValue >> 16) ;
+  outBytes [3] = (uint8_t) (inValue >> 24) ;
+}
+
+//--- Length byte of READ_CRC and WRITE_CRC: data byte count for SFR, data word count for RAM
+static inline uint8_t crcLengthByte (const uint16_t inAddress, const uint8_t inLength) {
+  return ((inAddress >= 0x400) && (inAddress < 0xC00)) ? (uint8_t) (inLength / 4) : inLength ;
+}
+
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 ACAN2517::ACAN2517 (const uint8_t inCS, // CS input of MCP2517FD
@@ -122,6 +159,35 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
 uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
                           void (* inInterruptServiceRoutine) (void),
                           const ACAN2517Filters & inFilters) {
+  return internalBegin (inSettings,
+                        inInterruptServiceRoutine,
+                        &inFilters,
+                        NULL,
+                        inFilters.filterCount (),
+                        inFilters.filterStatus () == ACAN2517Filters::kFiltersOk) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
+                          void (* inInterruptServiceRoutine) (void),
+                          const ACAN2517Filter * inFilters,
+                          const uint8_t inFilterCount) {
+  bool filtersOk = true ;
+  for (uint8_t i=0 ; (i<inFilterCount) && filtersOk ; i++) {
+    filtersOk = inFilters [i].mFilterStatus == ACAN2517Filters::kFiltersOk ;
+  }
+  return internalBegin (inSettings, inInterruptServiceRoutine, NULL, inFilters, inFilterCount, filtersOk) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::internalBegin (const ACAN2517Settings & inSettings,
+                                  void (* inInterruptServiceRoutine) (void),
+                                  const ACAN2517Filters * inFilterList,
+                                  const ACAN2517Filter * inFilterArray,
+                                  const uint32_t inFilterCount,
+                                  const bool inFiltersOk) {
   uint32_t errorCode = 0 ; // Means no error
 //----------------------------------- If ok, check if settings are correct
   if (!inSettings.mBitRateClosedToDesiredRate) {
@@ -172,16 +238,20 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
     errorCode |= kControllerRamUsageGreaterThan2048 ;
   }
 //----------------------------------- Check Filter definition
-  if (inFilters.filterCount () > 32) {
+  if (inFilterCount > 32) {
     errorCode |= kMoreThan32Filters ;
   }
-  if (inFilters.filterStatus () != ACAN2517Filters::kFiltersOk) {
+  if (!inFiltersOk) {
     errorCode |= kFilterDefinitionError ;
   }
 //----------------------------------- CS pin
   if (errorCode == 0) {
+    ACAN2517_PROFILE_INIT () ;
     pinMode (mCS, OUTPUT) ;
+    mFastChipSelect = false ;
     deassertCS () ;
+    setUpFastChipSelect (inSettings.mUseFastChipSelect) ;
+    mSPICRC = false ; // Plain SPI instructions until controller is reset
   //----------------------------------- Set SPI clock to 1 MHz
     mSPISettings = SPISettings (1 * 1000 * 1000, MSBFIRST, SPI_MODE0) ;
   //----------------------------------- Request configuration
@@ -199,6 +269,13 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
     }
   //----------------------------------- Reset MCP2517FD (allways use a 1 MHz clock)
     reset2517FD () ;
+  //----------------------------------- SPI integrity: CRC protected instructions from now, enable RAM ECC
+  //    before RAM is written (ECCCON, CRC registers, DS20005688B, pages 19 and 20)
+    mSPICRC = inSettings.mSPIIntegrity ;
+    if (mSPICRC) {
+      writeByteRegister (ECCCON_REGISTER, (1 << 0) | (1 << 1) | (1 << 2)) ; // ECCEN, SECIE, DEDIE
+      writeByteRegister (CRC_REGISTER + 3, (1 << 0) | (1 << 1)) ; // CRCERRIE, FERRIE
+    }
   }
 //----------------------------------- Check SPI connection is on (with a 1 MHz clock)
 // We write and the read back 2517 RAM at address 0x400
@@ -252,8 +329,12 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
       }
     }
   }
-//----------------------------------- Set full speed clock
-  mSPISettings = SPISettings (inSettings.sysClock () / 2, MSBFIRST, SPI_MODE0) ;
+//----------------------------------- Set full speed clock (or requested clock, if lower)
+  const uint32_t maxSPIClock = inSettings.sysClock () / 2 ;
+  const uint32_t SPIClock = ((inSettings.mSPIClock == 0) || (inSettings.mSPIClock > maxSPIClock))
+    ? maxSPIClock
+    : inSettings.mSPIClock ;
+  mSPISettings = SPISettings (SPIClock, MSBFIRST, SPI_MODE0) ;
 //----------------------------------- Checking SPI connection is on (with a full speed clock)
 //    We write and the read back 2517 RAM at address 0x400
   for (uint32_t i=1 ; (i != 0) && (errorCode == 0) ; i <<= 1) {
@@ -266,10 +347,15 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
 //----------------------------------- Install interrupt, configure external interrupt
   if (errorCode == 0) {
     pinMode (mINT, INPUT_PULLUP) ;
+    mInterruptServiceRoutine = inInterruptServiceRoutine ;
+    mDeferredInterruptPending = false ;
     attachInterrupt (itPin, inInterruptServiceRoutine, LOW) ;
     mSPI.usingInterrupt (itPin) ;
   //----------------------------------- Configure transmit and receive buffers
-    mDriverTransmitBuffer.initWithSize (inSettings.mDriverTransmitFIFOSize) ;
+    mDriverTransmitBuffer.initWithSize (inSettings.mDriverTransmitFIFOSize,
+                                        inSettings.mDriverTransmitBufferInPriorityOrder
+                                          ? ACAN2517TransmitBuffer::PriorityOrder
+                                          : ACAN2517TransmitBuffer::FIFOOrder) ;
     mDriverReceiveBuffer.initWithSize (inSettings.mDriverReceiveFIFOSize) ;
   //----------------------------------- Reset RAM
     for (uint16_t address = 0x400 ; address < 0xC00 ; address += 4) {
@@ -296,6 +382,7 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
   // Bit 5-7: Payload Size bits ---> 0: 8 data bytes
   // Bit 4-0: TXQ size ---> 0: Don’t save transmitted messages in TEF
     mUsesTXQ = inSettings.mControllerTXQSize > 0 ;
+    mTXQNotFullInterruptEnabled = false ; // TXQ interrupts are disabled by reset
     d = inSettings.mControllerTXQSize - 1 ;
     writeByteRegister (C1TXQCON_REGISTER + 3, d); // DS20005688B, page 48
   //----------------------------------- Configure TXQ and TEF
@@ -318,24 +405,56 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
     d = 1 << 7 ; // FIFO 2 is a Tx FIFO
     writeByteRegister (C1FIFOCON_REGISTER (2), d) ;
   //----------------------------------- Configure receive filters
-    uint8_t filterIndex = 0 ;
-    ACAN2517Filters::Filter * filter = inFilters.mFirstFilter ;
-    mCallBackFunctionArray = new ACANCallBackRoutine [inFilters.filterCount ()] ;
-    while (NULL != filter) {
-      mCallBackFunctionArray [filterIndex] = filter->mCallBackRoutine ;
-      writeRegister (C1MASK_REGISTER (filterIndex), filter->mFilterMask) ; // DS20005688B, page 61
-      writeRegister (C1FLTOBJ_REGISTER (filterIndex), filter->mAcceptanceFilter) ; // DS20005688B, page 60
+  //    A filter list is copied (call back routines in a 32 entry array, sized for runtime filter changes),
+  //    a filter array is referenced
+    if (mCallBackFunctionArray != mStaticCallBackArray) {
+      delete [] mCallBackFunctionArray ;
+    }
+    mCallBackFunctionArray = NULL ;
+    mFilterArray = inFilterArray ;
+    mFilterCount = (uint8_t) inFilterCount ;
+    const ACAN2517Filters::Filter * filter = (NULL == inFilterList) ? NULL : inFilterList->mFirstFilter ;
+    if (NULL != inFilterList) {
+      mCallBackFunctionArray = newCallBackFunctionArray () ;
+    }
+    for (uint8_t filterIndex = 0 ; filterIndex < inFilterCount ; filterIndex++) {
+      uint32_t mask ;
+      uint32_t acceptance ;
+      if (NULL != filter) {
+        mCallBackFunctionArray [filterIndex] = filter->mCallBackRoutine ;
+        mask = filter->mFilterMask ;
+        acceptance = filter->mAcceptanceFilter ;
+        filter = filter->mNextFilter ;
+      }else{
+        mask = inFilterArray [filterIndex].mFilterMask ;
+        acceptance = inFilterArray [filterIndex].mAcceptanceFilter ;
+      }
+      writeRegister (C1MASK_REGISTER (filterIndex), mask) ; // DS20005688B, page 61
+      writeRegister (C1FLTOBJ_REGISTER (filterIndex), acceptance) ; // DS20005688B, page 60
       d = 1 << 7 ; // Filter is enabled
       d |= 1 ; // Message matching filter is stored in FIFO1
       writeByteRegister (C1FLTCON_REGISTER (filterIndex), d) ; // DS20005688B, page 58
-      filter = filter->mNextFilter ;
-      filterIndex += 1 ;
     }
+  //----------------------------------- Bus off recovery policy
+    mBusOffRecovery = inSettings.mBusOffRecovery ;
+    mFlushTransmitBuffersOnBusOff = inSettings.mFlushTransmitBuffersOnBusOff ;
+    mRequestedMode = inSettings.mRequestedMode ;
+    mBusOffRestartPhase = kNoRestart ;
+    mErrorState = ErrorActive ;
   //----------------------------------- Activate interrupts (C1INT, DS20005688B page 34)
     d  = (1 << 1) ; // Receive FIFO Interrupt Enable
     d |= (1 << 0) ; // Transmit FIFO Interrupt Enable
+    if (mBusOffRecovery != ACAN2517Settings::BusOffAutomaticRecovery) {
+      d |= (1 << 3) ; // Mode Change Interrupt Enable, for restarting after bus off
+    }
     writeByteRegister (C1INT_REGISTER + 2, d) ;
-    writeByteRegister (C1INT_REGISTER + 3, 0) ;
+    d  = (1 << 5) ; // CAN Bus Error Interrupt Enable
+    d |= (1 << 7) ; // Invalid Message Interrupt Enable
+    if (mSPICRC) {
+      d |= (1 << 0) ; // ECC Error Interrupt Enable
+      d |= (1 << 1) ; // SPI CRC Error Interrupt Enable
+    }
+    writeByteRegister (C1INT_REGISTER + 3, d) ;
   //----------------------------------- Program nominal data rate (C1NBTCFG register)
   //  bits 31-24: BRP - 1
   //  bits 23-16: TSEG1 - 1
@@ -343,14 +462,9 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
   //  bits 14-8: TSEG2 - 1
   //  bit 7: unused
   //  bit 6-0: SJW - 1
-    uint32_t data = inSettings.mBitRatePrescaler - 1 ;
-    data <<= 8 ;
-    data |= inSettings.mPhaseSegment1 - 1 ;
-    data <<= 8 ;
-    data |= inSettings.mPhaseSegment2 - 1 ;
-    data <<= 8 ;
-    data |= inSettings.mSJW - 1 ;
-    writeRegister (C1NBTCFG_REGISTER, data);
+    mNominalBitTiming = nominalBitTiming (inSettings) ;
+    mSysClock = inSettings.sysClock () ;
+    writeRegister (C1NBTCFG_REGISTER, mNominalBitTiming);
   //----------------------------------- Request mode (C1CON_REGISTER + 3)
   //  bits 7-4: Transmit Bandwith Sharing Bits ---> 0
   //  bit 3: Abort All Pending Transmissions bit --> 0
@@ -376,37 +490,140 @@ uint32_t ACAN2517::begin (const ACAN2517Settings & inSettings,
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 bool ACAN2517::tryToSend (const CANMessage & inMessage) {
-//--- Workaround: the Teensy 3.5 / 3.6 "SPI.usingInterrupt" bug
-//    https://github.com/PaulStoffregen/SPI/issues/35
-  #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
-    noInterrupts () ;
-  #endif
-    mSPI.beginTransaction (mSPISettings) ;
-      bool result = false ;
-      if (inMessage.idx == 0) {
-        result = enterInTransmitBuffer (inMessage) ;
-      }else if (inMessage.idx == 255) {
-        result = sendViaTXQ (inMessage) ;
-      }
-    mSPI.endTransaction () ;
-  #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
-    interrupts () ;
-  #endif
+  ACAN2517_PROFILE_BEGIN (TryToSend) ;
+  bool result = false ;
+  if ((inMessage.idx == 0) && (NULL != mSubmissionQueue)) { // Multi producer path
+    result = mSubmissionQueue->push (inMessage) ;
+    if (result) {
+      flushSubmissionQueue () ;
+    }
+  }else{
+    lockDeferredWork () ;
+  //--- Workaround: the Teensy 3.5 / 3.6 "SPI.usingInterrupt" bug
+  //    https://github.com/PaulStoffregen/SPI/issues/35
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      noInterrupts () ;
+    #endif
+      mSPI.beginTransaction (mSPISettings) ;
+        if (inMessage.idx == 0) {
+          result = enterInTransmitBuffer (inMessage, false) ;
+        }else if (inMessage.idx == 255) {
+          result = sendViaTXQ (inMessage) ;
+        }
+      mSPI.endTransaction () ;
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      interrupts () ;
+    #endif
+    unlockDeferredWork () ;
+  }
+  ACAN2517_PROFILE_END (TryToSend) ;
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::flushSubmissionQueue (void) {
+//--- Consumer role is acquired outside the SPI transaction, so an isr that runs meanwhile skips the queue,
+//    and a producer that pushes meanwhile fails to acquire it: after release, retry while queue is not empty,
+//    unless "transmit FIFO not full" interrupt is enabled (its isr acquires the released role, and moves
+//    remaining frames). The flag is read after release: an isr that skipped the queue may have disabled it.
+  bool retry = true ;
+  while (retry && mSubmissionQueue->tryAcquireConsumer ()) {
+    lockDeferredWork () ;
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      noInterrupts () ;
+    #endif
+      mSPI.beginTransaction (mSPISettings) ;
+        drainSubmissionQueue () ;
+      mSPI.endTransaction () ;
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      interrupts () ;
+    #endif
+    unlockDeferredWork () ;
+    mSubmissionQueue->releaseConsumer () ;
+    retry = !mControllerTxFIFOFull && !mSubmissionQueue->isEmpty () ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::drainSubmissionQueue (void) {
+//--- Consumer role owner only. Stops when driver transmit buffer is full: remaining frames are moved by isr,
+//    as "transmit FIFO not full" interrupt is enabled
+  CANMessage message ;
+  bool ok = true ;
+  while (ok && mSubmissionQueue->peek (message)) {
+    ok = enterInTransmitBuffer (message, false) ;
+    if (ok) {
+      mSubmissionQueue->pop () ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::send (const CANMessage & inMessage, const uint32_t inTimeOutMicros) {
+  const uint32_t start = micros () ;
+  bool ok = tryToSend (inMessage) ;
+  uint32_t elapsed = 0 ;
+  while (!ok && (elapsed < inTimeOutMicros)) {
+    waitForEvent (inTimeOutMicros - elapsed) ;
+    ok = tryToSend (inMessage) ;
+    elapsed = micros () - start ;
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::waitForEvent (const uint32_t inMaxMicros) {
+  if (NULL == mWait) {
+    yield () ;
+  }else{
+    mWait->wait (inMaxMicros) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::tryToSendLatestValue (const CANMessage & inMessage) {
+//--- As in tryToSend, INT is masked during the SPI transaction (SPI.usingInterrupt): isr does not read a driver
+//    transmit buffer slot while it is replaced
+  lockDeferredWork () ;
+  //--- Workaround: the Teensy 3.5 / 3.6 "SPI.usingInterrupt" bug
+  //    https://github.com/PaulStoffregen/SPI/issues/35
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      noInterrupts () ;
+    #endif
+      mSPI.beginTransaction (mSPISettings) ;
+        const bool result = enterInTransmitBuffer (inMessage, true) ;
+      mSPI.endTransaction () ;
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      interrupts () ;
+    #endif
+  unlockDeferredWork () ;
   return result ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-bool ACAN2517::enterInTransmitBuffer (const CANMessage & inMessage) {
+bool ACAN2517::enterInTransmitBuffer (const CANMessage & inMessage, const bool inLatestValue) {
   bool result ;
   if (mControllerTxFIFOFull) {
-    result = mDriverTransmitBuffer.append (inMessage) ;
+    result = inLatestValue
+      ? mDriverTransmitBuffer.appendLatestValue (inMessage)
+      : mDriverTransmitBuffer.append (inMessage) ;
   }else{
-    result = true ;
-    appendInControllerTxFIFO (inMessage) ;
-  //--- If controller FIFO is full, enable "FIFO not full" interrupt
+    result = appendInControllerTxFIFO (inMessage) ;
+  //--- If frame could not be written (CRC errors), it is kept in driver transmit buffer, and isr writes it again
+    if (!result) {
+      result = inLatestValue
+        ? mDriverTransmitBuffer.appendLatestValue (inMessage)
+        : mDriverTransmitBuffer.append (inMessage) ;
+    }
+  //--- If controller FIFO is full, or frame is pending in driver transmit buffer, enable "FIFO not full" interrupt
     const uint8_t status = readByteRegisterSPI (C1FIFOSTA_REGISTER (2)) ;
-    if ((status & 1) == 0) { // FIFO is full
+    if (((status & 1) == 0) || (mDriverTransmitBuffer.count () > 0)) { // FIFO is full, or frame is pending
       uint8_t d = 1 << 7 ;  // FIFO is a transmit FIFO
       d |= 1 ; // Enable "FIFO not full" interrupt
       writeByteRegisterSPI (C1FIFOCON_REGISTER (2), d) ;
@@ -418,59 +635,255 @@ bool ACAN2517::enterInTransmitBuffer (const CANMessage & inMessage) {
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-void ACAN2517::appendInControllerTxFIFO (const CANMessage & inMessage) {
-  const uint16_t ramAddress = (uint16_t) (0x400 + readRegisterSPI (C1FIFOUA_REGISTER (2))) ;
-  assertCS () ;
-    writeCommandSPI (ramAddress) ;
-  //--- Write identifier (see DS20005678A, page 25)
-    writeWordSPI (inMessage.id) ;
-  //--- Write DLC, RTR, IDE bits
-    uint32_t data = (inMessage.len > 8) ? 8 : inMessage.len ;
-    if (inMessage.rtr) {
-      data |= 1 << 5 ; // Set RTR bit
-    }
-    if (inMessage.ext) {
-      data |= 1 << 4 ; // Set EXT bit
-    }
-    writeWordSPI (data) ;
-  //--- Write data (Swap data if processor is big endian)
-    writeWordSPI (inMessage.data32 [0]) ;
-    writeWordSPI (inMessage.data32 [1]) ;
-  deassertCS () ;
-//--- Increment FIFO, send message (see DS20005688B, page 48)
-  const uint8_t d = (1 << 0) | (1 << 1) ; // Set UINC bit, TXREQ bit
-  writeByteRegisterSPI (C1FIFOCON_REGISTER (2) + 1, d);
+bool ACAN2517::appendInControllerTxFIFO (const CANMessage & inMessage) {
+  const bool ok = writeTransmitObjectSPI (C1FIFOUA_REGISTER (2), inMessage)
+    && releaseTransmitObjectSPI (C1FIFOCON_REGISTER (2)) ;
+  if (ok) {
+  //--- Statistics, trace
+    if (NULL != mStatistics) {
+      mStatistics->recordFrame (inMessage, false) ;
+    }
+    if (NULL != mFrameTraceCallBack) {
+      mFrameTraceCallBack (inMessage, FrameWrittenInController) ;
+    }
+  }else{
+    mSPICRCLostFrameCount += 1 ;
+  }
+  return ok ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 bool ACAN2517::sendViaTXQ (const CANMessage & inMessage) {
+  return controllerTXQIsNotFull () && appendInControllerTXQ (inMessage) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::controllerTXQIsNotFull (void) {
 //--- Enter message only if TXQ FIFO is not full (see DS20005688B, page 50)
-  const bool TXQNotFull = mUsesTXQ && (readByteRegisterSPI (C1TXQSTA_REGISTER) & 1) != 0 ;
-  if (TXQNotFull) {
-    const uint16_t ramAddress = (uint16_t) (0x400 + readRegisterSPI (C1TXQUA_REGISTER)) ;
+  return mUsesTXQ
+    && (mBusOffRestartPhase == kNoRestart)
+    && (readByteRegisterSPI (C1TXQSTA_REGISTER) & 1) != 0 ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::appendInControllerTXQ (const CANMessage & inMessage) {
+  const bool ok = writeTransmitObjectSPI (C1TXQUA_REGISTER, inMessage)
+    && releaseTransmitObjectSPI (C1TXQCON_REGISTER) ;
+  if (ok) {
+  //--- Statistics, trace
+    if (NULL != mStatistics) {
+      mStatistics->recordFrame (inMessage, false) ;
+    }
+    if (NULL != mFrameTraceCallBack) {
+      mFrameTraceCallBack (inMessage, FrameWrittenInController) ;
+    }
+  }else{
+    mSPICRCLostFrameCount += 1 ;
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::writeTransmitObjectSPI (const uint16_t inUARegister, const CANMessage & inMessage) {
+//--- Write frame at user address of transmit FIFO or TXQ (returns false if it cannot be written without CRC error)
+//--- DLC, RTR, IDE bits
+  uint32_t flags = (inMessage.len > 8) ? 8 : inMessage.len ;
+  if (inMessage.rtr) {
+    flags |= 1 << 5 ; // Set RTR bit
+  }
+  if (inMessage.ext) {
+    flags |= 1 << 4 ; // Set EXT bit
+  }
+  bool ok = true ;
+  if (!mSPICRC) {
+    const uint16_t ramAddress = (uint16_t) (0x400 + readRegisterSPI (inUARegister)) ;
     assertCS () ;
       writeCommandSPI (ramAddress) ;
     //--- Write identifier (see DS20005678A, page 25)
       writeWordSPI (inMessage.id) ;
     //--- Write DLC, RTR, IDE bits
-      uint32_t data = (inMessage.len > 8) ? 8 : inMessage.len ;
-      if (inMessage.rtr) {
-        data |= 1 << 5 ; // Set RTR bit
-      }
-      if (inMessage.ext) {
-        data |= 1 << 4 ; // Set EXT bit
-      }
-      writeWordSPI (data) ;
+      writeWordSPI (flags) ;
     //--- Write data (Swap data if processor is big endian)
       writeWordSPI (inMessage.data32 [0]) ;
       writeWordSPI (inMessage.data32 [1]) ;
     deassertCS () ;
-  //--- Increment FIFO, send message (see DS20005688B, page 48)
-    const uint8_t d = (1 << 0) | (1 << 1) ; // Set UINC bit, TXREQ bit
-    writeByteRegisterSPI (C1TXQCON_REGISTER + 1, d);
+  }else{
+    uint8_t object [16] ;
+    ok = readCRCSPI (inUARegister, object, 4) ;
+    if (ok) {
+      const uint16_t ramAddress = (uint16_t) (0x400 + wordFromBytes (object)) ;
+      bytesFromWord (inMessage.id, object) ;
+      bytesFromWord (flags, object + 4) ;
+      bytesFromWord (inMessage.data32 [0], object + 8) ;
+      bytesFromWord (inMessage.data32 [1], object + 12) ;
+    //--- A WRITE_CRC with a CRC error may have written wrong data: write again
+      ok = false ;
+      for (uint8_t attempt = 0 ; (attempt < kSPICRCAttemptCount) && !ok ; attempt++) {
+        writeCRCSPI (ramAddress, object, 16) ;
+        ok = !controllerReportsCRCError () ;
+      }
+    }
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::releaseTransmitObjectSPI (const uint16_t inCONRegister) {
+//--- Set UINC bit, TXREQ bit: increment FIFO, send message (see DS20005688B, page 48). In CRC mode, the WRITE_SAFE
+//    is not executed if its CRC does not match: it is written again. If CRC register cannot be read, it is read
+//    again, but WRITE_SAFE is not written again, as a second UINC would send a stale object
+  const uint8_t d = (1 << 0) | (1 << 1) ; // Set UINC bit, TXREQ bit
+  bool ok = true ;
+  if (!mSPICRC) {
+    writeByteRegisterSPI (inCONRegister + 1, d) ;
+  }else{
+    ok = false ;
+    bool write = true ;
+    for (uint8_t attempt = 0 ; (attempt < kSPICRCAttemptCount) && !ok ; attempt++) {
+      if (write) {
+        writeSafeSPI (inCONRegister + 1, & d, 1) ;
+      }
+    //--- CRCERRIF (bit 16), FERRIF (bit 17) of CRC register are cleared by writing 0 (DS20005688B, page 20)
+      uint8_t flags ;
+      write = readCRCSPI (CRC_REGISTER + 2, & flags, 1) ;
+      ok = write && ((flags & ((1 << 0) | (1 << 1))) == 0) ;
+      if (write && !ok) {
+        mSPICRCErrorCount += 1 ;
+        writeByteRegisterSPI (CRC_REGISTER + 2, 0) ;
+      }
+    }
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//    PERIODIC TRANSMIT SCHEDULER
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::runScheduler (void) {
+//--- Interrupts are disabled only while the scheduler heap is updated (isr pops due frames, updateFrame and
+//    updateData may run in an other interrupt); frames are written with INT masked, as in tryToSend
+  lockDeferredWork () ;
+  if (NULL != mScheduler) {
+    const uint32_t now = micros () ;
+    CANMessage frame ;
+    uint8_t entryIndex ;
+    bool due = true ;
+    while (due) {
+      noInterrupts () ;
+        due = mScheduler->popDueFrame (now, frame, entryIndex) ;
+      interrupts () ;
+      if (due) {
+      //--- Workaround: the Teensy 3.5 / 3.6 "SPI.usingInterrupt" bug
+      //    https://github.com/PaulStoffregen/SPI/issues/35
+        #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+          noInterrupts () ;
+        #endif
+          mSPI.beginTransaction (mSPISettings) ;
+            const bool sent = enterInTransmitBuffer (frame, true) ;
+          mSPI.endTransaction () ;
+        #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+          interrupts () ;
+        #endif
+        noInterrupts () ;
+          mScheduler->recordSend (entryIndex, sent) ;
+        interrupts () ;
+      }
+    }
+  }
+  unlockDeferredWork () ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::sendDueFrames (void) {
+  if (NULL != mScheduler) {
+    const uint32_t now = micros () ;
+    CANMessage frame ;
+    uint8_t entryIndex ;
+    while (mScheduler->popDueFrame (now, frame, entryIndex)) {
+      const bool sent = enterInTransmitBuffer (frame, true) ;
+      mScheduler->recordSend (entryIndex, sent) ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//    ISO-TP
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::tryToSendIsoTp (const uint8_t * inData, const uint16_t inLength) {
+  lockDeferredWork () ;
+  noInterrupts () ; // Channel state is also updated by isr (received flow control frames)
+    const bool ok = (NULL != mIsoTp) && mIsoTp->startTransfer (inData, inLength) ;
+  interrupts () ;
+  if (ok) {
+    sendIsoTpFramesInTransaction () ;
+  }
+  unlockDeferredWork () ;
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::runIsoTp (void) {
+  lockDeferredWork () ;
+    sendIsoTpFramesInTransaction () ;
+  unlockDeferredWork () ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   As in tryToSend, INT is masked during the SPI transaction (SPI.usingInterrupt), so isr does not update the
+//   channel state while sendIsoTpFrames does
+
+void ACAN2517::sendIsoTpFramesInTransaction (void) {
+//--- Workaround: the Teensy 3.5 / 3.6 "SPI.usingInterrupt" bug
+//    https://github.com/PaulStoffregen/SPI/issues/35
+  #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+    noInterrupts () ;
+  #endif
+    mSPI.beginTransaction (mSPISettings) ;
+      sendIsoTpFrames () ;
+    mSPI.endTransaction () ;
+  #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+    interrupts () ;
+  #endif
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::sendIsoTpFrames (void) {
+  if (NULL != mIsoTp) {
+    const uint32_t now = micros () ;
+    mIsoTp->checkTimeOuts (now) ;
+    CANMessage frame ;
+    if (mIsoTp->mUseTXQ && mUsesTXQ) {
+    //--- TXQ: while frames are ready and TXQ is full, "TXQ not full" interrupt is enabled
+      bool TXQFull = false ;
+      while (mIsoTp->hasFrameReady (now) && !TXQFull) {
+        TXQFull = !controllerTXQIsNotFull () ;
+        if (!TXQFull) {
+          mIsoTp->popFrame (now, frame) ;
+          appendInControllerTXQ (frame) ;
+        }
+      }
+      if (mTXQNotFullInterruptEnabled != TXQFull) {
+        mTXQNotFullInterruptEnabled = TXQFull ;
+        writeByteRegisterSPI (C1TXQCON_REGISTER, TXQFull ? 1 : 0) ; // Bit 0: TXQNIE (DS20005688B, page 48)
+      }
+    }else{
+    //--- Transmit FIFO: frames are sent only if driver transmit buffer is empty, they are not delayed by
+    //    pending frames; when FIFO becomes full, "FIFO not full" interrupt is enabled, and isr resumes
+      while (!mControllerTxFIFOFull && mIsoTp->popFrame (now, frame)) {
+        enterInTransmitBuffer (frame, false) ;
+      }
+    }
   }
-  return TXQNotFull ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
@@ -478,27 +891,47 @@ bool ACAN2517::sendViaTXQ (const CANMessage & inMessage) {
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 bool ACAN2517::available (void) {
+  lockDeferredWork () ;
   noInterrupts () ;
     const bool hasReceivedMessage = mDriverReceiveBuffer.count () > 0 ;
   interrupts () ;
+  unlockDeferredWork () ;
   return hasReceivedMessage ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 bool ACAN2517::receive (CANMessage & outMessage) {
+  ACAN2517_PROFILE_BEGIN (Receive) ;
+  lockDeferredWork () ;
   noInterrupts () ;
     const bool hasReceivedMessage = mDriverReceiveBuffer.remove (outMessage) ;
     if (hasReceivedMessage) { // Receive FIFO is not full, enable "FIFO  not empty" interrupt
       writeByteRegisterSPI (C1FIFOCON_REGISTER (receiveFIFOIndex), 1) ;
     }
   interrupts () ;
+  unlockDeferredWork () ;
 //---
+  ACAN2517_PROFILE_END (Receive) ;
   return hasReceivedMessage ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
+bool ACAN2517::receive (CANMessage & outMessage, const uint32_t inTimeOutMicros) {
+  const uint32_t start = micros () ;
+  bool ok = receive (outMessage) ;
+  uint32_t elapsed = 0 ;
+  while (!ok && (elapsed < inTimeOutMicros)) {
+    waitForEvent (inTimeOutMicros - elapsed) ;
+    ok = receive (outMessage) ;
+    elapsed = micros () - start ;
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
 bool ACAN2517::dispatchReceivedMessage (const tFilterMatchCallBack inFilterMatchCallBack) {
   CANMessage receivedMessage ;
   const bool hasReceived = receive (receivedMessage) ;
@@ -507,7 +940,14 @@ bool ACAN2517::dispatchReceivedMessage (const tFilterMatchCallBack inFilterMatch
     if (NULL != inFilterMatchCallBack) {
       inFilterMatchCallBack (filterIndex) ;
     }
-    ACANCallBackRoutine callBackFunction = (mCallBackFunctionArray == NULL) ? NULL : mCallBackFunctionArray [filterIndex] ;
+    ACANCallBackRoutine callBackFunction = NULL ;
+    lockDeferredWork () ; // A runtime filter change may run in another task
+      if (NULL != mCallBackFunctionArray) {
+        callBackFunction = mCallBackFunctionArray [filterIndex] ;
+      }else if (NULL != mFilterArray) {
+        callBackFunction = mFilterArray [filterIndex].mCallBackRoutine ;
+      }
+    unlockDeferredWork () ;
     if (NULL != callBackFunction) {
       callBackFunction (receivedMessage) ;
     }
@@ -515,95 +955,641 @@ bool ACAN2517::dispatchReceivedMessage (const tFilterMatchCallBack inFilterMatch
   return hasReceived ;
 }
 
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   AUTOMATIC BIT RATE DETECTION
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::detectBitRate (const ACAN2517Settings inCandidates [],
+                              const uint8_t inCandidateCount,
+                              uint8_t & outCandidateIndex,
+                              const uint32_t inTimeOutMillis,
+                              const uint16_t inRequiredFrameCount) {
+  bool detected = false ;
+  mDetectBitRateErrorCode = 0 ;
+  if (mRequestedMode == ACAN2517Settings::ListenOnly) {
+    lockDeferredWork () ;
+    for (uint8_t i = 0 ; (i < inCandidateCount) && !detected ; i++) {
+      const ACAN2517Settings & candidate = inCandidates [i] ;
+      const bool valid = (candidate.sysClock () == mSysClock)
+        && candidate.mBitRateClosedToDesiredRate
+        && (candidate.CANBitSettingConsistency () == 0) ;
+      if (valid && changeNominalBitTiming (nominalBitTiming (candidate))) {
+      //--- Listen (C1BDIAG1: bits 21-16: nominal bit rate error flags, bits 15-0: EFMSGCNT)
+        writeRegister (C1BDIAG1_REGISTER, 0) ;
+        bool wait = true ;
+        const uint32_t start = millis () ;
+        while (wait) {
+          const uint32_t diagnostic = readRegister (C1BDIAG1_REGISTER) ;
+          if ((diagnostic & 0x003F0000) != 0) { // Bus error: wrong bit rate
+            wait = false ;
+          }else if ((diagnostic & 0xFFFF) >= inRequiredFrameCount) {
+            detected = true ;
+            outCandidateIndex = i ;
+            wait = false ;
+          }else if ((millis () - start) >= inTimeOutMillis) {
+            wait = false ;
+          }else{
+            yield () ;
+          }
+        }
+      }
+    }
+    if (detected) {
+      mNominalBitTiming = nominalBitTiming (inCandidates [outCandidateIndex]) ;
+    }else if (!changeNominalBitTiming (mNominalBitTiming)) {
+      mDetectBitRateErrorCode = kRequestedModeTimeOut ;
+    }
+    unlockDeferredWork () ;
+  }
+  return detected ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   Short configuration mode transition: configuration registers, FIFO configuration and RAM are kept.
+//   If configuration mode is not reached, the request is withdrawn, so that the controller does not enter it later.
+
+bool ACAN2517::changeNominalBitTiming (const uint32_t inNominalBitTiming) {
+  writeByteRegister (C1CON_REGISTER + 3, 0x04) ; // Request configuration mode
+  const bool ok = waitForMode (0x04) ;
+  if (ok) {
+    writeRegister (C1NBTCFG_REGISTER, inNominalBitTiming) ;
+  }
+  writeByteRegister (C1CON_REGISTER + 3, mRequestedMode) ;
+  return waitForMode (mRequestedMode) && ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::waitForMode (const uint8_t inMode) {
+  bool ok = false ;
+  bool wait = true ;
+  const uint32_t start = millis () ;
+  while (wait) {
+    const uint8_t actualMode = (readByteRegister (C1CON_REGISTER + 2) >> 5) & 0x07 ;
+    ok = actualMode == inMode ;
+    wait = !ok && ((millis () - start) < kModeChangeTimeOutMillis) ;
+    if (wait) {
+      yield () ;
+    }
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   C1NBTCFG register value (see register layout in internalBegin)
+
+uint32_t ACAN2517::nominalBitTiming (const ACAN2517Settings & inSettings) {
+  uint32_t data = inSettings.mBitRatePrescaler - 1 ;
+  data <<= 8 ;
+  data |= inSettings.mPhaseSegment1 - 1 ;
+  data <<= 8 ;
+  data |= inSettings.mPhaseSegment2 - 1 ;
+  data <<= 8 ;
+  data |= inSettings.mSJW - 1 ;
+  return data ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   RUNTIME FILTER RECONFIGURATION
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::updateFilter (const uint8_t inFilterIndex, const ACAN2517Filter & inFilter) {
+  uint32_t errorCode = 0 ;
+  if (inFilterIndex >= 32) {
+    errorCode |= kMoreThan32Filters ;
+  }
+  if (inFilter.mFilterStatus != ACAN2517Filters::kFiltersOk) {
+    errorCode |= kFilterDefinitionError ;
+  }
+  if (errorCode == 0) {
+    lockDeferredWork () ;
+    setUpCallBackFunctionArray () ;
+    mCallBackFunctionArray [inFilterIndex] = inFilter.mCallBackRoutine ;
+    if (mFilterCount <= inFilterIndex) {
+      mFilterCount = inFilterIndex + 1 ;
+    }
+    mSPI.beginTransaction (mSPISettings) ;
+      writeFilterSPI (inFilterIndex, inFilter.mFilterMask, inFilter.mAcceptanceFilter) ;
+    mSPI.endTransaction () ;
+    unlockDeferredWork () ;
+  }
+  return errorCode ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::enableFilter (const uint8_t inFilterIndex, const bool inEnable) {
+  uint32_t errorCode = 0 ;
+  if (inFilterIndex >= 32) {
+    errorCode |= kMoreThan32Filters ;
+  }else{
+    uint8_t d = 1 ; // Message matching filter is stored in FIFO1
+    if (inEnable) {
+      d |= 1 << 7 ; // Filter is enabled
+    }
+    lockDeferredWork () ;
+  //--- A filter beyond the defined ones has undefined mask, acceptance and call back routine
+    if (inFilterIndex >= mFilterCount) {
+      errorCode |= kFilterIndexIsNotDefined ;
+    }else{
+      mSPI.beginTransaction (mSPISettings) ;
+        writeByteRegisterSPI (C1FLTCON_REGISTER (inFilterIndex), d) ; // DS20005688B, page 58
+      mSPI.endTransaction () ;
+    }
+    unlockDeferredWork () ;
+  }
+  return errorCode ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::swapFilters (const ACAN2517Filters & inFilters) {
+  return internalSwapFilters (&inFilters,
+                              NULL,
+                              inFilters.filterCount (),
+                              inFilters.filterStatus () == ACAN2517Filters::kFiltersOk) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::swapFilters (const ACAN2517Filter * inFilters, const uint8_t inFilterCount) {
+  bool filtersOk = true ;
+  for (uint8_t i=0 ; (i<inFilterCount) && filtersOk ; i++) {
+    filtersOk = inFilters [i].mFilterStatus == ACAN2517Filters::kFiltersOk ;
+  }
+  return internalSwapFilters (NULL, inFilters, inFilterCount, filtersOk) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::internalSwapFilters (const ACAN2517Filters * inFilterList,
+                                        const ACAN2517Filter * inFilterArray,
+                                        const uint8_t inFilterCount,
+                                        const bool inFiltersOk) {
+  uint32_t errorCode = 0 ;
+  if (inFilterCount > 32) {
+    errorCode |= kMoreThan32Filters ;
+  }
+  if (!inFiltersOk) {
+    errorCode |= kFilterDefinitionError ;
+  }
+  if (errorCode == 0) {
+    const ACAN2517Filters::Filter * filter = (NULL == inFilterList) ? NULL : inFilterList->mFirstFilter ;
+    lockDeferredWork () ;
+    setUpCallBackFunctionArray () ;
+    mSPI.beginTransaction (mSPISettings) ;
+      for (uint8_t filterIndex = 0 ; filterIndex < inFilterCount ; filterIndex++) {
+        uint32_t mask ;
+        uint32_t acceptance ;
+        if (NULL != filter) {
+          mCallBackFunctionArray [filterIndex] = filter->mCallBackRoutine ;
+          mask = filter->mFilterMask ;
+          acceptance = filter->mAcceptanceFilter ;
+          filter = filter->mNextFilter ;
+        }else{
+          mCallBackFunctionArray [filterIndex] = inFilterArray [filterIndex].mCallBackRoutine ;
+          mask = inFilterArray [filterIndex].mFilterMask ;
+          acceptance = inFilterArray [filterIndex].mAcceptanceFilter ;
+        }
+      //--- An enabled filter with same mask and acceptance is left unchanged
+        const bool unchanged = (filterIndex < mFilterCount)
+          && ((readByteRegisterSPI (C1FLTCON_REGISTER (filterIndex)) & (1 << 7)) != 0)
+          && (readRegisterSPI (C1MASK_REGISTER (filterIndex)) == mask)
+          && (readRegisterSPI (C1FLTOBJ_REGISTER (filterIndex)) == acceptance) ;
+        if (!unchanged) {
+          writeFilterSPI (filterIndex, mask, acceptance) ;
+        }
+      }
+    //--- Disable filters beyond new set
+      for (uint8_t filterIndex = inFilterCount ; filterIndex < mFilterCount ; filterIndex++) {
+        mCallBackFunctionArray [filterIndex] = NULL ;
+        writeByteRegisterSPI (C1FLTCON_REGISTER (filterIndex), 1) ; // FLTEN cleared, FIFO1
+      }
+    mSPI.endTransaction () ;
+    mFilterCount = inFilterCount ;
+    unlockDeferredWork () ;
+  }
+  return errorCode ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::setUpCallBackFunctionArray (void) {
+  if (NULL == mCallBackFunctionArray) {
+    mCallBackFunctionArray = newCallBackFunctionArray () ;
+    if (NULL != mFilterArray) {
+      for (uint8_t i = 0 ; i < mFilterCount ; i++) {
+        mCallBackFunctionArray [i] = mFilterArray [i].mCallBackRoutine ;
+      }
+    }
+    mFilterArray = NULL ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+ACANCallBackRoutine * ACAN2517::newCallBackFunctionArray (void) {
+//--- 32 entries, all NULL: static storage of ACAN2517Static, heap allocated otherwise
+  ACANCallBackRoutine * result = mStaticCallBackArray ;
+  if (NULL == result) {
+    result = new ACANCallBackRoutine [32] ;
+  }
+  for (uint8_t i = 0 ; i < 32 ; i++) {
+    result [i] = NULL ;
+  }
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   Filter mask and acceptance registers are written with filter disabled (DS20005688B, page 58)
+
+void ACAN2517::writeFilterSPI (const uint8_t inFilterIndex, const uint32_t inMask, const uint32_t inAcceptance) {
+  writeByteRegisterSPI (C1FLTCON_REGISTER (inFilterIndex), 1) ; // FLTEN cleared, FIFO1
+  writeRegisterSPI (C1MASK_REGISTER (inFilterIndex), inMask) ;
+  writeRegisterSPI (C1FLTOBJ_REGISTER (inFilterIndex), inAcceptance) ;
+  writeByteRegisterSPI (C1FLTCON_REGISTER (inFilterIndex), (1 << 7) | 1) ; // FLTEN set, FIFO1
+}
+
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 //   INTERRUPT SERVICE ROUTINE
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 void ACAN2517::isr (void) {
+  if (NULL == mDeferredWork) {
+    serviceInterrupt () ;
+  }else if (!mDeferredInterruptPending) { // Top half: INT is level triggered, mask it until serviceDeferred
+    detachInterrupt (digitalPinToInterrupt (mINT)) ;
+    mDeferredInterruptPending = true ;
+    mDeferredWork->notifyFromISR () ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::serviceDeferred (void) {
+  const bool pending = mDeferredInterruptPending ;
+//--- Frames submitted by a gateway source driver are in the submission queue, drained by serviceInterrupt
+//    or by flushSubmissionQueue; the flag is cleared first, so that a frame submitted meanwhile notifies again
+  const bool submitted = mDeferredSubmissionPending ;
+  mDeferredSubmissionPending = false ;
+  if (pending) {
+    lockDeferredWork () ;
+      serviceInterrupt () ;
+    unlockDeferredWork () ;
+    mDeferredInterruptPending = false ;
+    attachInterrupt (digitalPinToInterrupt (mINT), mInterruptServiceRoutine, LOW) ;
+  }else if (submitted) {
+    flushSubmissionQueue () ;
+  }
+  return pending || submitted ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::serviceInterrupt (void) {
+  ACAN2517_PROFILE_BEGIN (Isr) ;
   mSPI.beginTransaction (mSPISettings) ;
+  ACAN2517_PROFILE_BEGIN (IsrReadInterruptFlags) ;
   const uint32_t it = readRegisterSPI (C1INT_REGISTER) ; // DS20005688B, page 34
+  ACAN2517_PROFILE_END (IsrReadInterruptFlags) ;
   if ((it & (1 << 1)) != 0) { // Receive FIFO interrupt
     receiveInterrupt () ;
   }
-  if ((it & (1 << 0)) != 0) { // Transmit FIFO interrupt
+  if ((it & (1 << 0)) != 0) { // Transmit FIFO interrupt (transmit FIFO, or TXQ used by ISO-TP)
     transmitInterrupt () ;
   }
+  if (NULL != mSubmissionQueue) {
+    bool retry = true ;
+    while (retry && mSubmissionQueue->tryAcquireConsumer ()) {
+      drainSubmissionQueue () ;
+      mSubmissionQueue->releaseConsumer () ;
+      retry = !mControllerTxFIFOFull && !mSubmissionQueue->isEmpty () ;
+    }
+  }
+//--- Flags are cleared by writing 0, writing 1 has no effect (DS20005688B, page 34)
   if ((it & (1 << 2)) != 0) { // TBCIF interrupt
-    writeByteRegisterSPI (C1INT_REGISTER, 1 << 2) ;
+    writeByteRegisterSPI (C1INT_REGISTER, (uint8_t) ~ (1 << 2)) ;
   }
   if ((it & (1 << 3)) != 0) { // MODIF interrupt
-    writeByteRegisterSPI (C1INT_REGISTER, 1 << 3) ;
+    writeByteRegisterSPI (C1INT_REGISTER, (uint8_t) ~ (1 << 3)) ;
+    modeChangeInterrupt () ;
   }
   if ((it & (1 << 12)) != 0) { // SERRIF interrupt
-    writeByteRegisterSPI (C1INT_REGISTER + 1, 1 << 4) ;
+    writeByteRegisterSPI (C1INT_REGISTER + 1, (uint8_t) ~ (1 << 4)) ;
+  }
+  if ((it & (1 << 13)) != 0) { // CERRIF interrupt
+    writeByteRegisterSPI (C1INT_REGISTER + 1, (uint8_t) ~ (1 << 5)) ;
+    errorStateInterrupt () ;
+  }
+  if ((it & (1 << 8)) != 0) { // ECCIF interrupt
+    eccInterrupt () ;
+  }
+  if ((it & (1 << 9)) != 0) { // SPICRCIF interrupt
+    spiCRCInterrupt () ;
   }
+  if ((it & (1 << 15)) != 0) { // IVMIF interrupt
+    writeByteRegisterSPI (C1INT_REGISTER + 1, (uint8_t) ~ (1 << 7)) ;
+    mInvalidMessageCount += 1 ;
+  }
+  sendDueFrames () ;
+  sendIsoTpFrames () ;
   mSPI.endTransaction () ;
+  forwardGatewayFrame () ;
+//--- Wake up blocking receive and send
+  if ((NULL != mWait) && ((it & ((1 << 1) | (1 << 0))) != 0)) {
+    mWait->signal () ;
+  }
+  ACAN2517_PROFILE_END (Isr) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::setGateway (ACAN2517Gateway * inGateway) {
+  const ACAN2517 * destination = (NULL == inGateway) ? NULL : inGateway->destination () ;
+//--- A destination in deferred work mode is only reached through its submission queue
+  const bool ok = (NULL == destination)
+    || (NULL == destination->mDeferredWork)
+    || (NULL != destination->mSubmissionQueue) ;
+  if (ok) {
+  //--- isr calls destination tryToSend: the destination SPI transactions should mask the INT interrupt of this
+  //    driver. If both drivers share the SPI bus, begin has already registered it
+    if ((NULL != destination) && (NULL == destination->mDeferredWork)) {
+      const int8_t itPin = digitalPinToInterrupt (mINT) ;
+      if (itPin != NOT_AN_INTERRUPT) {
+        destination->mSPI.usingInterrupt (itPin) ;
+      }
+    }
+    noInterrupts () ;
+      mGateway = inGateway ;
+    interrupts () ;
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::forwardGatewayFrame (void) {
+//--- Outside of the SPI transaction of this driver: destination may share the SPI bus
+  CANMessage frame ;
+  if ((NULL != mGateway) && mGateway->takePendingFrame (frame)) {
+    ACAN2517 * destination = mGateway->destination () ;
+    bool accepted ;
+    if (NULL == destination->mDeferredWork) {
+      accepted = destination->tryToSend (frame) ; // lockDeferredWork of destination does nothing
+    }else{
+      accepted = destination->submitGatewayFrame (frame, NULL != mDeferredWork) ;
+    }
+    mGateway->recordForwarding (accepted, micros ()) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   Destination in deferred work mode: its lock may be an RTOS mutex, that an isr cannot take, and that a source
+//   task should not take while holding its own lock (two gateways in opposite directions would deadlock). The
+//   frame is pushed in the lock free submission queue (setGateway has checked there is one), and the task of
+//   this driver is notified: serviceDeferred moves the queued frames.
+
+bool ACAN2517::submitGatewayFrame (const CANMessage & inFrame, const bool inTaskContext) {
+  const bool ok = mSubmissionQueue->push (inFrame) ; // inFrame.idx is 0 (see ACAN2517Gateway::route)
+  if (ok) {
+    mDeferredSubmissionPending = true ;
+    if (inTaskContext) {
+      mDeferredWork->notify () ;
+    }else{
+      mDeferredWork->notifyFromISR () ;
+    }
+  }
+  return ok ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 void ACAN2517::transmitInterrupt (void) {
+  ACAN2517_PROFILE_BEGIN (TransmitInterrupt) ;
+//--- If "TXQ not full" interrupt is enabled, the transmit FIFO may still be full: check its C1TXIF flag
+  const bool transmitFIFONotFull = !mTXQNotFullInterruptEnabled
+    || !mControllerTxFIFOFull
+    || ((readByteRegisterSPI (C1TXIF_REGISTER) & (1 << 2)) != 0) ;
   CANMessage message ;
-  mDriverTransmitBuffer.remove (message) ;
-  appendInControllerTxFIFO (message) ;
+  if (transmitFIFONotFull && mDriverTransmitBuffer.peek (message)) { // Can be empty if flushed on bus off
+  //--- If frame cannot be written (CRC errors), it stays first in driver transmit buffer: written again by next isr
+    if (appendInControllerTxFIFO (message)) {
+      mDriverTransmitBuffer.remove (message) ;
+    }
+  }
 //--- If driver transmit buffer is empty, disable "FIFO not full" interrupt
   if (mDriverTransmitBuffer.count () == 0) {
     uint8_t d = 1 << 7 ;  // FIFO is a transmit FIFO
     writeByteRegisterSPI (C1FIFOCON_REGISTER (2), d) ;
     mControllerTxFIFOFull = false ;
   }
+  ACAN2517_PROFILE_END (TransmitInterrupt) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::errorStateInterrupt (void) {
+  const ErrorState newState = errorStateFromTREC (readRegisterSPI (C1TREC_REGISTER)) ;
+  const ErrorState previousState = mErrorState ;
+  if (newState != previousState) {
+    mErrorState = newState ;
+    switch (newState) {
+    case ErrorActive :
+      break ;
+    case ErrorWarning :
+      mErrorWarningCount += 1 ;
+      break ;
+    case ErrorPassive :
+      mErrorPassiveCount += 1 ;
+      break ;
+    case BusOff :
+      mBusOffCount += 1 ;
+      if (mBusOffRestartPhase == kNoRestart) {
+        uint8_t d = mRequestedMode ; // Bits 2-0: REQOP (DS20005688B, page 24)
+        if (mBusOffRecovery != ACAN2517Settings::BusOffAutomaticRecovery) {
+          d = 0x04 ; // Request configuration mode, error counters are reset
+          mBusOffRestartPhase = kWaitingForConfigurationMode ;
+        //--- Until restart, frames go to driver transmit buffer, "FIFO not full" interrupt is disabled
+          writeByteRegisterSPI (C1FIFOCON_REGISTER (2), 1 << 7) ;
+          mControllerTxFIFOFull = true ;
+        }
+        if (mFlushTransmitBuffersOnBusOff) {
+          d |= 1 << 3 ; // Abort all pending transmissions
+          mDriverTransmitBuffer.clear () ;
+        }
+        if (d != mRequestedMode) {
+          writeByteRegisterSPI (C1CON_REGISTER + 3, d) ;
+        }
+      }
+      break ;
+    }
+    if (previousState == BusOff) {
+      mBusOffRecoveryCount += 1 ;
+    }
+    if (NULL != mErrorStateChangeCallBack) {
+      mErrorStateChangeCallBack (previousState, newState) ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::modeChangeInterrupt (void) {
+  const uint8_t actualMode = (readByteRegisterSPI (C1CON_REGISTER + 2) >> 5) & 0x07 ;
+  switch (mBusOffRestartPhase) {
+  case kWaitingForConfigurationMode :
+    if (actualMode == 0x04) {
+      if (mBusOffRecovery == ACAN2517Settings::BusOffManualRecovery) {
+        mBusOffRestartPhase = kWaitingForManualRecovery ;
+      }else{
+        mBusOffRestartPhase = kWaitingForRequestedMode ;
+        writeByteRegisterSPI (C1CON_REGISTER + 3, mRequestedMode) ;
+      }
+    }
+    break ;
+  case kWaitingForRequestedMode :
+    if (actualMode == mRequestedMode) {
+      mBusOffRestartPhase = kNoRestart ;
+      restartTransmission () ;
+      errorStateInterrupt () ; // Error counters have been reset by configuration mode
+    }
+    break ;
+  case kNoRestart :
+  case kWaitingForManualRecovery :
+    break ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::restartTransmission (void) {
+//--- Controller FIFOs have been reset in configuration mode: if driver transmit buffer is not empty,
+//    enable "FIFO not full" interrupt, transmitInterrupt will drain it
+  mControllerTxFIFOFull = mDriverTransmitBuffer.count () > 0 ;
+  uint8_t d = 1 << 7 ;  // FIFO is a transmit FIFO
+  if (mControllerTxFIFOFull) {
+    d |= 1 ; // Enable "FIFO not full" interrupt
+  }
+  writeByteRegisterSPI (C1FIFOCON_REGISTER (2), d) ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 void ACAN2517::receiveInterrupt (void) {
+  ACAN2517_PROFILE_BEGIN (ReceiveInterrupt) ;
   readByteRegisterSPI (C1FIFOSTA_REGISTER (receiveFIFOIndex)) ;
-  const uint16_t ramAddress = (uint16_t) (0x400 + readRegisterSPI (C1FIFOUA_REGISTER (receiveFIFOIndex))) ;
-  CANMessage message ;
-  assertCS () ;
-    readCommandSPI (ramAddress) ;
-  //--- Read identifier (see DS20005678A, page 42)
-    message.id = readWordSPI () ;
-  //--- Read DLC, RTR, IDE bits, and math filter index
-    const uint32_t data = readWordSPI () ;
-    message.rtr = (data & (1 << 5)) != 0 ;
-    message.ext = (data & (1 << 4)) != 0 ;
-    message.len = data & 0x0F ;
-    message.idx = (uint8_t) ((data >> 11) & 0x1F) ;
-  //--- Write data (Swap data if processor is big endian)
-    message.data32 [0] = readWordSPI () ;
-    message.data32 [1] = readWordSPI () ;
-  deassertCS () ;
-//--- Append message to driver receive FIFO
-  mDriverReceiveBuffer.append (message) ;
-//--- Increment FIFO
-  const uint8_t d = 1 << 0 ; // Set UINC bit (DS20005688B, page 52)
-  writeByteRegisterSPI (C1FIFOCON_REGISTER (receiveFIFOIndex) + 1, d) ;
-//--- If driver receive FIFO is full, disable "FIFO not empty" interrupt
-  if (mDriverReceiveBuffer.count () == mDriverReceiveBuffer.size ()) {
-    writeByteRegisterSPI (C1FIFOCON_REGISTER (receiveFIFOIndex), 0) ;
+  ACANPackedFrame frame ;
+  if (readReceiveObjectSPI (frame)) { // false on SPI CRC error: frame remains in controller FIFO, read by next isr
+  //--- Unwanted frame admitted by a compiled filter is discarded; frame is unpacked only if it is observed or
+  //    may be consumed before driver receive FIFO
+    bool appendFrame = (NULL == mSoftwareFilter) || mSoftwareFilter->accepts (frame) ;
+    if (!appendFrame) {
+      mSoftwareFilterRejectedCount += 1 ;
+    }else if ((NULL != mStatistics) || (NULL != mFrameTraceCallBack) || (NULL != mGateway)
+     || (NULL != mIsoTp) || (NULL != mReceiveCache)) {
+      CANMessage message ;
+      frame.unpack (message) ;
+    //--- Statistics, trace
+      if (NULL != mStatistics) {
+        mStatistics->recordFrame (message, true) ;
+      }
+      if (NULL != mFrameTraceCallBack) {
+        mFrameTraceCallBack (message, FrameReadFromController) ;
+      }
+    //--- Frame routed by gateway (forwarded or dropped) leaves the receive path; frame of ISO-TP channel is
+    //    handled by channel; store others in receive cache, or append them to driver receive FIFO
+      const bool consumed = ((NULL != mGateway) && mGateway->route (message, micros ()))
+        || ((NULL != mIsoTp) && mIsoTp->handleReceivedFrame (message, micros ())) ;
+      appendFrame = !consumed && ((NULL == mReceiveCache) || !mReceiveCache->store (message, micros ())) ;
+    }
+    if (appendFrame) {
+      mDriverReceiveBuffer.append (frame) ;
+    }
+  //--- Increment FIFO
+    const uint8_t d = 1 << 0 ; // Set UINC bit (DS20005688B, page 52)
+    writeByteRegisterSPI (C1FIFOCON_REGISTER (receiveFIFOIndex) + 1, d) ;
+  //--- If driver receive FIFO is full, disable "FIFO not empty" interrupt
+    if (mDriverReceiveBuffer.count () == mDriverReceiveBuffer.size ()) {
+      writeByteRegisterSPI (C1FIFOCON_REGISTER (receiveFIFOIndex), 0) ;
+    }
+  }
+  ACAN2517_PROFILE_END (ReceiveInterrupt) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517::readReceiveObjectSPI (ACANPackedFrame & outFrame) {
+//--- Read frame at user address of receive FIFO (returns false on SPI CRC error)
+  bool ok = true ;
+  if (!mSPICRC) {
+    const uint16_t ramAddress = (uint16_t) (0x400 + readRegisterSPI (C1FIFOUA_REGISTER (receiveFIFOIndex))) ;
+    assertCS () ;
+      readCommandSPI (ramAddress) ;
+    //--- Read identifier, DLC, RTR, IDE bits, math filter index, and data (see DS20005678A, page 42)
+    //    Words are stored as is in the packed frame (Swap data if processor is big endian)
+      const uint32_t identifierWord = readWordSPI () ;
+      const uint32_t flagWord = readWordSPI () ;
+      const uint32_t data0 = readWordSPI () ;
+      const uint32_t data1 = readWordSPI () ;
+      outFrame.setObjectWords (identifierWord, flagWord, data0, data1) ;
+    deassertCS () ;
+  }else{
+    uint8_t object [16] ;
+    ok = readCRCSPI (C1FIFOUA_REGISTER (receiveFIFOIndex), object, 4) ;
+    if (ok) {
+      const uint16_t ramAddress = (uint16_t) (0x400 + wordFromBytes (object)) ;
+      ok = readCRCSPI (ramAddress, object, 16) ;
+    }
+    if (ok) {
+      outFrame.setObjectWords (wordFromBytes (object),
+                               wordFromBytes (object + 4),
+                               wordFromBytes (object + 8),
+                               wordFromBytes (object + 12)) ;
+    }
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::eccInterrupt (void) {
+//--- ECCIF is set by SECIF or DEDIF of ECCSTAT, cleared by writing 0 (DS20005688B, page 21)
+  const uint8_t flags = readByteRegisterSPI (ECCSTAT_REGISTER) ;
+  if ((flags & (1 << 1)) != 0) { // SECIF
+    mECCCorrectedErrorCount += 1 ;
   }
+  if ((flags & (1 << 2)) != 0) { // DEDIF
+    mECCUncorrectableErrorCount += 1 ;
+  }
+  writeByteRegisterSPI (ECCSTAT_REGISTER, 0) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::spiCRCInterrupt (void) {
+//--- SPICRCIF is set by CRCERRIF or FERRIF of CRC register (DS20005688B, page 20)
+  controllerReportsCRCError () ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 //   MCP2517FD REGISTER ACCESS, FIRST LEVEL FUNCTIONS
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-void ACAN2517::readCommandSPI (const uint16_t inRegisterAddress) {
+inline void ACAN2517::readCommandSPI (const uint16_t inRegisterAddress) {
   const uint16_t readCommand = (inRegisterAddress & 0x0FFF) | (0b0011 << 12) ;
   mSPI.transfer16 (readCommand) ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-void ACAN2517::writeCommandSPI (const uint16_t inRegisterAddress) {
+inline void ACAN2517::writeCommandSPI (const uint16_t inRegisterAddress) {
   const uint16_t readCommand = (inRegisterAddress & 0x0FFF) | (0b0010 << 12) ;
   mSPI.transfer16 (readCommand) ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-uint32_t ACAN2517::readWordSPI (void) {
+inline uint32_t ACAN2517::readWordSPI (void) {
   uint32_t result = mSPI.transfer (0) ;
   result |= ((uint32_t) mSPI.transfer (0)) <<  8 ;
   result |= ((uint32_t) mSPI.transfer (0)) << 16 ;
@@ -613,7 +1599,7 @@ uint32_t ACAN2517::readWordSPI (void) {
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-void ACAN2517::writeWordSPI (const uint32_t inValue) {
+inline void ACAN2517::writeWordSPI (const uint32_t inValue) {
   mSPI.transfer ((uint8_t) inValue) ;
   mSPI.transfer ((uint8_t) (inValue >>  8)) ;
   mSPI.transfer ((uint8_t) (inValue >> 16)) ;
@@ -621,54 +1607,226 @@ void ACAN2517::writeWordSPI (const uint32_t inValue) {
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
-//   MCP2517FD REGISTER ACCESS, SECOND LEVEL FUNCTIONS
+//   MCP2517FD CRC PROTECTED ACCESS (DS20005688B, page 67)
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-void ACAN2517::assertCS (void) {
-  digitalWrite (mCS, LOW) ;
+bool ACAN2517::readCRCSPI (const uint16_t inAddress, uint8_t outData [], const uint8_t inLength) {
+//--- READ_CRC: instruction, address, length byte, data, CRC (MSB first). A failed read has no side effect:
+//    it is retried; after kSPICRCAttemptCount failures, data is zeroed
+  const uint16_t command = (inAddress & 0x0FFF) | (0b1011 << 12) ;
+  const uint8_t length = crcLengthByte (inAddress, inLength) ;
+  bool ok = false ;
+  for (uint8_t attempt = 0 ; (attempt < kSPICRCAttemptCount) && !ok ; attempt++) {
+    assertCS () ;
+      mSPI.transfer16 (command) ;
+      mSPI.transfer (length) ;
+      for (uint8_t i = 0 ; i < inLength ; i++) {
+        outData [i] = mSPI.transfer (0) ;
+      }
+      const uint16_t receivedCRC = mSPI.transfer16 (0) ;
+    deassertCS () ;
+    ACAN2517CRC crc ;
+    crc.accumulate ((uint8_t) (command >> 8)) ;
+    crc.accumulate ((uint8_t) command) ;
+    crc.accumulate (length) ;
+    crc.accumulate (outData, inLength) ;
+    ok = crc.value () == receivedCRC ;
+    if (!ok) {
+      mSPICRCErrorCount += 1 ;
+    }
+  }
+  if (!ok) {
+    for (uint8_t i = 0 ; i < inLength ; i++) {
+      outData [i] = 0 ;
+    }
+  }
+  return ok ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-void ACAN2517::deassertCS (void) {
-  digitalWrite (mCS, HIGH) ;
+void ACAN2517::writeCRCSPI (const uint16_t inAddress, const uint8_t inData [], const uint8_t inLength) {
+//--- WRITE_CRC: instruction, address, length byte, data, CRC (MSB first). Data is written even if CRC does
+//    not match; the controller then sets CRCERRIF (see controllerReportsCRCError)
+  const uint16_t command = (inAddress & 0x0FFF) | (0b1010 << 12) ;
+  const uint8_t length = crcLengthByte (inAddress, inLength) ;
+  ACAN2517CRC crc ;
+  crc.accumulate ((uint8_t) (command >> 8)) ;
+  crc.accumulate ((uint8_t) command) ;
+  crc.accumulate (length) ;
+  crc.accumulate (inData, inLength) ;
+  assertCS () ;
+    mSPI.transfer16 (command) ;
+    mSPI.transfer (length) ;
+    for (uint8_t i = 0 ; i < inLength ; i++) {
+      mSPI.transfer (inData [i]) ;
+    }
+    mSPI.transfer16 (crc.value ()) ;
+  deassertCS () ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
-void ACAN2517::writeRegisterSPI (const uint16_t inRegisterAddress, const uint32_t inValue) {
+void ACAN2517::writeSafeSPI (const uint16_t inAddress, const uint8_t inData [], const uint8_t inLength) {
+//--- WRITE_SAFE: instruction, address, data (one SFR byte, or one RAM word), CRC (MSB first). Data is written
+//    only if CRC matches; otherwise the controller sets CRCERRIF, counted by isr
+  const uint16_t command = (inAddress & 0x0FFF) | (0b1100 << 12) ;
+  ACAN2517CRC crc ;
+  crc.accumulate ((uint8_t) (command >> 8)) ;
+  crc.accumulate ((uint8_t) command) ;
+  crc.accumulate (inData, inLength) ;
   assertCS () ;
-    writeCommandSPI (inRegisterAddress) ; // Command
-    writeWordSPI (inValue) ; // Data
+    mSPI.transfer16 (command) ;
+    for (uint8_t i = 0 ; i < inLength ; i++) {
+      mSPI.transfer (inData [i]) ;
+    }
+    mSPI.transfer16 (crc.value ()) ;
   deassertCS () ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
+bool ACAN2517::controllerReportsCRCError (void) {
+//--- CRCERRIF (bit 16), FERRIF (bit 17) of CRC register are cleared by writing 0 (DS20005688B, page 20).
+//    If the register cannot be read, an error is assumed
+  uint8_t flags ;
+  const bool readOk = readCRCSPI (CRC_REGISTER + 2, & flags, 1) ;
+  const bool error = !readOk || ((flags & ((1 << 0) | (1 << 1))) != 0) ;
+  if (readOk && error) {
+    mSPICRCErrorCount += 1 ;
+    writeByteRegisterSPI (CRC_REGISTER + 2, 0) ;
+  }
+  return error ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   MCP2517FD REGISTER ACCESS, SECOND LEVEL FUNCTIONS
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::setUpFastChipSelect (const bool inEnable) {
+  mFastChipSelect = false ;
+  #if defined (__AVR__)
+    if (inEnable) {
+      mCSOutputRegister = portOutputRegister (digitalPinToPort (mCS)) ;
+      mCSBitMask = digitalPinToBitMask (mCS) ;
+      mFastChipSelect = true ;
+    }
+  #elif defined (ARDUINO_ARCH_SAMD)
+    if (inEnable) {
+      const EPortType port = g_APinDescription [mCS].ulPort ;
+      mCSSetRegister = & PORT->Group [port].OUTSET.reg ;
+      mCSClearRegister = & PORT->Group [port].OUTCLR.reg ;
+      mCSBitMask = digitalPinToBitMask (mCS) ;
+      mFastChipSelect = true ;
+    }
+  #elif defined (KINETISK)
+    if (inEnable) {
+      mCSSetRegister = portSetRegister (mCS) ;
+      mCSClearRegister = portClearRegister (mCS) ;
+      mFastChipSelect = true ;
+    }
+  #else
+    (void) inEnable ; // Not supported: digitalWrite is used
+  #endif
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+inline void ACAN2517::assertCS (void) {
+  if (mFastChipSelect) {
+    #if defined (__AVR__)
+      const uint8_t savedSREG = SREG ; // Read-modify-write of a port shared with other pins
+      cli () ;
+        *mCSOutputRegister &= (uint8_t) ~ mCSBitMask ;
+      SREG = savedSREG ;
+    #elif defined (ARDUINO_ARCH_SAMD) || defined (KINETISK)
+      *mCSClearRegister = mCSBitMask ;
+    #endif
+  }else{
+    digitalWrite (mCS, LOW) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+inline void ACAN2517::deassertCS (void) {
+  if (mFastChipSelect) {
+    #if defined (__AVR__)
+      const uint8_t savedSREG = SREG ;
+      cli () ;
+        *mCSOutputRegister |= mCSBitMask ;
+      SREG = savedSREG ;
+    #elif defined (ARDUINO_ARCH_SAMD) || defined (KINETISK)
+      *mCSSetRegister = mCSBitMask ;
+    #endif
+  }else{
+    digitalWrite (mCS, HIGH) ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517::writeRegisterSPI (const uint16_t inRegisterAddress, const uint32_t inValue) {
+  if (!mSPICRC) {
+    assertCS () ;
+      writeCommandSPI (inRegisterAddress) ; // Command
+      writeWordSPI (inValue) ; // Data
+    deassertCS () ;
+  }else{
+    uint8_t data [4] ;
+    bytesFromWord (inValue, data) ;
+    if ((inRegisterAddress >= 0x400) && (inRegisterAddress < 0xC00)) { // RAM: one WRITE_SAFE word
+      writeSafeSPI (inRegisterAddress, data, 4) ;
+    }else{ // SFR: WRITE_SAFE writes one byte
+      for (uint8_t i = 0 ; i < 4 ; i++) {
+        writeSafeSPI (inRegisterAddress + i, data + i, 1) ;
+      }
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
 uint32_t ACAN2517::readRegisterSPI (const uint16_t inRegisterAddress) {
-  assertCS () ;
-    readCommandSPI (inRegisterAddress) ; // Command
-    const uint32_t result = readWordSPI () ; // Data
-  deassertCS () ;
+  uint32_t result ;
+  if (!mSPICRC) {
+    assertCS () ;
+      readCommandSPI (inRegisterAddress) ; // Command
+      result = readWordSPI () ; // Data
+    deassertCS () ;
+  }else{
+    uint8_t data [4] ;
+    readCRCSPI (inRegisterAddress, data, 4) ;
+    result = wordFromBytes (data) ;
+  }
   return result ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 void ACAN2517::writeByteRegisterSPI (const uint16_t inRegisterAddress, const uint8_t inValue) {
-  assertCS () ;
-    writeCommandSPI (inRegisterAddress) ; // Command
-    mSPI.transfer (inValue) ; // Data
-  deassertCS () ;
+  if (!mSPICRC) {
+    assertCS () ;
+      writeCommandSPI (inRegisterAddress) ; // Command
+      mSPI.transfer (inValue) ; // Data
+    deassertCS () ;
+  }else{
+    writeSafeSPI (inRegisterAddress, & inValue, 1) ;
+  }
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 uint8_t ACAN2517::readByteRegisterSPI (const uint16_t inRegisterAddress) {
-  assertCS () ;
-    readCommandSPI (inRegisterAddress) ; // Command
-    const uint8_t result = mSPI.transfer (0) ; // Data
-  deassertCS () ;
+  uint8_t result ;
+  if (!mSPICRC) {
+    assertCS () ;
+      readCommandSPI (inRegisterAddress) ; // Command
+      result = mSPI.transfer (0) ; // Data
+    deassertCS () ;
+  }else{
+    readCRCSPI (inRegisterAddress, & result, 1) ;
+  }
   return result ;
 }
 
@@ -711,14 +1869,68 @@ uint32_t ACAN2517::readRegister (const uint16_t inRegisterAddress) {
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 uint32_t ACAN2517::readErrorCounters (void) {
+  lockDeferredWork () ;
   mSPI.beginTransaction (mSPISettings) ;
     const uint32_t result = readRegisterSPI (C1BDIAG0_REGISTER) ;
   mSPI.endTransaction () ;
+  unlockDeferredWork () ;
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517::readTransmitReceiveErrorCounters (void) {
+  lockDeferredWork () ;
+  mSPI.beginTransaction (mSPISettings) ;
+    const uint32_t result = readRegisterSPI (C1TREC_REGISTER) ; // DS20005688B, page 38
+  mSPI.endTransaction () ;
+  unlockDeferredWork () ;
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+ACAN2517::ErrorState ACAN2517::errorStateFromTREC (const uint32_t inTRECRegister) {
+  ErrorState result = ErrorActive ;
+  if ((inTRECRegister & (1 << 21)) != 0) { // TXBO
+    result = BusOff ;
+  }else if ((inTRECRegister & ((1 << 20) | (1 << 19))) != 0) { // TXBP, RXBP
+    result = ErrorPassive ;
+  }else if ((inTRECRegister & (1 << 16)) != 0) { // EWARN
+    result = ErrorWarning ;
+  }
   return result ;
 }
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
+bool ACAN2517::recoverFromBusOff (void) {
+  lockDeferredWork () ;
+  noInterrupts () ; // Restart phase is also updated by isr
+    const bool ok = mBusOffRestartPhase == kWaitingForManualRecovery ;
+    if (ok) {
+      mBusOffRestartPhase = kWaitingForRequestedMode ;
+    }
+  interrupts () ;
+  if (ok) {
+  //--- Workaround: the Teensy 3.5 / 3.6 "SPI.usingInterrupt" bug
+  //    https://github.com/PaulStoffregen/SPI/issues/35
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      noInterrupts () ;
+    #endif
+      mSPI.beginTransaction (mSPISettings) ;
+        writeByteRegisterSPI (C1CON_REGISTER + 3, mRequestedMode) ; // Completed by modeChangeInterrupt
+      mSPI.endTransaction () ;
+    #if (defined (__MK64FX512__) || defined (__MK66FX1M0__))
+      interrupts () ;
+    #endif
+  }
+  unlockDeferredWork () ;
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
 void ACAN2517::reset2517FD (void) {
   mSPI.beginTransaction (mSPISettings) ; // Check RESET is performed with 1 MHz clock
     assertCS () ;
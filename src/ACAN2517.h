@@ -11,7 +11,20 @@
 
 #include <ACAN2517Settings.h>
 #include <ACANBuffer.h>
+#include <ACAN2517ReceiveBuffer.h>
+#include <ACAN2517TransmitBuffer.h>
 #include <ACAN2517Filters.h>
+#include <ACAN2517Statistics.h>
+#include <ACAN2517Scheduler.h>
+#include <ACAN2517ReceiveCache.h>
+#include <ACAN2517IsoTp.h>
+#include <ACAN2517Profiling.h>
+#include <ACAN2517DeferredWork.h>
+#include <ACAN2517SubmissionQueue.h>
+#include <ACAN2517Wait.h>
+#include <ACAN2517RamPlanner.h>
+#include <ACAN2517Gateway.h>
+#include <ACAN2517FilterCompiler.h>
 #include <SPI.h>
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
@@ -39,6 +52,25 @@ class ACAN2517 {
                           void (* inInterruptServiceRoutine) (void),
                           const ACAN2517Filters & inFilters) ;
 
+//--- Filter array (no heap allocation): the array is not copied, it should remain valid (constexpr array)
+  public: uint32_t begin (const ACAN2517Settings & inSettings,
+                          void (* inInterruptServiceRoutine) (void),
+                          const ACAN2517Filter * inFilters,
+                          const uint8_t inFilterCount) ;
+
+  public: template <uint8_t FILTER_COUNT> uint32_t begin (const ACAN2517Settings & inSettings,
+                                                          void (* inInterruptServiceRoutine) (void),
+                                                          const ACAN2517Filter (& inFilters) [FILTER_COUNT]) {
+    return begin (inSettings, inInterruptServiceRoutine, inFilters, FILTER_COUNT) ;
+  }
+
+  private: uint32_t internalBegin (const ACAN2517Settings & inSettings,
+                                   void (* inInterruptServiceRoutine) (void),
+                                   const ACAN2517Filters * inFilterList,
+                                   const ACAN2517Filter * inFilterArray,
+                                   const uint32_t inFilterCount,
+                                   const bool inFiltersOk) ;
+
 //--- Error code returned by begin
   public: static const uint32_t kRequestedConfigurationModeTimeOut  = 1 <<  0 ;
   public: static const uint32_t kReadBackErrorWith1MHzSPIClock      = 1 <<  1 ;
@@ -59,6 +91,7 @@ class ACAN2517 {
   public: static const uint32_t kRequestedModeTimeOut               = 1 << 16 ;
   public: static const uint32_t kX10PLLNotReadyWithin1MS            = 1 << 17 ;
   public: static const uint32_t kReadBackErrorWithFullSpeedSPIClock = 1 << 18 ;
+  public: static const uint32_t kFilterIndexIsNotDefined           = 1 << 19 ;
 
 //······················································································································
 //   Send a message
@@ -66,17 +99,75 @@ class ACAN2517 {
 
   public: bool tryToSend (const CANMessage & inMessage) ;
 
+//--- Latest value (mailbox) send: if a frame with same identifier entered by tryToSendLatestValue
+//    is still pending in the driver transmit buffer, its content is replaced in place. Frame goes
+//    through the transmit FIFO (inMessage.idx is ignored).
+  public: bool tryToSendLatestValue (const CANMessage & inMessage) ;
+
+  public: uint32_t driverTransmitBufferReplacedCount (void) const { return mDriverTransmitBuffer.replacedCount () ; }
+
+//--- Blocking send: returns false if the frame has not been accepted by tryToSend within inTimeOutMicros µs
+  public: bool send (const CANMessage & inMessage, const uint32_t inTimeOutMicros) ;
+
 //······················································································································
 //    Receive a message
 //······················································································································
 
   public: bool receive (CANMessage & outMessage) ;
   public: bool available (void) ;
+
+//--- Blocking receive: returns false if no frame has been received within inTimeOutMicros µs
+  public: bool receive (CANMessage & outMessage, const uint32_t inTimeOutMicros) ;
   public: typedef void (*tFilterMatchCallBack) (const uint32_t inFilterIndex) ;
   public: bool dispatchReceivedMessage (const tFilterMatchCallBack inFilterMatchCallBack = NULL) ;
 
-//--- Call back function array
+//--- Call back function array (filter list, or after a runtime filter change), or filter array
   private: ACANCallBackRoutine * mCallBackFunctionArray = NULL ;
+  private: ACANCallBackRoutine * mStaticCallBackArray = NULL ; // 32 entries (see ACAN2517Static), NULL: heap allocated
+  private: const ACAN2517Filter * mFilterArray = NULL ;
+  private: uint8_t mFilterCount = 0 ;
+
+//······················································································································
+//    Runtime filter reconfiguration (returns 0 if no error, or kMoreThan32Filters, kFilterDefinitionError,
+//    kFilterIndexIsNotDefined). Controller stays in its mode: a changed filter is disabled (FLTEN cleared)
+//    while its mask and acceptance registers are written, the other filters receive without interruption.
+//    A runtime change of a driver started with a filter array copies its call back routines in a 32 entry
+//    array (once): member of ACAN2517Static, heap allocated otherwise.
+//······················································································································
+
+  public: uint32_t updateFilter (const uint8_t inFilterIndex, const ACAN2517Filter & inFilter) ;
+
+  public: uint32_t updateFilter (const uint8_t inFilterIndex,
+                                 const tFrameFormat inFormat,
+                                 const uint32_t inMask,
+                                 const uint32_t inAcceptance,
+                                 const ACANCallBackRoutine inCallBackRoutine) {
+    return updateFilter (inFilterIndex, ACAN2517Filter::filter (inFormat, inMask, inAcceptance, inCallBackRoutine)) ;
+  }
+
+//--- Filter should be defined (by begin, updateFilter or swapFilters)
+  public: uint32_t enableFilter (const uint8_t inFilterIndex, const bool inEnable) ;
+
+//--- Filter set swap: filters whose mask and acceptance are unchanged are not disabled; filters beyond the
+//    new set are disabled. Nothing is changed if the new set is invalid.
+  public: uint32_t swapFilters (const ACAN2517Filters & inFilters) ;
+
+  public: uint32_t swapFilters (const ACAN2517Filter * inFilters, const uint8_t inFilterCount) ;
+
+  public: template <uint8_t FILTER_COUNT> uint32_t swapFilters (const ACAN2517Filter (& inFilters) [FILTER_COUNT]) {
+    return swapFilters (inFilters, FILTER_COUNT) ;
+  }
+
+  private: uint32_t internalSwapFilters (const ACAN2517Filters * inFilterList,
+                                         const ACAN2517Filter * inFilterArray,
+                                         const uint8_t inFilterCount,
+                                         const bool inFiltersOk) ;
+
+  private: void setUpCallBackFunctionArray (void) ;
+
+  private: ACANCallBackRoutine * newCallBackFunctionArray (void) ;
+
+  private: void writeFilterSPI (const uint8_t inFilterIndex, const uint32_t inMask, const uint32_t inAcceptance) ;
 
 //······················································································································
 //    Get error counters
@@ -84,6 +175,320 @@ class ACAN2517 {
 
   public: uint32_t readErrorCounters (void) ;
 
+//······················································································································
+//    Error state (updated by isr on CERRIF interrupt)
+//······················································································································
+
+  public: typedef enum : uint8_t {
+    ErrorActive,
+    ErrorWarning,
+    ErrorPassive,
+    BusOff
+  } ErrorState ;
+
+  public: typedef void (*tErrorStateChangeCallBack) (const ErrorState inPreviousState,
+                                                      const ErrorState inNewState) ;
+
+//--- Call back is invoked from isr context
+  public: void setErrorStateChangeCallBack (const tErrorStateChangeCallBack inCallBack) {
+    mErrorStateChangeCallBack = inCallBack ;
+  }
+
+  public: ErrorState errorState (void) const { return mErrorState ; }
+
+//--- Returns C1TREC register (bits 7-0: REC, bits 15-8: TEC, bits 21-16: error state flags)
+  public: uint32_t readTransmitReceiveErrorCounters (void) ;
+
+  public: static ErrorState errorStateFromTREC (const uint32_t inTRECRegister) ;
+
+//--- Event counters
+  public: uint32_t errorWarningCount (void) const { return mErrorWarningCount ; }
+  public: uint32_t errorPassiveCount (void) const { return mErrorPassiveCount ; }
+  public: uint32_t busOffCount (void) const { return mBusOffCount ; }
+  public: uint32_t busOffRecoveryCount (void) const { return mBusOffRecoveryCount ; }
+  public: uint32_t invalidMessageCount (void) const { return mInvalidMessageCount ; }
+
+//······················································································································
+//    SPI integrity (settings mSPIIntegrity): error counters
+//······················································································································
+
+//--- CRC errors detected by driver (READ_CRC) and by controller (WRITE_CRC, WRITE_SAFE); failed reads are
+//    retried, a frame is written again in controller RAM until controller reports no CRC error
+  public: uint32_t spiCRCErrorCount (void) const { return mSPICRCErrorCount ; }
+
+//--- Frame writes abandoned after CRC errors: the frame is kept in driver transmit buffer (transmit FIFO),
+//    or tryToSend returns false (TXQ), or the frame is lost (ISO-TP frame via TXQ)
+  public: uint32_t spiCRCLostFrameCount (void) const { return mSPICRCLostFrameCount ; }
+
+//--- RAM ECC errors, reported by controller: single bit (corrected), double bit (not corrected)
+  public: uint32_t eccCorrectedErrorCount (void) const { return mECCCorrectedErrorCount ; }
+  public: uint32_t eccUncorrectableErrorCount (void) const { return mECCUncorrectableErrorCount ; }
+
+  private: bool mSPICRC = false ;
+  private: uint32_t mSPICRCErrorCount = 0 ;
+  private: uint32_t mSPICRCLostFrameCount = 0 ;
+  private: uint32_t mECCCorrectedErrorCount = 0 ;
+  private: uint32_t mECCUncorrectableErrorCount = 0 ;
+
+//--- With BusOffManualRecovery policy, restart controller (returns false if not waiting for recovery)
+  public: bool recoverFromBusOff (void) ;
+
+  private: tErrorStateChangeCallBack mErrorStateChangeCallBack = NULL ;
+  private: ErrorState mErrorState = ErrorActive ;
+  private: uint32_t mErrorWarningCount = 0 ;
+  private: uint32_t mErrorPassiveCount = 0 ;
+  private: uint32_t mBusOffCount = 0 ;
+  private: uint32_t mBusOffRecoveryCount = 0 ;
+  private: uint32_t mInvalidMessageCount = 0 ;
+  private: ACAN2517Settings::BusOffRecovery mBusOffRecovery = ACAN2517Settings::BusOffAutomaticRecovery ;
+  private: bool mFlushTransmitBuffersOnBusOff = false ;
+  private: uint8_t mRequestedMode = ACAN2517Settings::Normal20B ;
+
+  private: typedef enum : uint8_t {
+    kNoRestart,
+    kWaitingForConfigurationMode,
+    kWaitingForManualRecovery,
+    kWaitingForRequestedMode
+  } BusOffRestartPhase ;
+
+  private: BusOffRestartPhase mBusOffRestartPhase = kNoRestart ;
+
+//······················································································································
+//    Automatic bit rate detection (driver started in ListenOnly mode, returns false otherwise)
+//    For every candidate (same oscillator as begin settings), controller goes to configuration mode, only
+//    C1NBTCFG is written, and it returns to ListenOnly mode. The candidate is rejected as soon as a bus error is
+//    detected (C1BDIAG1 error flags), selected as soon as inRequiredFrameCount error free frames have been
+//    received (C1BDIAG1 EFMSGCNT), or rejected after inTimeOutMillis. Bit timing of selected candidate is kept;
+//    if none is selected, begin bit timing is restored. Every mode change waits at most kModeChangeTimeOutMillis
+//    (a frame in progress is completed first), independently of inTimeOutMillis. detectBitRateErrorCode returns
+//    kRequestedModeTimeOut if ListenOnly mode was not reached again at the end: the controller may be left in
+//    configuration mode, call begin.
+//······················································································································
+
+  public: bool detectBitRate (const ACAN2517Settings inCandidates [],
+                              const uint8_t inCandidateCount,
+                              uint8_t & outCandidateIndex,
+                              const uint32_t inTimeOutMillis = 50,
+                              const uint16_t inRequiredFrameCount = 2) ;
+
+  public: template <uint8_t CANDIDATE_COUNT> bool detectBitRate (const ACAN2517Settings (& inCandidates) [CANDIDATE_COUNT],
+                                                                 uint8_t & outCandidateIndex,
+                                                                 const uint32_t inTimeOutMillis = 50,
+                                                                 const uint16_t inRequiredFrameCount = 2) {
+    return detectBitRate (inCandidates, CANDIDATE_COUNT, outCandidateIndex, inTimeOutMillis, inRequiredFrameCount) ;
+  }
+
+  public: uint32_t detectBitRateErrorCode (void) const { return mDetectBitRateErrorCode ; }
+
+  public: static const uint32_t kModeChangeTimeOutMillis = 20 ; // Longest frame at 10 kbit/s lasts about 16 ms
+
+  private: bool changeNominalBitTiming (const uint32_t inNominalBitTiming) ;
+
+  private: bool waitForMode (const uint8_t inMode) ;
+
+  private: static uint32_t nominalBitTiming (const ACAN2517Settings & inSettings) ;
+
+  private: uint32_t mNominalBitTiming = 0 ; // C1NBTCFG value of begin settings
+  private: uint32_t mSysClock = 0 ;
+  private: uint32_t mDetectBitRateErrorCode = 0 ;
+
+//······················································································································
+//    Optional traffic statistics (not owned by driver; NULL --> no statistics)
+//······················································································································
+
+  public: void setStatistics (ACAN2517Statistics * inStatistics) {
+    noInterrupts () ;
+      mStatistics = inStatistics ;
+    interrupts () ;
+  }
+
+  private: ACAN2517Statistics * mStatistics = NULL ;
+
+//······················································································································
+//    Optional frame trace call back (NULL --> no trace), for latency measurement
+//    Invoked when a frame is written in a controller transmit FIFO (from tryToSend or isr), and when a
+//    received frame is read from controller receive FIFO (from isr); it should be very short.
+//······················································································································
+
+  public: typedef enum : uint8_t {
+    FrameWrittenInController,
+    FrameReadFromController
+  } FrameTracePoint ;
+
+  public: typedef void (*tFrameTraceCallBack) (const CANMessage & inFrame, const FrameTracePoint inTracePoint) ;
+
+  public: void setFrameTraceCallBack (const tFrameTraceCallBack inCallBack) {
+    noInterrupts () ;
+      mFrameTraceCallBack = inCallBack ;
+    interrupts () ;
+  }
+
+  private: tFrameTraceCallBack mFrameTraceCallBack = NULL ;
+
+//······················································································································
+//    Optional receive last value cache (not owned by driver; NULL --> no cache)
+//······················································································································
+
+  public: void setReceiveCache (ACAN2517ReceiveCache * inReceiveCache) {
+    noInterrupts () ;
+      mReceiveCache = inReceiveCache ;
+    interrupts () ;
+  }
+
+  private: ACAN2517ReceiveCache * mReceiveCache = NULL ;
+
+//······················································································································
+//    Optional software filter (not owned by driver; NULL --> no software filter)
+//    A frame admitted by a compiled filter that is not exact (see ACAN2517FilterCompiler) is discarded by isr
+//    if its identifier is not in the compiler identifier set.
+//······················································································································
+
+  public: void setSoftwareFilter (const ACAN2517FilterCompiler * inCompiler) {
+    noInterrupts () ;
+      mSoftwareFilter = inCompiler ;
+    interrupts () ;
+  }
+
+  public: uint32_t softwareFilterRejectedCount (void) const { return mSoftwareFilterRejectedCount ; }
+
+  private: const ACAN2517FilterCompiler * mSoftwareFilter = NULL ;
+  private: uint32_t mSoftwareFilterRejectedCount = 0 ;
+
+//······················································································································
+//    Optional gateway (not owned by driver; NULL --> no gateway)
+//    Every received frame is routed by isr (see ACAN2517Gateway): forwarded frames are submitted to
+//    destination driver tryToSend by isr, after the SPI transaction of this driver; dropped frames are
+//    discarded; others go to the receive path. The gateway destination should be set before calling
+//    setGateway: it registers the INT interrupt of this driver with the destination SPI bus
+//    (SPI.usingInterrupt), so that isr never preempts a destination SPI transaction, even if the destination
+//    uses another SPI bus.
+//    A destination in deferred work mode is never locked by isr: forwarded frames are pushed in its lock free
+//    submission queue, and its task is notified. Its setDeferredWork and setSubmissionQueue should be called
+//    before setGateway, that returns false (gateway is not installed) if it has no submission queue.
+//······················································································································
+
+  public: bool setGateway (ACAN2517Gateway * inGateway) ;
+
+  private: ACAN2517Gateway * mGateway = NULL ;
+
+  private: void forwardGatewayFrame (void) ;
+
+  private: bool submitGatewayFrame (const CANMessage & inFrame, const bool inTaskContext) ;
+
+//······················································································································
+//    Optional periodic transmit scheduler (not owned by driver; NULL --> no scheduler)
+//    Due frames are sent as latest value frames (see tryToSendLatestValue) by isr, and by runScheduler,
+//    that should be called from loop or from a task, never from an interrupt (it is not guarded against a
+//    preempted tryToSend SPI transaction).
+//······················································································································
+
+  public: void setScheduler (ACAN2517Scheduler * inScheduler) {
+    noInterrupts () ;
+      mScheduler = inScheduler ;
+    interrupts () ;
+  }
+
+  public: void runScheduler (void) ;
+
+  private: ACAN2517Scheduler * mScheduler = NULL ;
+
+  private: void sendDueFrames (void) ;
+
+//······················································································································
+//    Optional ISO-TP channel (not owned by driver; NULL --> no ISO-TP)
+//    Received frames of the channel are handled by isr, flow control and consecutive frames are sent from
+//    isr as soon as the controller has room; runIsoTp paces consecutive frames when STmin is not zero and
+//    handles time outs: call it from loop or from a task, never from an interrupt (it is not guarded against a
+//    preempted tryToSend SPI transaction).
+//······················································································································
+
+  public: void setIsoTp (ACAN2517IsoTp * inIsoTp) {
+    noInterrupts () ;
+      mIsoTp = inIsoTp ;
+    interrupts () ;
+  }
+
+//--- Returns false if no channel, a transfer is in progress, or length is not 1 ... 4095.
+//    inData is not copied: it should remain valid until channel isSending method returns false.
+  public: bool tryToSendIsoTp (const uint8_t * inData, const uint16_t inLength) ;
+
+  public: void runIsoTp (void) ;
+
+  private: ACAN2517IsoTp * mIsoTp = NULL ;
+  private: bool mTXQNotFullInterruptEnabled = false ;
+
+  private: void sendIsoTpFrames (void) ;
+
+  private: void sendIsoTpFramesInTransaction (void) ;
+
+//······················································································································
+//    Optional multi producer submission queue (not owned by driver; NULL --> tryToSend is single producer)
+//    tryToSend pushes frames with idx == 0 in the queue, lock free, and returns false if it is full. The
+//    caller that acquires the queue consumer role (a sending task, or isr) moves queued frames into the
+//    transmit FIFO / driver transmit buffer for all producers; the others return at once.
+//······················································································································
+
+  public: void setSubmissionQueue (ACAN2517SubmissionQueue * inSubmissionQueue) {
+    noInterrupts () ;
+      mSubmissionQueue = inSubmissionQueue ;
+    interrupts () ;
+  }
+
+  private: ACAN2517SubmissionQueue * mSubmissionQueue = NULL ;
+
+  private: void flushSubmissionQueue (void) ;
+  private: void drainSubmissionQueue (void) ;
+
+//······················································································································
+//    Optional wait primitive for blocking receive and send (not owned by driver; NULL --> they call yield)
+//    Its signal method is invoked by isr when a receive or transmit FIFO interrupt has been handled.
+//······················································································································
+
+  public: void setWaitPrimitive (ACAN2517Wait * inWait) {
+    noInterrupts () ;
+      mWait = inWait ;
+    interrupts () ;
+  }
+
+  private: ACAN2517Wait * mWait = NULL ;
+
+  private: void waitForEvent (const uint32_t inMaxMicros) ;
+
+//······················································································································
+//    Optional deferred work (not owned by driver; NULL --> all work is done by isr)
+//    isr masks the INT interrupt and calls inDeferredWork->notifyFromISR; the notified task should call
+//    serviceDeferred, that performs the work of isr and unmasks the INT interrupt. Call backs (error state,
+//    frame trace, ...) are then invoked from this task. Other driver methods should be called from task
+//    context (not from a timer interrupt), they are guarded by inDeferredWork lock / unlock.
+//    setDeferredWork should be called before begin.
+//······················································································································
+
+  public: void setDeferredWork (ACAN2517DeferredWork * inDeferredWork) {
+    noInterrupts () ;
+      mDeferredWork = inDeferredWork ;
+    interrupts () ;
+  }
+
+//--- Returns false if isr has not been invoked, and no gateway frame has been submitted, since last call
+  public: bool serviceDeferred (void) ;
+
+  private: ACAN2517DeferredWork * mDeferredWork = NULL ;
+  private: void (* mInterruptServiceRoutine) (void) = NULL ;
+  private: volatile bool mDeferredInterruptPending = false ;
+  private: volatile bool mDeferredSubmissionPending = false ; // Set by submitGatewayFrame
+
+  private: inline void lockDeferredWork (void) {
+    if (NULL != mDeferredWork) {
+      mDeferredWork->lock () ;
+    }
+  }
+
+  private: inline void unlockDeferredWork (void) {
+    if (NULL != mDeferredWork) {
+      mDeferredWork->unlock () ;
+    }
+  }
+
 //······················································································································
 //    Private properties
 //······················································································································
@@ -93,19 +498,38 @@ class ACAN2517 {
   private: uint8_t mCS ;
   private: uint8_t mINT ;
   private: bool mUsesTXQ ;
-  private: bool mControllerTxFIFOFull ;
+  private: bool mFastChipSelect = false ;
+  #if defined (__AVR__)
+    private: volatile uint8_t * mCSOutputRegister = NULL ;
+    private: uint8_t mCSBitMask = 0 ;
+  #elif defined (ARDUINO_ARCH_SAMD)
+    private: volatile uint32_t * mCSSetRegister = NULL ;
+    private: volatile uint32_t * mCSClearRegister = NULL ;
+    private: uint32_t mCSBitMask = 0 ;
+  #elif defined (KINETISK)
+    private: volatile uint8_t * mCSSetRegister = NULL ; // Bit band registers
+    private: volatile uint8_t * mCSClearRegister = NULL ;
+    private: uint8_t mCSBitMask = 1 ;
+  #endif
+  private: volatile bool mControllerTxFIFOFull ; // Read by flushSubmissionQueue outside SPI transaction
 
 //······················································································································
 //    Receive buffer
 //······················································································································
 
-  private: ACANBuffer mDriverReceiveBuffer ;
+  private: ACAN2517ReceiveBuffer mDriverReceiveBuffer ;
+
+  public: uint32_t driverReceiveBufferSize (void) const { return mDriverReceiveBuffer.size () ; }
+
+  public: uint32_t driverReceiveBufferCount (void) const { return mDriverReceiveBuffer.count () ; }
+
+  public: uint32_t driverReceiveBufferPeakCount (void) const { return mDriverReceiveBuffer.peakCount () ; }
 
 //······················································································································
 //    Transmit buffer
 //······················································································································
 
-  private: ACANBuffer mDriverTransmitBuffer ;
+  private: ACAN2517TransmitBuffer mDriverTransmitBuffer ;
 
   public: uint32_t driverTransmitBufferSize (void) const { return mDriverTransmitBuffer.size () ; }
 
@@ -117,17 +541,23 @@ class ACAN2517 {
 //    Private methods
 //······················································································································
 
-  private: void readCommandSPI (const uint16_t inRegisterAddress) ;
-  private: void writeCommandSPI (const uint16_t inRegisterAddress) ;
-  private: uint32_t readWordSPI (void) ;
-  private: void writeWordSPI (const uint32_t inValue) ;
+  private: inline void readCommandSPI (const uint16_t inRegisterAddress) ;
+  private: inline void writeCommandSPI (const uint16_t inRegisterAddress) ;
+  private: inline uint32_t readWordSPI (void) ;
+  private: inline void writeWordSPI (const uint32_t inValue) ;
+
+  private: bool readCRCSPI (const uint16_t inAddress, uint8_t outData [], const uint8_t inLength) ;
+  private: void writeCRCSPI (const uint16_t inAddress, const uint8_t inData [], const uint8_t inLength) ;
+  private: void writeSafeSPI (const uint16_t inAddress, const uint8_t inData [], const uint8_t inLength) ;
+  private: bool controllerReportsCRCError (void) ;
 
   private: void writeRegisterSPI (const uint16_t inRegisterAddress, const uint32_t inValue) ;
   private: uint32_t readRegisterSPI (const uint16_t inRegisterAddress) ;
   private: void writeByteRegisterSPI (const uint16_t inRegisterAddress, const uint8_t inValue) ;
   private: uint8_t readByteRegisterSPI (const uint16_t inRegisterAddress) ;
-  private: void assertCS (void) ;
-  private: void deassertCS (void) ;
+  private: inline void assertCS (void) ;
+  private: inline void deassertCS (void) ;
+  private: void setUpFastChipSelect (const bool inEnable) ;
 
   private: void reset2517FD (void) ;
   private: void writeRegister (const uint16_t inAddress, const uint32_t inValue) ;
@@ -136,16 +566,40 @@ class ACAN2517 {
   private: uint8_t readByteRegister (const uint16_t inAddress) ;
 
   private: bool sendViaTXQ (const CANMessage & inMessage) ;
-  private: bool enterInTransmitBuffer (const CANMessage & inMessage) ;
-  private: void appendInControllerTxFIFO (const CANMessage & inMessage) ;
+  private: bool controllerTXQIsNotFull (void) ;
+  private: bool appendInControllerTXQ (const CANMessage & inMessage) ;
+  private: bool enterInTransmitBuffer (const CANMessage & inMessage, const bool inLatestValue) ;
+  private: bool appendInControllerTxFIFO (const CANMessage & inMessage) ;
+  private: bool writeTransmitObjectSPI (const uint16_t inUARegister, const CANMessage & inMessage) ;
+  private: bool releaseTransmitObjectSPI (const uint16_t inCONRegister) ;
+  private: bool readReceiveObjectSPI (ACANPackedFrame & outFrame) ;
 
 //······················································································································
 //    Interrupt service routine
 //······················································································································
 
   public: void isr (void) ;
+  private: void serviceInterrupt (void) ;
   private: void receiveInterrupt (void) ;
   private: void transmitInterrupt (void) ;
+  private: void errorStateInterrupt (void) ;
+  private: void modeChangeInterrupt (void) ;
+  private: void restartTransmission (void) ;
+  private: void eccInterrupt (void) ;
+  private: void spiCRCInterrupt (void) ;
+
+//······················································································································
+//    Static driver buffer and call back array storage (see ACAN2517Static), should be called before begin
+//······················································································································
+
+  protected: template <uint16_t TRANSMIT_SIZE> void useDriverBufferStorage (ACAN2517TransmitBuffer::Storage <TRANSMIT_SIZE> & inTransmitStorage,
+                                                                            ACANPackedFrame * inReceiveStorage,
+                                                                            const uint16_t inReceiveSize,
+                                                                            ACANCallBackRoutine inCallBackStorage [32]) {
+    mDriverTransmitBuffer.useStorage (inTransmitStorage) ;
+    mDriverReceiveBuffer.useStorage (inReceiveStorage, inReceiveSize) ;
+    mStaticCallBackArray = inCallBackStorage ;
+  }
 
 //······················································································································
 //    No copy
@@ -160,3 +614,36 @@ class ACAN2517 {
 
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   ACAN2517Static class
+//   Driver transmit and receive buffers are members, sized by template arguments (settings
+//   mDriverTransmitFIFOSize and mDriverReceiveFIFOSize are ignored), and so is the call back array used by
+//   runtime filter changes: with a filter array, neither begin nor runtime filter changes allocate any memory.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+template <uint16_t DRIVER_TRANSMIT_SIZE, uint16_t DRIVER_RECEIVE_SIZE> class ACAN2517Static : public ACAN2517 {
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517Static (const uint8_t inCS, // CS input of MCP2517FD
+                          SPIClass & inSPI, // Hardware SPI object
+                          const uint8_t inINT) : // INT output of MCP2517FD
+  ACAN2517 (inCS, inSPI, inINT) {
+    useDriverBufferStorage (mTransmitStorage, mReceiveStorage, DRIVER_RECEIVE_SIZE, mCallBackStorage) ;
+  }
+
+//······················································································································
+//   PRIVATE PROPERTIES
+//······················································································································
+
+  private: ACAN2517TransmitBuffer::Storage <DRIVER_TRANSMIT_SIZE> mTransmitStorage ;
+  private: ACANPackedFrame mReceiveStorage [(DRIVER_RECEIVE_SIZE > 0) ? DRIVER_RECEIVE_SIZE : 1] ;
+  private: ACANCallBackRoutine mCallBackStorage [32] ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
@@ -0,0 +1,55 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Deferred work hooks for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_DEFERRED_WORK_CLASS_DEFINED
+#define ACAN2517_DEFERRED_WORK_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517DeferredWork class
+//  When an instance is given to ACAN2517::setDeferredWork, isr only masks the INT interrupt and invokes
+//  notifyFromISR; the task (or thread) it wakes up should call ACAN2517::serviceDeferred, that performs the
+//  SPI work and unmasks the INT interrupt. serviceDeferred runs between lock and unlock; driver methods
+//  called from other tasks also do, so that they cannot be preempted by serviceDeferred. Subclass it with the
+//  primitives of your RTOS (see README), or use ACAN2517DeferredWorkThread (std::thread, host builds).
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517DeferredWork {
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: virtual ~ ACAN2517DeferredWork (void) {}
+
+//······················································································································
+//   NOTIFICATION (interrupt context): wake up the task that calls serviceDeferred
+//······················································································································
+
+  public: virtual void notifyFromISR (void) = 0 ;
+
+//······················································································································
+//   NOTIFICATION (task context): used by a gateway source driver in deferred work mode; default implementation
+//   calls notifyFromISR, override it if the RTOS has a distinct task context primitive
+//······················································································································
+
+  public: virtual void notify (void) { notifyFromISR () ; }
+
+//······················································································································
+//   MUTUAL EXCLUSION (task context): default implementation is for a single task
+//······················································································································
+
+  public: virtual void lock (void) {}
+
+  public: virtual void unlock (void) {}
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,127 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// std::thread based deferred work for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// Intended for host testing, and for cores that provide std::thread; it is not included by ACAN2517.h.
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_DEFERRED_WORK_THREAD_CLASS_DEFINED
+#define ACAN2517_DEFERRED_WORK_THREAD_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517DeferredWorkThread class
+//  start launches a thread that calls serviceDeferred every time isr notifies it; lock and unlock use a
+//  std::mutex, so driver methods should not be called from driver call backs.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517DeferredWorkThread : public ACAN2517DeferredWork {
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517DeferredWorkThread (ACAN2517 & inCAN) :
+  mCAN (inCAN) {
+  }
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: virtual ~ ACAN2517DeferredWorkThread (void) {
+    stop () ;
+  }
+
+//······················································································································
+//   START / STOP
+//······················································································································
+
+  public: void start (void) {
+    if (!mThread.joinable ()) {
+      mStopRequested = false ;
+      mThread = std::thread ([this] { run () ; }) ;
+    }
+  }
+
+  public: void stop (void) {
+    if (mThread.joinable ()) {
+      { std::lock_guard <std::mutex> guard (mNotificationMutex) ;
+        mStopRequested = true ;
+      }
+      mNotification.notify_one () ;
+      mThread.join () ;
+    }
+  }
+
+//······················································································································
+//   ACAN2517DeferredWork
+//······················································································································
+
+  public: virtual void notifyFromISR (void) {
+    { std::lock_guard <std::mutex> guard (mNotificationMutex) ;
+      mNotified = true ;
+    }
+    mNotification.notify_one () ;
+  }
+
+  public: virtual void lock (void) { mMutex.lock () ; }
+
+  public: virtual void unlock (void) { mMutex.unlock () ; }
+
+//······················································································································
+//   ACCESSOR
+//······················································································································
+
+  public: uint32_t serviceCount (void) const { return mServiceCount ; }
+
+//······················································································································
+//   PRIVATE
+//······················································································································
+
+  private: void run (void) {
+    std::unique_lock <std::mutex> guard (mNotificationMutex) ;
+    while (!mStopRequested) {
+      mNotification.wait (guard, [this] { return mNotified || mStopRequested ; }) ;
+      if (mNotified) {
+        mNotified = false ;
+        guard.unlock () ;
+          if (mCAN.serviceDeferred ()) {
+            mServiceCount += 1 ;
+          }
+        guard.lock () ;
+      }
+    }
+  }
+
+  private: ACAN2517 & mCAN ;
+  private: std::thread mThread ;
+  private: std::mutex mMutex ;
+  private: std::mutex mNotificationMutex ;
+  private: std::condition_variable mNotification ;
+  private: bool mNotified = false ;
+  private: bool mStopRequested = false ;
+  private: volatile uint32_t mServiceCount = 0 ;
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517DeferredWorkThread (const ACAN2517DeferredWorkThread &) ;
+  private: ACAN2517DeferredWorkThread & operator = (const ACAN2517DeferredWorkThread &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,364 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// Filter compiler: packs an identifier set into mask / acceptance filters, with an exact software check
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_FILTER_COMPILER_CLASS_DEFINED
+#define ACAN2517_FILTER_COMPILER_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517Filters.h>
+#include <ACANPackedFrame.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517FilterCompiler class
+//  compile packs the wanted identifiers (standard and extended) into at most N mask / acceptance filters.
+//  It starts with one filter per identifier, and merges the two filters of the same format whose merge
+//  admits the fewest more identifiers (a merged filter ignores the bits where the merged filters differ),
+//  until N filters remain; filters covered by a merged filter are removed. Filters that admit unwanted
+//  identifiers are not exact: installed as software filter in the driver (setSoftwareFilter), the compiler
+//  discards in isr, by a binary search in the sorted identifier table, the unwanted frames they admit.
+//  Compilation allocates memory and runs in O(n^3) for n identifiers in the worst case (every merge may
+//  recompute the best partner, in O(n), of O(n) groups): call it in setup.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517FilterCompiler {
+
+//······················································································································
+//   COMPILED FILTER
+//······················································································································
+
+  public: class CompiledFilter {
+    public: bool mAnyFormat = false ; // Pass all filter (only if standard and extended identifiers, N == 1)
+    public: tFrameFormat mFormat = kStandard ;
+    public: uint32_t mMask = 0 ;
+    public: uint32_t mAcceptance = 0 ;
+    public: uint32_t mWantedCount = 0 ; // Wanted identifiers admitted by filter
+    public: uint32_t mAdmittedCount = 0 ; // Identifiers admitted by filter
+
+    public: bool exact (void) const { return mWantedCount == mAdmittedCount ; }
+  } ;
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  public: static const uint32_t kExtendedFlag = 1UL << 31 ;
+  public: static const uint8_t kMaxFilterCount = 32 ;
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517FilterCompiler (void) {}
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517FilterCompiler (void) {
+    delete [] mKeys ;
+  }
+
+//······················································································································
+//   INITIALIZATION
+//······················································································································
+
+  public: void initWithSize (const uint32_t inIdentifierCapacity) {
+    delete [] mKeys ;
+    mKeys = new uint32_t [inIdentifierCapacity] ;
+    mCapacity = inIdentifierCapacity ;
+    mKeyCount = 0 ;
+    mFilterCount = 0 ;
+  }
+
+//······················································································································
+//   IDENTIFIER SET (returns false if table is full or identifier is too large; duplicates are ignored)
+//······················································································································
+
+  public: bool addIdentifier (const tFrameFormat inFormat, const uint32_t inIdentifier) {
+    const bool extended = inFormat == kExtended ;
+    bool ok = inIdentifier <= (extended ? 0x1FFFFFFFUL : 0x7FFUL) ;
+    if (ok) {
+      const uint32_t key = extended ? (inIdentifier | kExtendedFlag) : inIdentifier ;
+      const uint32_t idx = lowerBound (key) ;
+      if ((idx >= mKeyCount) || (mKeys [idx] != key)) {
+        ok = mKeyCount < mCapacity ;
+        if (ok) { // Keep table sorted
+          for (uint32_t i = mKeyCount ; i > idx ; i--) {
+            mKeys [i] = mKeys [i - 1] ;
+          }
+          mKeys [idx] = key ;
+          mKeyCount += 1 ;
+        }
+      }
+    }
+    return ok ;
+  }
+
+  public: uint32_t identifierCount (void) const { return mKeyCount ; }
+
+  public: bool isWanted (const tFrameFormat inFormat, const uint32_t inIdentifier) const {
+    const uint32_t key = (inFormat == kExtended) ? (inIdentifier | kExtendedFlag) : inIdentifier ;
+    const uint32_t idx = lowerBound (key) ;
+    return (idx < mKeyCount) && (mKeys [idx] == key) ;
+  }
+
+//······················································································································
+//   COMPILE (returns false if identifier set is empty, or inMaxFilterCount is 0)
+//······················································································································
+
+  public: bool compile (const uint8_t inMaxFilterCount) {
+    const uint8_t maxFilterCount = (inMaxFilterCount > kMaxFilterCount) ? kMaxFilterCount : inMaxFilterCount ;
+    mFilterCount = 0 ;
+    const bool ok = (mKeyCount > 0) && (maxFilterCount > 0) ;
+    if (ok) {
+      const bool hasStandard = (mKeys [0] & kExtendedFlag) == 0 ;
+      const bool hasExtended = (mKeys [mKeyCount - 1] & kExtendedFlag) != 0 ;
+      if (hasStandard && hasExtended && (maxFilterCount == 1)) {
+        CompiledFilter & f = mFilters [0] ;
+        f = CompiledFilter () ;
+        f.mAnyFormat = true ;
+        f.mWantedCount = mKeyCount ;
+        f.mAdmittedCount = (1UL << 11) + (1UL << 29) ;
+        mFilterCount = 1 ;
+      }else{
+        merge (maxFilterCount) ;
+      }
+    }
+    return ok ;
+  }
+
+//······················································································································
+//   RESULT
+//······················································································································
+
+  public: uint8_t filterCount (void) const { return mFilterCount ; }
+
+  public: const CompiledFilter & filterAt (const uint8_t inIndex) const { return mFilters [inIndex] ; }
+
+//--- Identifiers admitted by compiled filters (false accepts are an upper bound if filters overlap)
+  public: uint64_t admittedCount (void) const {
+    uint64_t result = 0 ;
+    for (uint8_t i = 0 ; i < mFilterCount ; i++) {
+      result += mFilters [i].mAdmittedCount ;
+    }
+    return result ;
+  }
+
+  public: uint64_t falseAcceptCount (void) const { return admittedCount () - mKeyCount ; }
+
+//--- Unwanted identifiers among admitted ones, in per-mille
+  public: uint32_t falseAcceptRatio (void) const {
+    const uint64_t admitted = admittedCount () ;
+    return (admitted == 0) ? 0 : (uint32_t) ((falseAcceptCount () * 1000) / admitted) ;
+  }
+
+//······················································································································
+//   INSTALL COMPILED FILTERS (same call back routine for all)
+//······················································································································
+
+  public: void appendTo (ACAN2517Filters & ioFilters, const ACANCallBackRoutine inCallBackRoutine) {
+    mFirstFilterIndex = ioFilters.filterCount () ;
+    mInexactFilters = 0 ;
+    for (uint8_t i = 0 ; i < mFilterCount ; i++) {
+      const CompiledFilter & f = mFilters [i] ;
+      if (f.mAnyFormat) {
+        ioFilters.appendPassAllFilter (inCallBackRoutine) ;
+      }else{
+        ioFilters.appendFilter (f.mFormat, f.mMask, f.mAcceptance, inCallBackRoutine) ;
+      }
+      if (!f.exact ()) {
+        mInexactFilters |= 1UL << i ;
+      }
+    }
+  }
+
+//······················································································································
+//   SOFTWARE CHECK (called by driver receive isr, see ACAN2517::setSoftwareFilter)
+//   Returns false for an unwanted frame admitted by a compiled filter that is not exact; frames of other
+//   filters are accepted.
+//······················································································································
+
+  public: bool accepts (const ACANPackedFrame & inFrame) const {
+    const uint8_t filter = (uint8_t) (inFrame.filterIndex () - mFirstFilterIndex) ;
+    bool result = (filter >= mFilterCount) || (((mInexactFilters >> filter) & 1) == 0) ;
+    if (!result) {
+      const uint32_t key = inFrame.isExtended () ? (inFrame.identifier () | kExtendedFlag) : inFrame.identifier () ;
+      const uint32_t idx = lowerBound (key) ;
+      result = (idx < mKeyCount) && (mKeys [idx] == key) ;
+    }
+    return result ;
+  }
+
+//······················································································································
+//   PRIVATE TYPES AND PROPERTIES
+//······················································································································
+
+  private: class Group {
+    public: uint32_t mMask ;
+    public: uint32_t mAcceptance ;
+    public: uint32_t mBestCost ; // Admitted identifiers added by merge with mBestPartner
+    public: uint32_t mBestPartner ;
+    public: bool mExtended ;
+    public: bool mAlive ;
+  } ;
+
+  private: uint32_t * mKeys = NULL ; // Sorted
+  private: uint32_t mCapacity = 0 ;
+  private: uint32_t mKeyCount = 0 ;
+  private: CompiledFilter mFilters [kMaxFilterCount] ;
+  private: uint8_t mFilterCount = 0 ;
+  private: uint8_t mFirstFilterIndex = 0 ;
+  private: uint32_t mInexactFilters = 0 ; // Bit n set: compiled filter n is not exact
+
+//······················································································································
+//   PRIVATE METHODS
+//······················································································································
+
+  private: uint32_t lowerBound (const uint32_t inKey) const {
+    uint32_t low = 0 ;
+    uint32_t high = mKeyCount ;
+    while (low < high) {
+      const uint32_t mid = (low + high) / 2 ;
+      if (mKeys [mid] < inKey) {
+        low = mid + 1 ;
+      }else{
+        high = mid ;
+      }
+    }
+    return low ;
+  }
+
+  private: static uint32_t admitted (const uint32_t inMask, const bool inExtended) {
+    return 1UL << ((inExtended ? 29 : 11) - __builtin_popcountl (inMask)) ;
+  }
+
+//--- Identifiers added by merging two groups (UINT32_MAX if formats differ)
+  private: static uint32_t mergeCost (const Group & inA, const Group & inB) {
+    uint32_t cost = UINT32_MAX ;
+    if (inA.mExtended == inB.mExtended) {
+      const uint32_t mask = inA.mMask & inB.mMask & ~ (inA.mAcceptance ^ inB.mAcceptance) ;
+      const uint32_t merged = admitted (mask, inA.mExtended) ;
+      const uint32_t separate = admitted (inA.mMask, inA.mExtended) + admitted (inB.mMask, inB.mExtended) ;
+      cost = (merged > separate) ? (merged - separate) : 0 ; // Groups may overlap
+    }
+    return cost ;
+  }
+
+  private: static void updateBest (Group ioGroups [], const uint32_t inCount, const uint32_t inIndex) {
+    Group & g = ioGroups [inIndex] ;
+    g.mBestCost = UINT32_MAX ;
+    g.mBestPartner = inIndex ;
+    for (uint32_t i = 0 ; i < inCount ; i++) {
+      if ((i != inIndex) && ioGroups [i].mAlive) {
+        const uint32_t cost = mergeCost (g, ioGroups [i]) ;
+        if (g.mBestCost > cost) {
+          g.mBestCost = cost ;
+          g.mBestPartner = i ;
+        }
+      }
+    }
+  }
+
+  private: void merge (const uint8_t inMaxFilterCount) {
+    Group * groups = new Group [mKeyCount] ;
+    const uint32_t mask = 0x1FFFFFFF ;
+    for (uint32_t i = 0 ; i < mKeyCount ; i++) {
+      const bool extended = (mKeys [i] & kExtendedFlag) != 0 ;
+      groups [i].mExtended = extended ;
+      groups [i].mMask = extended ? mask : 0x7FF ;
+      groups [i].mAcceptance = mKeys [i] & mask ;
+      groups [i].mAlive = true ;
+    }
+    for (uint32_t i = 0 ; i < mKeyCount ; i++) {
+      updateBest (groups, mKeyCount, i) ;
+    }
+    uint32_t aliveCount = mKeyCount ;
+    bool loop = aliveCount > inMaxFilterCount ;
+    while (loop) {
+    //--- Cheapest merge
+      uint32_t a = 0 ;
+      uint32_t bestCost = UINT32_MAX ;
+      for (uint32_t i = 0 ; i < mKeyCount ; i++) {
+        if (groups [i].mAlive && (bestCost > groups [i].mBestCost)) {
+          bestCost = groups [i].mBestCost ;
+          a = i ;
+        }
+      }
+    //--- No merge if only groups of different formats remain (does not occur if inMaxFilterCount > 1)
+      loop = bestCost != UINT32_MAX ;
+      if (loop) {
+        const uint32_t b = groups [a].mBestPartner ;
+        Group & g = groups [a] ;
+        g.mMask &= groups [b].mMask & ~ (g.mAcceptance ^ groups [b].mAcceptance) ;
+        g.mAcceptance &= g.mMask ;
+      //--- Remove partner, and groups covered by merged group
+        for (uint32_t i = 0 ; i < mKeyCount ; i++) {
+          Group & h = groups [i] ;
+          if ((i != a) && h.mAlive && (h.mExtended == g.mExtended)
+           && ((h.mMask & g.mMask) == g.mMask) && ((h.mAcceptance & g.mMask) == g.mAcceptance)) {
+            h.mAlive = false ;
+            aliveCount -= 1 ;
+          }
+        }
+      //--- Update best partners
+        updateBest (groups, mKeyCount, a) ;
+        for (uint32_t i = 0 ; i < mKeyCount ; i++) {
+          Group & h = groups [i] ;
+          if ((i != a) && h.mAlive) {
+            if (!groups [h.mBestPartner].mAlive || (h.mBestPartner == a)) {
+              updateBest (groups, mKeyCount, i) ;
+            }else{
+              const uint32_t cost = mergeCost (h, g) ;
+              if (h.mBestCost > cost) {
+                h.mBestCost = cost ;
+                h.mBestPartner = a ;
+              }
+            }
+          }
+        }
+        loop = aliveCount > inMaxFilterCount ;
+      }
+    }
+  //--- Compiled filters
+    for (uint32_t i = 0 ; i < mKeyCount ; i++) {
+      const Group & g = groups [i] ;
+      if (g.mAlive) {
+        CompiledFilter & f = mFilters [mFilterCount] ;
+        f = CompiledFilter () ;
+        f.mFormat = g.mExtended ? kExtended : kStandard ;
+        f.mMask = g.mMask ;
+        f.mAcceptance = g.mAcceptance ;
+        f.mAdmittedCount = admitted (g.mMask, g.mExtended) ;
+        for (uint32_t k = 0 ; k < mKeyCount ; k++) {
+          const bool extended = (mKeys [k] & kExtendedFlag) != 0 ;
+          if ((extended == g.mExtended) && ((mKeys [k] & g.mMask) == g.mAcceptance)) {
+            f.mWantedCount += 1 ;
+          }
+        }
+        mFilterCount += 1 ;
+      }
+    }
+    delete [] groups ;
+  }
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517FilterCompiler (const ACAN2517FilterCompiler &) ;
+  private: ACAN2517FilterCompiler & operator = (const ACAN2517FilterCompiler &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -216,6 +216,103 @@ class ACAN2517Filters {
 
 } ;
 
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517Filter class
+//  A literal filter type, for filter tables defined as constexpr arrays (no heap allocation, see
+//  ACAN2517::begin): factory functions mirror the append methods of ACAN2517Filters, and record the same
+//  filter status. Call back routines should be functions (not lambda expressions, that are not constexpr in
+//  C++11). A table can be checked at compile time:
+//    static_assert (ACAN2517Filter::areValid (FILTERS, FILTER_COUNT), "Invalid filter") ;
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517Filter {
+
+//······················································································································
+//   PROPERTIES
+//······················································································································
+
+  public: const uint32_t mFilterMask ;
+  public: const uint32_t mAcceptanceFilter ;
+  public: const ACANCallBackRoutine mCallBackRoutine ;
+  public: const ACAN2517Filters::FilterStatus mFilterStatus ;
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: constexpr ACAN2517Filter (const uint32_t inFilterMask,
+                                    const uint32_t inAcceptanceFilter,
+                                    const ACANCallBackRoutine inCallBackRoutine,
+                                    const ACAN2517Filters::FilterStatus inFilterStatus = ACAN2517Filters::kFiltersOk) :
+  mFilterMask (inFilterMask),
+  mAcceptanceFilter (inAcceptanceFilter),
+  mCallBackRoutine (inCallBackRoutine),
+  mFilterStatus (inFilterStatus) {
+  }
+
+//······················································································································
+//   FACTORY FUNCTIONS
+//······················································································································
+
+  public: static constexpr ACAN2517Filter passAllFilter (const ACANCallBackRoutine inCallBackRoutine) {
+    return ACAN2517Filter (0, 0, inCallBackRoutine) ;
+  }
+
+  public: static constexpr ACAN2517Filter formatFilter (const tFrameFormat inFormat,
+                                                        const ACANCallBackRoutine inCallBackRoutine) {
+    return ACAN2517Filter (1UL << 30, (inFormat == kExtended) ? (1UL << 30) : 0, inCallBackRoutine) ;
+  }
+
+  public: static constexpr ACAN2517Filter frameFilter (const tFrameFormat inFormat,
+                                                       const uint32_t inIdentifier,
+                                                       const ACANCallBackRoutine inCallBackRoutine) {
+    return ACAN2517Filter (
+      (1UL << 30) | ((inFormat == kExtended) ? 0x1FFFFFFFUL : 0x7FFUL),
+      inIdentifier | ((inFormat == kExtended) ? (1UL << 30) : 0),
+      inCallBackRoutine,
+      (inFormat == kExtended)
+        ? ((inIdentifier > 0x1FFFFFFF) ? ACAN2517Filters::kExtendedIdentifierTooLarge : ACAN2517Filters::kFiltersOk)
+        : ((inIdentifier > 0x7FF) ? ACAN2517Filters::kStandardIdentifierTooLarge : ACAN2517Filters::kFiltersOk)
+    ) ;
+  }
+
+  public: static constexpr ACAN2517Filter filter (const tFrameFormat inFormat,
+                                                  const uint32_t inMask,
+                                                  const uint32_t inAcceptance,
+                                                  const ACANCallBackRoutine inCallBackRoutine) {
+    return ACAN2517Filter (
+      (1UL << 30) | inMask,
+      ((inFormat == kExtended) ? (1UL << 30) : 0) | inAcceptance,
+      inCallBackRoutine,
+      filterStatus (inFormat, inMask, inAcceptance)
+    ) ;
+  }
+
+//······················································································································
+//   VALIDATION
+//······················································································································
+
+  public: static constexpr bool areValid (const ACAN2517Filter * inFilters, const uint8_t inCount) {
+    return (inCount == 0)
+      || ((inFilters [0].mFilterStatus == ACAN2517Filters::kFiltersOk) && areValid (inFilters + 1, inCount - 1)) ;
+  }
+
+//--- Same priority as ACAN2517Filters::appendFilter: mask error, then acceptance error, then inconsistency
+  private: static constexpr ACAN2517Filters::FilterStatus filterStatus (const tFrameFormat inFormat,
+                                                                        const uint32_t inMask,
+                                                                        const uint32_t inAcceptance) {
+    return ((inFormat == kExtended) && (inMask > 0x1FFFFFFF)) ? ACAN2517Filters::kExtendedMaskTooLarge
+      : ((inFormat == kStandard) && (inMask > 0x7FF)) ? ACAN2517Filters::kStandardMaskTooLarge
+      : ((inFormat == kExtended) && (inAcceptance > 0x1FFFFFFF)) ? ACAN2517Filters::kExtendedAcceptanceTooLarge
+      : ((inFormat == kStandard) && (inAcceptance > 0x7FF)) ? ACAN2517Filters::kStandardAcceptanceTooLarge
+      : ((inMask & inAcceptance) != inAcceptance) ? ACAN2517Filters::kInconsistencyBetweenMaskAndAcceptance
+      : ACAN2517Filters::kFiltersOk ;
+  }
+
+//······················································································································
+
+} ;
+
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 #endif
@@ -0,0 +1,391 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// Gateway between two controllers: routing table, executed by the isr of the receiving driver
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_GATEWAY_CLASS_DEFINED
+#define ACAN2517_GATEWAY_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517 ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517Gateway class
+//  Installed in the receiving driver (setGateway), it routes every received frame with the route of its
+//  identifier (open addressing table), or with the default action:
+//    - Forward: frame is sent unchanged by the destination driver;
+//    - Rewrite: frame is sent with the route new identifier and format;
+//    - Drop: frame is discarded;
+//    - Local: frame goes to the receive path of the receiving driver (ISO-TP, receive cache, receive buffer).
+//  A route may have a minimum interval: a frame received less than this interval after the last forwarded
+//  frame of the route is discarded. A forwarded frame is held until the receiving isr has ended its SPI
+//  transaction, then the isr submits it to destination tryToSend (controllers may share the SPI bus).
+//  Counters are updated by isr, bracketed by a sequence counter: readers do not disable interrupts.
+//  One gateway object per direction.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517Gateway {
+
+//······················································································································
+//   ACTIONS
+//······················································································································
+
+  public: typedef enum : uint8_t { Forward, Rewrite, Drop, Local } Action ;
+
+//······················································································································
+//   PER ROUTE STATISTICS
+//······················································································································
+
+  public: class RouteStatistics {
+    public: uint32_t mIdentifier = 0 ; // Bit 31: set for extended frame
+    public: uint32_t mFrameCount = 0 ; // Received frames routed by this route
+    public: uint32_t mForwardedCount = 0 ; // Frames accepted by destination tryToSend
+    public: uint32_t mDroppedCount = 0 ; // Frames discarded by Drop action
+    public: uint32_t mRateLimitedCount = 0 ; // Frames discarded by minimum interval
+    public: uint32_t mDestinationFullCount = 0 ; // Frames rejected by destination tryToSend
+    public: uint32_t mLatencySum = 0 ; // In µs, from frame read to destination tryToSend return (saturates)
+    public: uint32_t mMinLatency = UINT32_MAX ; // In µs
+    public: uint32_t mMaxLatency = 0 ; // In µs
+
+    public: bool extended (void) const { return (mIdentifier & kExtendedFlag) != 0 ; }
+    public: uint32_t identifier (void) const { return mIdentifier & ~ kExtendedFlag ; }
+    public: uint32_t averageLatency (void) const {
+      return (mForwardedCount == 0) ? 0 : (mLatencySum / mForwardedCount) ;
+    }
+  } ;
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  public: static const uint32_t kExtendedFlag = 1UL << 31 ;
+
+  private: static const uint32_t kFreeSlot = UINT32_MAX ; // Not a valid key (bits 30-29 are never set)
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517Gateway (void) {}
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517Gateway (void) {
+    delete [] mRoutes ;
+  }
+
+//······················································································································
+//   INITIALIZATION (before installing in driver)
+//   inRouteCapacity is rounded up to a power of 2; table is kept at most 3/4 full
+//······················································································································
+
+  public: void initWithSize (const uint32_t inRouteCapacity) {
+    uint32_t size = 4 ;
+    mHashShift = 30 ;
+    while (((size * 3) / 4) < inRouteCapacity) {
+      size <<= 1 ;
+      mHashShift -= 1 ;
+    }
+    delete [] mRoutes ;
+    mRoutes = new Route [size] ;
+    mTableSize = size ;
+    mMaxEntryCount = (size * 3) / 4 ;
+    mEntryCount = 0 ;
+    for (uint32_t i=0 ; i<mTableSize ; i++) {
+      mRoutes [i].mStatistics.mIdentifier = kFreeSlot ;
+    }
+  }
+
+//······················································································································
+//   CONFIGURATION (before installing in driver)
+//······················································································································
+
+//--- Destination driver (NULL: Forward and Rewrite actions behave as Local)
+  public: void setDestination (ACAN2517 * inDestination) { mDestination = inDestination ; }
+
+  public: ACAN2517 * destination (void) const { return mDestination ; }
+
+//--- Action of frames without route (Rewrite behaves as Forward); default is Forward
+  public: void setDefaultAction (const Action inAction) {
+    mDefaultRoute.mAction = (inAction == Rewrite) ? Forward : inAction ;
+  }
+
+//--- Returns false if table is full, or identifier has already a route
+  public: bool addRoute (const tFrameFormat inFormat,
+                         const uint32_t inIdentifier,
+                         const Action inAction,
+                         const uint32_t inMinIntervalMicros = 0) {
+    return addRoute (inFormat, inIdentifier, inAction, inFormat, inIdentifier, inMinIntervalMicros) ;
+  }
+
+  public: bool addRewriteRoute (const tFrameFormat inFormat,
+                                const uint32_t inIdentifier,
+                                const tFrameFormat inNewFormat,
+                                const uint32_t inNewIdentifier,
+                                const uint32_t inMinIntervalMicros = 0) {
+    return addRoute (inFormat, inIdentifier, Rewrite, inNewFormat, inNewIdentifier, inMinIntervalMicros) ;
+  }
+
+//······················································································································
+//   ROUTE (called by receiving driver isr; returns false if frame goes to the receive path)
+//······················································································································
+
+  public: bool route (const CANMessage & inMessage, const uint32_t inDate) {
+    const uint32_t key = inMessage.ext ? (inMessage.id | kExtendedFlag) : inMessage.id ;
+    Route * route = lookUp (key) ;
+    if (NULL == route) {
+      route = & mDefaultRoute ;
+    }
+    Action action = route->mAction ;
+    if ((action != Drop) && (action != Local) && (NULL == mDestination)) {
+      action = Local ;
+    }
+    beginUpdate () ;
+      route->mStatistics.mFrameCount += 1 ;
+      switch (action) {
+      case Local :
+        break ;
+      case Drop :
+        route->mStatistics.mDroppedCount += 1 ;
+        break ;
+      case Forward :
+      case Rewrite :
+        if ((route->mMinInterval > 0)
+         && route->mHasForwarded
+         && ((inDate - route->mLastForwardDate) < route->mMinInterval)) {
+          route->mStatistics.mRateLimitedCount += 1 ;
+        }else if (NULL != mPendingRoute) { // Previous frame not submitted yet (should not occur)
+          route->mStatistics.mDestinationFullCount += 1 ;
+        }else{
+          mPendingFrame = inMessage ;
+          mPendingFrame.idx = 0 ; // Destination transmit FIFO (receive idx is the matching filter)
+          if (action == Rewrite) {
+            mPendingFrame.id = route->mNewKey & ~ kExtendedFlag ;
+            mPendingFrame.ext = (route->mNewKey & kExtendedFlag) != 0 ;
+          }
+          mPendingDate = inDate ;
+          mPendingRoute = route ;
+          route->mLastForwardDate = inDate ;
+          route->mHasForwarded = true ;
+        }
+        break ;
+      }
+    endUpdate () ;
+    return action != Local ;
+  }
+
+//······················································································································
+//   FORWARD (called by receiving driver isr, after its SPI transaction)
+//······················································································································
+
+  public: bool takePendingFrame (CANMessage & outMessage) const {
+    const bool pending = NULL != mPendingRoute ;
+    if (pending) {
+      outMessage = mPendingFrame ;
+    }
+    return pending ;
+  }
+
+  public: void recordForwarding (const bool inAccepted, const uint32_t inDate) {
+    Route * route = mPendingRoute ;
+    if (NULL != route) {
+      beginUpdate () ;
+        RouteStatistics & statistics = route->mStatistics ;
+        if (!inAccepted) {
+          statistics.mDestinationFullCount += 1 ;
+          route->mHasForwarded = false ; // Next frame is not rate limited by a rejected one
+        }else{
+          const uint32_t latency = inDate - mPendingDate ;
+          statistics.mForwardedCount += 1 ;
+          statistics.mLatencySum = (statistics.mLatencySum > (UINT32_MAX - latency))
+            ? UINT32_MAX
+            : (statistics.mLatencySum + latency) ;
+          if (statistics.mMinLatency > latency) {
+            statistics.mMinLatency = latency ;
+          }
+          if (statistics.mMaxLatency < latency) {
+            statistics.mMaxLatency = latency ;
+          }
+        }
+        mPendingRoute = NULL ;
+      endUpdate () ;
+    }
+  }
+
+//······················································································································
+//   READERS (task context, interrupts are not disabled)
+//······················································································································
+
+  public: uint32_t routeCount (void) const { return mEntryCount ; }
+  public: uint32_t routeCapacity (void) const { return mMaxEntryCount ; }
+
+//--- Statistics of frames without route (mIdentifier is not significant)
+  public: void defaultRouteStatistics (RouteStatistics & outStatistics) const {
+    uint32_t sequence ;
+    do{
+      sequence = beginRead () ;
+      outStatistics = mDefaultRoute.mStatistics ;
+    }while (retryRead (sequence)) ;
+  }
+
+//--- Copy statistics of a route (returns false if identifier has no route)
+  public: bool statisticsForIdentifier (const tFrameFormat inFormat,
+                                        const uint32_t inIdentifier,
+                                        RouteStatistics & outStatistics) const {
+    const uint32_t key = (inFormat == kExtended) ? (inIdentifier | kExtendedFlag) : inIdentifier ;
+    const Route * route = find (key) ;
+    if (NULL != route) {
+      uint32_t sequence ;
+      do{
+        sequence = beginRead () ;
+        outStatistics = route->mStatistics ;
+      }while (retryRead (sequence)) ;
+    }
+    return NULL != route ;
+  }
+
+//--- Iterate over routes: inSlot is 0 ... slotCount () - 1, returns false for a free slot
+  public: uint32_t slotCount (void) const { return mTableSize ; }
+
+  public: bool statisticsAtSlot (const uint32_t inSlot, RouteStatistics & outStatistics) const {
+    bool used = false ;
+    if (inSlot < mTableSize) {
+      uint32_t sequence ;
+      do{
+        sequence = beginRead () ;
+        outStatistics = mRoutes [inSlot].mStatistics ;
+        used = outStatistics.mIdentifier != kFreeSlot ;
+      }while (retryRead (sequence)) ;
+    }
+    return used ;
+  }
+
+//······················································································································
+//   PRIVATE TYPES AND PROPERTIES
+//······················································································································
+
+  private: class Route {
+    public: RouteStatistics mStatistics ; // mStatistics.mIdentifier is the key
+    public: uint32_t mNewKey = 0 ; // Rewrite action: new identifier, bit 31 set for extended frame
+    public: uint32_t mMinInterval = 0 ; // In µs, 0: no rate limit
+    public: uint32_t mLastForwardDate = 0 ;
+    public: Action mAction = Forward ;
+    public: bool mHasForwarded = false ;
+  } ;
+
+  private: Route * mRoutes = NULL ;
+  private: uint32_t mTableSize = 0 ; // Power of 2
+  private: uint32_t mMaxEntryCount = 0 ;
+  private: uint32_t mEntryCount = 0 ;
+  private: uint8_t mHashShift = 30 ; // 32 - log2 (mTableSize)
+  private: Route mDefaultRoute ;
+  private: ACAN2517 * mDestination = NULL ;
+  private: CANMessage mPendingFrame ;
+  private: uint32_t mPendingDate = 0 ;
+  private: Route * mPendingRoute = NULL ;
+  private: volatile uint32_t mSequence = 0 ;
+
+//······················································································································
+//   PRIVATE METHODS
+//······················································································································
+
+  private: bool addRoute (const tFrameFormat inFormat,
+                          const uint32_t inIdentifier,
+                          const Action inAction,
+                          const tFrameFormat inNewFormat,
+                          const uint32_t inNewIdentifier,
+                          const uint32_t inMinIntervalMicros) {
+    const uint32_t key = (inFormat == kExtended) ? (inIdentifier | kExtendedFlag) : inIdentifier ;
+    bool ok = (NULL != mRoutes) && (mEntryCount < mMaxEntryCount) && (NULL == find (key)) ;
+    if (ok) {
+      uint32_t idx = hash (key) ;
+      while (mRoutes [idx].mStatistics.mIdentifier != kFreeSlot) {
+        idx = (idx + 1) & (mTableSize - 1) ;
+      }
+      Route & route = mRoutes [idx] ;
+      route.mAction = inAction ;
+      route.mNewKey = (inNewFormat == kExtended) ? (inNewIdentifier | kExtendedFlag) : inNewIdentifier ;
+      route.mMinInterval = inMinIntervalMicros ;
+      route.mStatistics.mIdentifier = key ;
+      mEntryCount += 1 ;
+    }
+    return ok ;
+  }
+
+  private: uint32_t hash (const uint32_t inKey) const { // Fibonacci hashing
+    return ((uint32_t) (inKey * 2654435769UL)) >> mHashShift ;
+  }
+
+//--- Open addressing, linear probing; routes are never removed
+  private: const Route * find (const uint32_t inKey) const {
+    const Route * result = NULL ;
+    uint32_t idx = hash (inKey) ;
+    bool loop = mRoutes != NULL ;
+    while (loop) {
+      const uint32_t key = mRoutes [idx].mStatistics.mIdentifier ;
+      if (key == inKey) {
+        result = & mRoutes [idx] ;
+        loop = false ;
+      }else if (key == kFreeSlot) {
+        loop = false ;
+      }else{
+        idx = (idx + 1) & (mTableSize - 1) ;
+      }
+    }
+    return result ;
+  }
+
+  private: Route * lookUp (const uint32_t inKey) {
+    return (Route *) find (inKey) ;
+  }
+
+//--- Sequence counter: odd while an update is in progress
+  private: void beginUpdate (void) {
+    mSequence = mSequence + 1 ;
+    __asm__ volatile ("" ::: "memory") ;
+  }
+
+  private: void endUpdate (void) {
+    __asm__ volatile ("" ::: "memory") ;
+    mSequence = mSequence + 1 ;
+  }
+
+  private: uint32_t beginRead (void) const {
+    uint32_t sequence ;
+    do{
+      sequence = mSequence ;
+    }while ((sequence & 1) != 0) ;
+    __asm__ volatile ("" ::: "memory") ;
+    return sequence ;
+  }
+
+  private: bool retryRead (const uint32_t inSequence) const {
+    __asm__ volatile ("" ::: "memory") ;
+    return mSequence != inSequence ;
+  }
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517Gateway (const ACAN2517Gateway &) ;
+  private: ACAN2517Gateway & operator = (const ACAN2517Gateway &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
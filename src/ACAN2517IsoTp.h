@@ -0,0 +1,480 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// ISO-TP (ISO 15765-2) transport channel, normal addressing
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_ISO_TP_CLASS_DEFINED
+#define ACAN2517_ISO_TP_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517IsoTp class
+//  A channel sends with mTransmitIdentifier, and receives frames with mReceiveIdentifier (or matching filter
+//  mReceiveFilterIndex). It segments one outgoing payload and reassembles one incoming payload (up to 4095 bytes)
+//  at a time; received frames of the channel are handled by the driver receive interrupt (they do not go to
+//  the driver receive buffer), and frames to send (flow control, consecutive frames) are pulled by the driver
+//  from its isr, as soon as the controller has room: transfers run at the bus rate, not at the loop rate.
+//  With a non zero STmin, consecutive frames are paced by ACAN2517::runIsoTp, that should be called from loop
+//  or from a task (not from an interrupt); it also handles N_Bs and N_Cr time outs.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517IsoTp {
+
+//······················································································································
+//   TRANSFER RESULT
+//······················································································································
+
+  public: typedef enum : uint8_t {
+    TransferOK,
+    TransferInProgress,
+    TimeOutBs, // Sender: no flow control frame received
+    TimeOutCr, // Receiver: no consecutive frame received
+    WrongSequenceNumber,
+    ReceiverOverflow, // Sender: receiver answered flow control "overflow"
+    BufferOverflow, // Receiver: payload larger than buffer, or previous payload not read
+    TransferAborted // Receiver: a new transfer started before the current one completed
+  } Result ;
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  public: static const uint16_t kMaxPayloadLength = 4095 ;
+  public: static const uint8_t kNoFilter = 255 ;
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517IsoTp (const uint32_t inTransmitIdentifier,
+                         const uint32_t inReceiveIdentifier,
+                         const tFrameFormat inFormat = kStandard) :
+  mTransmitIdentifier (inTransmitIdentifier),
+  mReceiveIdentifier (inReceiveIdentifier),
+  mFormat (inFormat) {
+  }
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517IsoTp (void) {
+    delete [] mReceiveBuffer ;
+  }
+
+//······················································································································
+//   SETTINGS (before installing in driver)
+//······················································································································
+
+  public: const uint32_t mTransmitIdentifier ;
+  public: const uint32_t mReceiveIdentifier ;
+  public: const tFrameFormat mFormat ;
+
+//--- If not kNoFilter, received frames are selected by their filter index instead of their identifier:
+//    define a dedicated filter for mReceiveIdentifier
+  public: uint8_t mReceiveFilterIndex = kNoFilter ;
+
+//--- Frames are sent through the TXQ (if the driver has one) instead of the transmit FIFO
+  public: bool mUseTXQ = false ;
+
+//--- Flow control sent by this channel as a receiver: block size (0: no limit) and STmin (raw byte, 0: none)
+  public: uint8_t mBlockSize = 0 ;
+  public: uint8_t mSTmin = 0 ;
+
+//--- N_Bs and N_Cr time out, in µs
+  public: uint32_t mTimeOutMicros = 1000UL * 1000 ;
+
+//--- Frames are padded to 8 bytes with mPaddingByte
+  public: bool mPadFrames = true ;
+  public: uint8_t mPaddingByte = 0xCC ;
+
+//······················································································································
+//   INITIALIZATION (before installing in driver): reassembly buffer size, 7 ... 4095
+//······················································································································
+
+  public: void initWithSize (const uint16_t inReceiveBufferSize) {
+    delete [] mReceiveBuffer ;
+    mReceiveBufferSize = (inReceiveBufferSize < kMaxPayloadLength) ? inReceiveBufferSize : kMaxPayloadLength ;
+    mReceiveBuffer = new uint8_t [mReceiveBufferSize] ;
+    mReceiveState = kReceiveIdle ;
+  }
+
+//······················································································································
+//   TRANSMIT STATUS
+//······················································································································
+
+  public: bool isSending (void) const { return mTransmitState != kTransmitIdle ; }
+  public: Result sendResult (void) const { return mSendResult ; }
+
+//······················································································································
+//   RECEIVE (task context)
+//   available returns true when a payload has been reassembled; receive copies it (at most inBufferSize
+//   bytes), returns its length, and frees the channel for the next incoming payload. Until then, a new
+//   incoming payload is rejected (BufferOverflow).
+//······················································································································
+
+  public: bool available (void) const { return mReceiveState == kReceiveComplete ; }
+
+  public: uint16_t receive (uint8_t * outBuffer, const uint16_t inBufferSize) {
+    uint16_t length = 0 ;
+    if (mReceiveState == kReceiveComplete) { // isr does not write the buffer in this state
+      length = (mReceiveLength < inBufferSize) ? mReceiveLength : inBufferSize ;
+      for (uint16_t i=0 ; i<length ; i++) {
+        outBuffer [i] = mReceiveBuffer [i] ;
+      }
+      mReceiveState = kReceiveIdle ;
+    }
+    return length ;
+  }
+
+  public: Result receiveResult (void) const { return mReceiveResult ; }
+  public: uint32_t receivedPayloadCount (void) const { return mReceivedPayloadCount ; }
+  public: uint32_t receiveErrorCount (void) const { return mReceiveErrorCount ; }
+
+//······················································································································
+//   START TRANSFER (called by driver with interrupts disabled)
+//   inData is not copied: it should remain valid until isSending returns false.
+//······················································································································
+
+  public: bool startTransfer (const uint8_t * inData, const uint16_t inLength) {
+    const bool ok = (mTransmitState == kTransmitIdle) && (inLength > 0) && (inLength <= kMaxPayloadLength) ;
+    if (ok) {
+      mTransmitData = inData ;
+      mTransmitLength = inLength ;
+      mTransmitOffset = 0 ;
+      mSendResult = TransferInProgress ;
+      mTransmitState = (inLength <= 7) ? kSendSingleFrame : kSendFirstFrame ;
+    }
+    return ok ;
+  }
+
+//······················································································································
+//   HANDLE RECEIVED FRAME (called by driver receive interrupt; returns true if frame belongs to channel)
+//······················································································································
+
+  public: bool handleReceivedFrame (const CANMessage & inFrame, const uint32_t inNow) {
+    const bool accepted = !inFrame.rtr && (inFrame.len > 0) && ((mReceiveFilterIndex == kNoFilter)
+      ? ((inFrame.id == mReceiveIdentifier) && (inFrame.ext == (mFormat == kExtended)))
+      : (inFrame.idx == mReceiveFilterIndex)) ;
+    if (accepted) {
+      switch (inFrame.data [0] >> 4) {
+      case 0 :
+        handleSingleFrame (inFrame) ;
+        break ;
+      case 1 :
+        handleFirstFrame (inFrame, inNow) ;
+        break ;
+      case 2 :
+        handleConsecutiveFrame (inFrame, inNow) ;
+        break ;
+      case 3 :
+        handleFlowControlFrame (inFrame, inNow) ;
+        break ;
+      default : // Invalid PCI, ignored
+        break ;
+      }
+    }
+    return accepted ;
+  }
+
+//······················································································································
+//   POP FRAME TO SEND (called by driver, with interrupts disabled or in isr context, when controller has room)
+//······················································································································
+
+  public: bool popFrame (const uint32_t inNow, CANMessage & outFrame) {
+    bool ok = mFlowControlPending ;
+    if (ok) {
+      mFlowControlPending = false ;
+      prepareFrame (outFrame, 3) ;
+      outFrame.data [0] = 0x30 | mFlowStatus ;
+      outFrame.data [1] = mBlockSize ;
+      outFrame.data [2] = mSTmin ;
+    }else{
+      switch (mTransmitState) {
+      case kSendSingleFrame :
+        ok = true ;
+        prepareFrame (outFrame, 1 + mTransmitLength) ;
+        outFrame.data [0] = (uint8_t) mTransmitLength ;
+        copyTransmitData (outFrame, 1, mTransmitLength) ;
+        endTransfer (TransferOK) ;
+        break ;
+      case kSendFirstFrame :
+        ok = true ;
+        prepareFrame (outFrame, 8) ;
+        outFrame.data [0] = 0x10 | (uint8_t) (mTransmitLength >> 8) ;
+        outFrame.data [1] = (uint8_t) mTransmitLength ;
+        copyTransmitData (outFrame, 2, 6) ;
+        mSequenceNumber = 1 ;
+        mTransmitState = kWaitForFlowControl ;
+        mTransmitDeadline = inNow + mTimeOutMicros ;
+        break ;
+      case kSendConsecutiveFrames :
+        ok = (mSeparationMicros == 0) || (((uint32_t) (inNow - mLastConsecutiveFrameDate)) >= mSeparationMicros) ;
+        if (ok) {
+          const uint16_t remaining = mTransmitLength - mTransmitOffset ;
+          const uint8_t length = (remaining < 7) ? (uint8_t) remaining : 7 ;
+          prepareFrame (outFrame, 1 + length) ;
+          outFrame.data [0] = 0x20 | mSequenceNumber ;
+          copyTransmitData (outFrame, 1, length) ;
+          mSequenceNumber = (mSequenceNumber + 1) & 0x0F ;
+          mLastConsecutiveFrameDate = inNow ;
+          if (mTransmitOffset == mTransmitLength) {
+            endTransfer (TransferOK) ;
+          }else if (mBlockRemaining > 0) { // 0: no block size limit
+            mBlockRemaining -= 1 ;
+            if (mBlockRemaining == 0) {
+              mTransmitState = kWaitForFlowControl ;
+              mTransmitDeadline = inNow + mTimeOutMicros ;
+            }
+          }
+        }
+        break ;
+      case kTransmitIdle :
+      case kWaitForFlowControl :
+        break ;
+      }
+    }
+    return ok ;
+  }
+
+//······················································································································
+//   TIME OUTS (called by driver)
+//······················································································································
+
+  public: void checkTimeOuts (const uint32_t inNow) {
+    if ((mTransmitState == kWaitForFlowControl) && (((int32_t) (inNow - mTransmitDeadline)) >= 0)) {
+      endTransfer (TimeOutBs) ;
+    }
+    if ((mReceiveState == kReceiveInProgress) && (((int32_t) (inNow - mReceiveDeadline)) >= 0)) {
+      endReception (TimeOutCr) ;
+    }
+  }
+
+//--- True if popFrame would return a frame at inNow
+  public: bool hasFrameReady (const uint32_t inNow) const {
+    return mFlowControlPending
+      || (mTransmitState == kSendSingleFrame)
+      || (mTransmitState == kSendFirstFrame)
+      || ((mTransmitState == kSendConsecutiveFrames)
+        && ((mSeparationMicros == 0) || (((uint32_t) (inNow - mLastConsecutiveFrameDate)) >= mSeparationMicros))) ;
+  }
+
+//······················································································································
+//   PRIVATE TYPES AND PROPERTIES
+//······················································································································
+
+  private: typedef enum : uint8_t {
+    kTransmitIdle,
+    kSendSingleFrame,
+    kSendFirstFrame,
+    kWaitForFlowControl,
+    kSendConsecutiveFrames
+  } TransmitState ;
+
+  private: typedef enum : uint8_t {
+    kReceiveIdle,
+    kReceiveInProgress,
+    kReceiveComplete
+  } ReceiveState ;
+
+//--- Transmit
+  private: const uint8_t * mTransmitData = NULL ;
+  private: uint16_t mTransmitLength = 0 ;
+  private: uint16_t mTransmitOffset = 0 ;
+  private: uint32_t mTransmitDeadline = 0 ;
+  private: uint32_t mSeparationMicros = 0 ; // From receiver flow control
+  private: uint32_t mLastConsecutiveFrameDate = 0 ;
+  private: uint8_t mBlockRemaining = 0 ; // Consecutive frames until next flow control (0: no limit)
+  private: uint8_t mSequenceNumber = 0 ;
+  private: volatile TransmitState mTransmitState = kTransmitIdle ;
+  private: volatile Result mSendResult = TransferOK ;
+
+//--- Receive
+  private: uint8_t * mReceiveBuffer = NULL ;
+  private: uint16_t mReceiveBufferSize = 0 ;
+  private: uint16_t mReceiveLength = 0 ;
+  private: uint16_t mReceiveOffset = 0 ;
+  private: uint32_t mReceiveDeadline = 0 ;
+  private: uint8_t mExpectedSequenceNumber = 0 ;
+  private: uint8_t mBlockCount = 0 ;
+  private: volatile ReceiveState mReceiveState = kReceiveIdle ;
+  private: volatile Result mReceiveResult = TransferOK ;
+  private: volatile uint32_t mReceivedPayloadCount = 0 ;
+  private: volatile uint32_t mReceiveErrorCount = 0 ;
+
+//--- Flow control frame to send
+  private: bool mFlowControlPending = false ;
+  private: uint8_t mFlowStatus = 0 ; // 0: continue to send, 2: overflow
+
+//······················································································································
+//   FRAME HELPERS
+//······················································································································
+
+  private: void prepareFrame (CANMessage & outFrame, const uint8_t inLength) const {
+    outFrame.id = mTransmitIdentifier ;
+    outFrame.ext = mFormat == kExtended ;
+    outFrame.rtr = false ;
+    outFrame.idx = mUseTXQ ? 255 : 0 ;
+    outFrame.len = mPadFrames ? 8 : inLength ;
+    for (uint8_t i=0 ; i<8 ; i++) {
+      outFrame.data [i] = mPaddingByte ;
+    }
+  }
+
+  private: void copyTransmitData (CANMessage & ioFrame, const uint8_t inFirstByte, const uint8_t inLength) {
+    for (uint8_t i=0 ; i<inLength ; i++) {
+      ioFrame.data [inFirstByte + i] = mTransmitData [mTransmitOffset] ;
+      mTransmitOffset += 1 ;
+    }
+  }
+
+  private: void endTransfer (const Result inResult) {
+    mSendResult = inResult ;
+    mTransmitState = kTransmitIdle ;
+  }
+
+  private: void endReception (const Result inResult) {
+    mReceiveResult = inResult ;
+    if (inResult == TransferOK) {
+      mReceiveState = kReceiveComplete ;
+      mReceivedPayloadCount += 1 ;
+    }else{
+      mReceiveState = kReceiveIdle ;
+      mReceiveErrorCount += 1 ;
+    }
+  }
+
+  private: void sendFlowControl (const uint8_t inFlowStatus) {
+    mFlowStatus = inFlowStatus ;
+    mFlowControlPending = true ;
+  }
+
+//······················································································································
+//   RECEIVED FRAME HANDLERS
+//······················································································································
+
+  private: void handleSingleFrame (const CANMessage & inFrame) {
+    const uint8_t length = inFrame.data [0] & 0x0F ;
+    if ((length > 0) && (length < inFrame.len)) {
+      if (mReceiveState == kReceiveInProgress) {
+        endReception (TransferAborted) ;
+      }
+      if ((mReceiveState == kReceiveComplete) || (length > mReceiveBufferSize)) {
+        mReceiveErrorCount += 1 ;
+        mReceiveResult = BufferOverflow ;
+      }else{
+        for (uint8_t i=0 ; i<length ; i++) {
+          mReceiveBuffer [i] = inFrame.data [1 + i] ;
+        }
+        mReceiveLength = length ;
+        endReception (TransferOK) ;
+      }
+    }
+  }
+
+  private: void handleFirstFrame (const CANMessage & inFrame, const uint32_t inNow) {
+    const uint16_t length = (uint16_t) (((inFrame.data [0] & 0x0F) << 8) | inFrame.data [1]) ;
+    if ((length > 7) && (inFrame.len == 8)) {
+      if (mReceiveState == kReceiveInProgress) {
+        endReception (TransferAborted) ;
+      }
+      if ((mReceiveState == kReceiveComplete) || (length > mReceiveBufferSize)) {
+        mReceiveErrorCount += 1 ;
+        mReceiveResult = BufferOverflow ;
+        sendFlowControl (2) ; // Overflow
+      }else{
+        for (uint8_t i=0 ; i<6 ; i++) {
+          mReceiveBuffer [i] = inFrame.data [2 + i] ;
+        }
+        mReceiveLength = length ;
+        mReceiveOffset = 6 ;
+        mExpectedSequenceNumber = 1 ;
+        mBlockCount = 0 ;
+        mReceiveDeadline = inNow + mTimeOutMicros ;
+        mReceiveResult = TransferInProgress ;
+        mReceiveState = kReceiveInProgress ;
+        sendFlowControl (0) ; // Continue to send
+      }
+    }
+  }
+
+  private: void handleConsecutiveFrame (const CANMessage & inFrame, const uint32_t inNow) {
+    if (mReceiveState == kReceiveInProgress) {
+      if ((inFrame.data [0] & 0x0F) != mExpectedSequenceNumber) {
+        endReception (WrongSequenceNumber) ;
+      }else{
+        const uint16_t remaining = mReceiveLength - mReceiveOffset ;
+        const uint8_t available = inFrame.len - 1 ;
+        const uint8_t length = (remaining < available) ? (uint8_t) remaining : available ;
+        for (uint8_t i=0 ; i<length ; i++) {
+          mReceiveBuffer [mReceiveOffset] = inFrame.data [1 + i] ;
+          mReceiveOffset += 1 ;
+        }
+        mExpectedSequenceNumber = (mExpectedSequenceNumber + 1) & 0x0F ;
+        mReceiveDeadline = inNow + mTimeOutMicros ;
+        if (mReceiveOffset == mReceiveLength) {
+          endReception (TransferOK) ;
+        }else if (mBlockSize > 0) {
+          mBlockCount += 1 ;
+          if (mBlockCount == mBlockSize) {
+            mBlockCount = 0 ;
+            sendFlowControl (0) ; // Continue to send
+          }
+        }
+      }
+    }
+  }
+
+  private: void handleFlowControlFrame (const CANMessage & inFrame, const uint32_t inNow) {
+    if ((mTransmitState == kWaitForFlowControl) && (inFrame.len >= 3)) {
+      switch (inFrame.data [0] & 0x0F) {
+      case 0 : // Continue to send
+        mBlockRemaining = inFrame.data [1] ;
+        mSeparationMicros = separationMicros (inFrame.data [2]) ;
+        mLastConsecutiveFrameDate = inNow - mSeparationMicros ; // First consecutive frame is sent at once
+        mTransmitState = kSendConsecutiveFrames ;
+        break ;
+      case 1 : // Wait
+        mTransmitDeadline = inNow + mTimeOutMicros ;
+        break ;
+      case 2 : // Overflow
+        endTransfer (ReceiverOverflow) ;
+        break ;
+      default :
+        break ;
+      }
+    }
+  }
+
+//--- STmin encoding (ISO 15765-2): 0x00 - 0x7F: ms, 0xF1 - 0xF9: 100 - 900 µs, reserved values: 127 ms
+  private: static uint32_t separationMicros (const uint8_t inSTmin) {
+    uint32_t result = 127UL * 1000 ;
+    if (inSTmin <= 0x7F) {
+      result = inSTmin * 1000UL ;
+    }else if ((inSTmin >= 0xF1) && (inSTmin <= 0xF9)) {
+      result = (inSTmin - 0xF0) * 100UL ;
+    }
+    return result ;
+  }
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517IsoTp (const ACAN2517IsoTp &) ;
+  private: ACAN2517IsoTp & operator = (const ACAN2517IsoTp &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,545 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// J1939 layer for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517J1939.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   TRANSPORT PROTOCOL CONSTANTS (SAE J1939-21)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint8_t kRequestToSend = 16 ;
+static const uint8_t kClearToSend = 17 ;
+static const uint8_t kEndOfMessageAck = 19 ;
+static const uint8_t kBroadcastAnnounce = 32 ;
+static const uint8_t kConnectionAbort = 255 ;
+
+static const uint8_t kAbortNoSession = 1 ;
+static const uint8_t kAbortNoResource = 2 ;
+static const uint8_t kAbortTimeOut = 3 ;
+static const uint8_t kAbortBadSequenceNumber = 7 ;
+
+static const uint8_t kTransportPriority = 7 ;
+
+//--- Time outs and BAM packet interval, in ms
+static const uint32_t T1 = 750 ; // Receiver, between data packets
+static const uint32_t T2 = 1250 ; // Receiver, after CTS
+static const uint32_t T3 = 1250 ; // Sender, waiting for CTS or end of message ack
+static const uint32_t T4 = 1050 ; // Sender, after a "hold connection" CTS
+static const uint32_t BAM_PACKET_INTERVAL = 50 ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static const uint32_t kFreeHandler = UINT32_MAX ; // Not a valid PGN
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+static uint8_t bitCount (uint32_t inValue) {
+  uint8_t result = 0 ;
+  while (inValue != 0) {
+    inValue &= inValue - 1 ;
+    result += 1 ;
+  }
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   CONSTRUCTOR
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+ACAN2517J1939::ACAN2517J1939 (ACAN2517 & inCAN, const uint8_t inAddress) :
+mCAN (inCAN),
+mAddress (inAddress) {
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   DESTRUCTOR
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+ACAN2517J1939::~ ACAN2517J1939 (void) {
+  delete [] mHandlers ;
+  for (uint8_t i=0 ; i<mSessionCount ; i++) {
+    delete [] mSessions [i].mBuffer ;
+  }
+  delete [] mSessions ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   INITIALIZATION
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::initWithSize (const uint16_t inHandlerCapacity,
+                                  const uint8_t inSessionCount,
+                                  const uint16_t inMaxPayloadLength) {
+//--- Handler table, kept at most 3/4 full
+  uint16_t size = 4 ;
+  mHashShift = 30 ;
+  while (((size * 3UL) / 4) < inHandlerCapacity) {
+    size <<= 1 ;
+    mHashShift -= 1 ;
+  }
+  delete [] mHandlers ;
+  mHandlers = new Handler [size] ;
+  mHandlerTableSize = size ;
+  mMaxHandlerCount = (uint16_t) ((size * 3UL) / 4) ;
+  mHandlerCount = 0 ;
+  for (uint16_t i=0 ; i<size ; i++) {
+    mHandlers [i].mPGN = kFreeHandler ;
+    mHandlers [i].mCallBack = NULL ;
+  }
+//--- Transport receive sessions
+  for (uint8_t i=0 ; i<mSessionCount ; i++) {
+    delete [] mSessions [i].mBuffer ;
+  }
+  delete [] mSessions ;
+  mSessions = NULL ;
+  mSessionCount = inSessionCount ;
+  mMaxPayloadLength = (inMaxPayloadLength < kMaxTransportPayloadLength) ? inMaxPayloadLength : kMaxTransportPayloadLength ;
+  if (mSessionCount > 0) {
+    mSessions = new ReceiveSession [mSessionCount] ;
+    for (uint8_t i=0 ; i<mSessionCount ; i++) {
+      mSessions [i].mBuffer = new uint8_t [mMaxPayloadLength] ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   HANDLERS (open addressing, linear probing)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517J1939::addHandler (const uint32_t inPGN, const tPGNCallBack inCallBack) {
+  bool ok = false ;
+  if (mHandlers != NULL) {
+    uint16_t idx = hash (inPGN) ;
+    while ((mHandlers [idx].mPGN != kFreeHandler) && (mHandlers [idx].mPGN != inPGN)) {
+      idx = (idx + 1) & (mHandlerTableSize - 1) ;
+    }
+    if (mHandlers [idx].mPGN == inPGN) {
+      mHandlers [idx].mCallBack = inCallBack ;
+      ok = true ;
+    }else if (mHandlerCount < mMaxHandlerCount) {
+      mHandlers [idx].mPGN = inPGN ;
+      mHandlers [idx].mCallBack = inCallBack ;
+      mHandlerCount += 1 ;
+      ok = true ;
+    }
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+const ACAN2517J1939::Handler * ACAN2517J1939::findHandler (const uint32_t inPGN) const {
+  const Handler * result = NULL ;
+  if (mHandlers != NULL) {
+    uint16_t idx = hash (inPGN) ;
+    bool loop = true ;
+    while (loop) {
+      const uint32_t pgn = mHandlers [idx].mPGN ;
+      if (pgn == inPGN) {
+        result = & mHandlers [idx] ;
+        loop = false ;
+      }else{
+        loop = pgn != kFreeHandler ;
+        idx = (idx + 1) & (mHandlerTableSize - 1) ;
+      }
+    }
+  }
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::dispatch (const uint32_t inPGN,
+                              const uint8_t inPriority,
+                              const uint8_t inSourceAddress,
+                              const uint8_t * inData,
+                              const uint16_t inLength) {
+  const Handler * handler = findHandler (inPGN) ;
+  if ((NULL != handler) && (NULL != handler->mCallBack)) {
+    handler->mCallBack (inPGN, inPriority, inSourceAddress, inData, inLength) ;
+  }else{
+    mUnhandledFrameCount += 1 ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   HARDWARE FILTERS
+//   A PDU2 PGN is matched on identifier bits 25-8, a PDU1 PGN on bits 25-16 (destination is checked by
+//   handleReceivedFrame). While there are too many filters, the two filters whose merge keeps the most
+//   mask bits are merged.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::appendFilters (ACAN2517Filters & ioFilters,
+                                   const ACANCallBackRoutine inCallBackRoutine,
+                                   const uint8_t inMaxFilterCount) const {
+  const uint16_t capacity = mHandlerCount + 2 ;
+  uint32_t * masks = new uint32_t [capacity] ;
+  uint32_t * acceptances = new uint32_t [capacity] ;
+  uint16_t count = 0 ;
+//--- One filter per PGN (and TP.CM, TP.DT)
+  for (uint16_t i=0 ; i<(mHandlerTableSize + 2) ; i++) {
+    uint32_t pgn = kFreeHandler ;
+    if (i < mHandlerTableSize) {
+      pgn = mHandlers [i].mPGN ;
+    }else if (i == mHandlerTableSize) {
+      pgn = kTransportConnectionManagementPGN ; // Also needed for sending (CTS, end of message ack)
+    }else if (mSessionCount > 0) {
+      pgn = kTransportDataTransferPGN ;
+    }
+    if (pgn != kFreeHandler) {
+      const uint32_t mask = isPDU1 (pgn) ? 0x03FF0000 : 0x03FFFF00 ;
+      const uint32_t acceptance = (pgn << 8) & mask ;
+      bool found = false ;
+      for (uint16_t j=0 ; (j<count) && !found ; j++) {
+        found = (masks [j] == mask) && (acceptances [j] == acceptance) ;
+      }
+      if (!found) {
+        masks [count] = mask ;
+        acceptances [count] = acceptance ;
+        count += 1 ;
+      }
+    }
+  }
+//--- Merge filters
+  const uint8_t maxFilterCount = (inMaxFilterCount > 0) ? inMaxFilterCount : 1 ;
+  while (count > maxFilterCount) {
+    uint16_t bestI = 0 ;
+    uint16_t bestJ = 1 ;
+    uint8_t bestBitCount = 0 ;
+    for (uint16_t i=0 ; i<count ; i++) {
+      for (uint16_t j=i+1 ; j<count ; j++) {
+        const uint32_t mask = masks [i] & masks [j] & ~ (acceptances [i] ^ acceptances [j]) ;
+        const uint8_t n = bitCount (mask) ;
+        if (n > bestBitCount) {
+          bestBitCount = n ;
+          bestI = i ;
+          bestJ = j ;
+        }
+      }
+    }
+    masks [bestI] &= masks [bestJ] & ~ (acceptances [bestI] ^ acceptances [bestJ]) ;
+    acceptances [bestI] &= masks [bestI] ;
+    count -= 1 ;
+    masks [bestJ] = masks [count] ;
+    acceptances [bestJ] = acceptances [count] ;
+  }
+//--- Append filters
+  for (uint16_t i=0 ; i<count ; i++) {
+    ioFilters.appendFilter (kExtended, masks [i], acceptances [i], inCallBackRoutine) ;
+  }
+  delete [] masks ;
+  delete [] acceptances ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   RECEIVE
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::handleReceivedFrame (const CANMessage & inFrame) {
+  if (inFrame.ext && !inFrame.rtr) {
+    const uint8_t destination = destinationAddress (inFrame.id) ;
+    if ((destination == mAddress) || (destination == kGlobalAddress)) {
+      const uint32_t receivedPGN = pgn (inFrame.id) ;
+      if (receivedPGN == kTransportConnectionManagementPGN) {
+        handleConnectionManagement (inFrame) ;
+      }else if (receivedPGN == kTransportDataTransferPGN) {
+        handleDataTransfer (inFrame) ;
+      }else{
+        dispatch (receivedPGN, priority (inFrame.id), sourceAddress (inFrame.id), inFrame.data, inFrame.len) ;
+      }
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+ACAN2517J1939::ReceiveSession * ACAN2517J1939::findSession (const uint8_t inSourceAddress, const bool inBroadcast) {
+  ReceiveSession * result = NULL ;
+  ReceiveSession * freeSession = NULL ;
+  for (uint8_t i=0 ; (i<mSessionCount) && (NULL == result) ; i++) {
+    ReceiveSession & session = mSessions [i] ;
+    if (!session.mActive) {
+      if (NULL == freeSession) {
+        freeSession = & session ;
+      }
+    }else if ((session.mSourceAddress == inSourceAddress) && (session.mBroadcast == inBroadcast)) {
+      result = & session ;
+    }
+  }
+  return (NULL != result) ? result : freeSession ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::handleConnectionManagement (const CANMessage & inFrame) {
+  if (inFrame.len == 8) {
+    const uint8_t source = sourceAddress (inFrame.id) ;
+    const bool broadcast = destinationAddress (inFrame.id) == kGlobalAddress ;
+    const uint32_t transferredPGN = inFrame.data [5] | (((uint32_t) inFrame.data [6]) << 8)
+      | (((uint32_t) inFrame.data [7]) << 16) ;
+    const uint16_t length = (uint16_t) (inFrame.data [1] | (inFrame.data [2] << 8)) ;
+    const uint32_t now = millis () ;
+    switch (inFrame.data [0]) {
+    case kRequestToSend :
+    case kBroadcastAnnounce :
+      if (broadcast == (inFrame.data [0] == kBroadcastAnnounce)) {
+        ReceiveSession * session = findSession (source, broadcast) ;
+        const bool valid = (length > 8) && (inFrame.data [3] == ((length + 6) / 7)) ;
+        if ((NULL == session) || !valid || (length > mMaxPayloadLength)) {
+          mTransportErrorCount += 1 ;
+          if (!broadcast) {
+            sendConnectionManagement (source, kConnectionAbort, (NULL == session) ? kAbortNoSession : kAbortNoResource,
+                                      0xFF, 0xFF, 0xFF, transferredPGN) ;
+          }
+        }else{
+          session->mActive = true ;
+          session->mBroadcast = broadcast ;
+          session->mSourceAddress = source ;
+          session->mPriority = priority (inFrame.id) ;
+          session->mPGN = transferredPGN ;
+          session->mLength = length ;
+          session->mPacketCount = inFrame.data [3] ;
+          session->mMaxPacketsPerCTS = (inFrame.data [4] == 0) ? 0xFF : inFrame.data [4] ; // 0xFF: no limit
+          session->mNextPacket = 1 ;
+          session->mDeadline = now + T1 ;
+          if (!broadcast) {
+            sendClearToSend (*session) ;
+          }
+        }
+      }
+      break ;
+    case kClearToSend :
+      if (((mTransmitState == kWaitForCTS) || (mTransmitState == kSendRTSCTSData))
+       && (source == mTransmitDestination) && (transferredPGN == mTransmitPGN)) {
+        const uint8_t packetCount = inFrame.data [1] ;
+        if (packetCount == 0) { // Hold connection
+          mTransmitState = kWaitForCTS ;
+          mTransmitDate = now + T4 ;
+        }else{
+          const uint16_t windowEnd = inFrame.data [2] + packetCount - 1 ;
+          mTransmitNextPacket = inFrame.data [2] ;
+          mTransmitWindowEnd = (windowEnd < mTransmitPacketCount) ? (uint8_t) windowEnd : mTransmitPacketCount ;
+          mTransmitState = kSendRTSCTSData ;
+        }
+      }
+      break ;
+    case kEndOfMessageAck :
+      if ((mTransmitState == kWaitForEndOfMessageAck)
+       && (source == mTransmitDestination) && (transferredPGN == mTransmitPGN)) {
+        endTransmit (TransferOK) ;
+      }
+      break ;
+    case kConnectionAbort :
+      if ((mTransmitState != kTransmitIdle) && (mTransmitState != kSendBAMData)
+       && (source == mTransmitDestination) && (transferredPGN == mTransmitPGN)) {
+        endTransmit (AbortedByReceiver) ;
+      }else{
+        for (uint8_t i=0 ; i<mSessionCount ; i++) {
+          ReceiveSession & session = mSessions [i] ;
+          if (session.mActive && !session.mBroadcast && (session.mSourceAddress == source)) {
+            session.mActive = false ;
+            mTransportErrorCount += 1 ;
+          }
+        }
+      }
+      break ;
+    default :
+      break ;
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::handleDataTransfer (const CANMessage & inFrame) {
+  const uint8_t source = sourceAddress (inFrame.id) ;
+  const bool broadcast = destinationAddress (inFrame.id) == kGlobalAddress ;
+  ReceiveSession * session = findSession (source, broadcast) ;
+  if ((NULL != session) && session->mActive && (inFrame.len == 8)) {
+    if (inFrame.data [0] != session->mNextPacket) {
+      session->mActive = false ;
+      mTransportErrorCount += 1 ;
+      if (!broadcast) {
+        sendConnectionManagement (source, kConnectionAbort, kAbortBadSequenceNumber, 0xFF, 0xFF, 0xFF, session->mPGN) ;
+      }
+    }else{
+      uint16_t offset = (session->mNextPacket - 1) * 7 ;
+      for (uint8_t i=1 ; (i<8) && (offset < session->mLength) ; i++) {
+        session->mBuffer [offset] = inFrame.data [i] ;
+        offset += 1 ;
+      }
+      session->mDeadline = millis () + T1 ;
+      if (session->mNextPacket == session->mPacketCount) {
+        session->mActive = false ;
+        if (!broadcast) {
+          sendConnectionManagement (source, kEndOfMessageAck, (uint8_t) session->mLength, (uint8_t) (session->mLength >> 8),
+                                    session->mPacketCount, 0xFF, session->mPGN) ;
+        }
+        dispatch (session->mPGN, session->mPriority, source, session->mBuffer, session->mLength) ;
+      }else{
+        session->mNextPacket += 1 ;
+        if (!broadcast && (session->mNextPacket > session->mWindowEnd)) {
+          sendClearToSend (*session) ;
+        }
+      }
+    }
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::sendClearToSend (ReceiveSession & ioSession) {
+  const uint8_t remaining = (uint8_t) (ioSession.mPacketCount - ioSession.mNextPacket + 1) ;
+  const uint8_t packetCount = (remaining < ioSession.mMaxPacketsPerCTS) ? remaining : ioSession.mMaxPacketsPerCTS ;
+  ioSession.mWindowEnd = (uint8_t) (ioSession.mNextPacket + packetCount - 1) ;
+  ioSession.mDeadline = millis () + T2 ;
+  sendConnectionManagement (ioSession.mSourceAddress, kClearToSend, packetCount, (uint8_t) ioSession.mNextPacket,
+                            0xFF, 0xFF, ioSession.mPGN) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   SEND
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517J1939::sendFrame (const uint32_t inPGN,
+                               const uint8_t inPriority,
+                               const uint8_t inDestinationAddress,
+                               const uint8_t * inData,
+                               const uint8_t inLength) {
+  CANMessage frame ;
+  frame.ext = true ;
+  frame.id = identifier (inPriority, inPGN, mAddress, inDestinationAddress) ;
+  frame.len = inLength ;
+  for (uint8_t i=0 ; i<inLength ; i++) {
+    frame.data [i] = inData [i] ;
+  }
+  return mCAN.tryToSend (frame) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517J1939::sendConnectionManagement (const uint8_t inDestinationAddress,
+                                              const uint8_t inControl,
+                                              const uint8_t inByte1,
+                                              const uint8_t inByte2,
+                                              const uint8_t inByte3,
+                                              const uint8_t inByte4,
+                                              const uint32_t inPGN) {
+  const uint8_t data [8] = {
+    inControl, inByte1, inByte2, inByte3, inByte4,
+    (uint8_t) inPGN, (uint8_t) (inPGN >> 8), (uint8_t) (inPGN >> 16)
+  } ;
+  return sendFrame (kTransportConnectionManagementPGN, kTransportPriority, inDestinationAddress, data, 8) ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517J1939::send (const uint32_t inPGN,
+                          const uint8_t inPriority,
+                          const uint8_t inDestinationAddress,
+                          const uint8_t * inData,
+                          const uint16_t inLength) {
+  bool ok = false ;
+  if (inLength <= 8) {
+    ok = sendFrame (inPGN, inPriority, inDestinationAddress, inData, (uint8_t) inLength) ;
+  }else if ((mTransmitState == kTransmitIdle) && (inLength <= kMaxTransportPayloadLength)) {
+    const bool broadcast = inDestinationAddress == kGlobalAddress ;
+    const uint8_t packetCount = (uint8_t) ((inLength + 6) / 7) ;
+    ok = sendConnectionManagement (inDestinationAddress,
+                                   broadcast ? kBroadcastAnnounce : kRequestToSend,
+                                   (uint8_t) inLength, (uint8_t) (inLength >> 8),
+                                   packetCount,
+                                   0xFF, // BAM: reserved; RTS: no limit of packets per CTS
+                                   inPGN) ;
+    if (ok) {
+      mTransmitData = inData ;
+      mTransmitLength = inLength ;
+      mTransmitPGN = inPGN ;
+      mTransmitPriority = inPriority ;
+      mTransmitDestination = inDestinationAddress ;
+      mTransmitPacketCount = packetCount ;
+      mTransmitNextPacket = 1 ;
+      mTransmitState = broadcast ? kSendBAMData : kWaitForCTS ;
+      mTransmitDate = millis () + (broadcast ? BAM_PACKET_INTERVAL : T3) ;
+      mSendResult = TransferInProgress ;
+    }
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517J1939::sendDataPacket (void) {
+  uint8_t data [8] ;
+  data [0] = (uint8_t) mTransmitNextPacket ;
+  uint16_t offset = (mTransmitNextPacket - 1) * 7 ;
+  for (uint8_t i=1 ; i<8 ; i++) {
+    data [i] = (offset < mTransmitLength) ? mTransmitData [offset] : 0xFF ;
+    offset += 1 ;
+  }
+  const bool ok = sendFrame (kTransportDataTransferPGN, kTransportPriority, mTransmitDestination, data, 8) ;
+  if (ok) {
+    mTransmitNextPacket += 1 ;
+  }
+  return ok ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::endTransmit (const Result inResult) {
+  mSendResult = inResult ;
+  mTransmitState = kTransmitIdle ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   RUN
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517J1939::run (void) {
+  const uint32_t now = millis () ;
+//--- Receive session time outs
+  for (uint8_t i=0 ; i<mSessionCount ; i++) {
+    ReceiveSession & session = mSessions [i] ;
+    if (session.mActive && (((int32_t) (now - session.mDeadline)) >= 0)) {
+      session.mActive = false ;
+      mTransportErrorCount += 1 ;
+      if (!session.mBroadcast) {
+        sendConnectionManagement (session.mSourceAddress, kConnectionAbort, kAbortTimeOut, 0xFF, 0xFF, 0xFF, session.mPGN) ;
+      }
+    }
+  }
+//--- Transmit session
+  switch (mTransmitState) {
+  case kSendBAMData :
+    if ((((int32_t) (now - mTransmitDate)) >= 0) && sendDataPacket ()) {
+      mTransmitDate = now + BAM_PACKET_INTERVAL ;
+      if (mTransmitNextPacket > mTransmitPacketCount) {
+        endTransmit (TransferOK) ;
+      }
+    }
+    break ;
+  case kSendRTSCTSData :
+    while ((mTransmitNextPacket <= mTransmitWindowEnd) && sendDataPacket ()) {}
+    if (mTransmitNextPacket > mTransmitWindowEnd) {
+      mTransmitState = (mTransmitNextPacket > mTransmitPacketCount) ? kWaitForEndOfMessageAck : kWaitForCTS ;
+      mTransmitDate = now + T3 ;
+    }
+    break ;
+  case kWaitForCTS :
+  case kWaitForEndOfMessageAck :
+    if (((int32_t) (now - mTransmitDate)) >= 0) {
+      mTransportErrorCount += 1 ;
+      sendConnectionManagement (mTransmitDestination, kConnectionAbort, kAbortTimeOut, 0xFF, 0xFF, 0xFF, mTransmitPGN) ;
+      endTransmit (TimeOut) ;
+    }
+    break ;
+  case kTransmitIdle :
+    break ;
+  }
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
@@ -0,0 +1,270 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// J1939 layer for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// PGN dispatch, hardware filter generation, BAM and RTS/CTS transport protocol
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_J1939_CLASS_DEFINED
+#define ACAN2517_J1939_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517J1939 class
+//  Handlers are registered by PGN, in an open addressing table. appendFilters turns the registered PGN set
+//  (and transport protocol PGNs) into hardware filters, whose call back routine should call
+//  handleReceivedFrame: frames are then dispatched by ACAN2517::dispatchReceivedMessage, in loop context.
+//  Payloads longer than 8 bytes (up to 1785) are sent and received with the transport protocol: BAM for
+//  global destination, RTS/CTS otherwise. The run method should be called from loop: it sends BAM data
+//  packets every 50 ms, RTS/CTS data packets at the rate of the driver, and handles time outs.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517J1939 {
+
+//······················································································································
+//   CALL BACK (inData is valid only during the call)
+//······················································································································
+
+  public: typedef void (*tPGNCallBack) (const uint32_t inPGN,
+                                        const uint8_t inPriority,
+                                        const uint8_t inSourceAddress,
+                                        const uint8_t * inData,
+                                        const uint16_t inLength) ;
+
+//······················································································································
+//   TRANSFER RESULT
+//······················································································································
+
+  public: typedef enum : uint8_t {
+    TransferOK,
+    TransferInProgress,
+    TimeOut,
+    AbortedByReceiver
+  } Result ;
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  public: static const uint32_t kTransportConnectionManagementPGN = 0xEC00 ;
+  public: static const uint32_t kTransportDataTransferPGN = 0xEB00 ;
+  public: static const uint8_t kGlobalAddress = 0xFF ;
+  public: static const uint16_t kMaxTransportPayloadLength = 1785 ; // 255 packets x 7 bytes
+
+//······················································································································
+//   IDENTIFIER DECODING / ENCODING (29-bit identifier)
+//   bits 28-26: priority, bit 25: EDP, bit 24: DP, bits 23-16: PF, bits 15-8: PS, bits 7-0: source address.
+//   PF < 240 (PDU1): PS is the destination address, and is not part of the PGN.
+//······················································································································
+
+  public: static uint8_t priority (const uint32_t inIdentifier) { return (uint8_t) ((inIdentifier >> 26) & 0x07) ; }
+
+  public: static uint8_t sourceAddress (const uint32_t inIdentifier) { return (uint8_t) inIdentifier ; }
+
+  public: static bool isPDU1 (const uint32_t inPGN) { return ((inPGN >> 8) & 0xFF) < 240 ; }
+
+  public: static uint32_t pgn (const uint32_t inIdentifier) {
+    const uint32_t result = (inIdentifier >> 8) & 0x3FFFF ;
+    return isPDU1 (result) ? (result & 0x3FF00) : result ;
+  }
+
+  public: static uint8_t destinationAddress (const uint32_t inIdentifier) {
+    return isPDU1 ((inIdentifier >> 8) & 0x3FFFF) ? (uint8_t) (inIdentifier >> 8) : kGlobalAddress ;
+  }
+
+  public: static uint32_t identifier (const uint8_t inPriority,
+                                      const uint32_t inPGN,
+                                      const uint8_t inSourceAddress,
+                                      const uint8_t inDestinationAddress = kGlobalAddress) {
+    uint32_t result = ((uint32_t) (inPriority & 0x07)) << 26 ;
+    result |= (inPGN & 0x3FFFF) << 8 ;
+    if (isPDU1 (inPGN)) {
+      result = (result & ~ (0xFFUL << 8)) | (((uint32_t) inDestinationAddress) << 8) ;
+    }
+    return result | inSourceAddress ;
+  }
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517J1939 (ACAN2517 & inCAN, const uint8_t inAddress) ;
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517J1939 (void) ;
+
+//······················································································································
+//   INITIALIZATION
+//   inHandlerCapacity: number of PGN handlers; inSessionCount: number of simultaneous incoming transport
+//   sessions (0: no incoming transport); inMaxPayloadLength: max incoming transport payload (9 ... 1785)
+//······················································································································
+
+  public: void initWithSize (const uint16_t inHandlerCapacity,
+                             const uint8_t inSessionCount = 0,
+                             const uint16_t inMaxPayloadLength = kMaxTransportPayloadLength) ;
+
+//--- Returns false if handler table is full; a handler registered twice for a PGN is replaced
+  public: bool addHandler (const uint32_t inPGN, const tPGNCallBack inCallBack) ;
+
+//--- Appends filters for the registered PGNs, TP.CM and TP.DT (if sessions), merging the ones that do
+//    not fit in inMaxFilterCount (merged filters are wider, handleReceivedFrame rejects unknown PGNs)
+  public: void appendFilters (ACAN2517Filters & ioFilters,
+                              const ACANCallBackRoutine inCallBackRoutine,
+                              const uint8_t inMaxFilterCount = 32) const ;
+
+//······················································································································
+//   RECEIVE (called from filter call back routine)
+//······················································································································
+
+  public: void handleReceivedFrame (const CANMessage & inFrame) ;
+
+//······················································································································
+//   SEND
+//   A payload up to 8 bytes is sent at once. A longer payload (up to 1785 bytes) starts a transport
+//   session: inData is not copied, it should remain valid until isSending returns false.
+//   Returns false if a transport session is in progress, or the driver transmit buffer is full.
+//······················································································································
+
+  public: bool send (const uint32_t inPGN,
+                     const uint8_t inPriority,
+                     const uint8_t inDestinationAddress,
+                     const uint8_t * inData,
+                     const uint16_t inLength) ;
+
+  public: bool isSending (void) const { return mTransmitState != kTransmitIdle ; }
+  public: Result sendResult (void) const { return mSendResult ; }
+
+//······················································································································
+//   RUN (loop context)
+//······················································································································
+
+  public: void run (void) ;
+
+//······················································································································
+//   ACCESSORS
+//······················································································································
+
+  public: uint8_t address (void) const { return mAddress ; }
+  public: uint32_t unhandledFrameCount (void) const { return mUnhandledFrameCount ; }
+  public: uint32_t transportErrorCount (void) const { return mTransportErrorCount ; }
+
+//······················································································································
+//   PRIVATE TYPES
+//······················································································································
+
+  private: class Handler {
+    public: uint32_t mPGN ;
+    public: tPGNCallBack mCallBack ;
+  } ;
+
+  private: class ReceiveSession {
+    public: uint8_t * mBuffer = NULL ;
+    public: uint32_t mPGN = 0 ;
+    public: uint32_t mDeadline = 0 ; // ms
+    public: uint16_t mLength = 0 ;
+    public: uint8_t mPacketCount = 0 ;
+    public: uint16_t mNextPacket = 0 ; // Expected sequence number (1 ... mPacketCount)
+    public: uint8_t mWindowEnd = 0 ; // Last packet of current CTS window
+    public: uint8_t mMaxPacketsPerCTS = 0 ;
+    public: uint8_t mSourceAddress = 0 ;
+    public: uint8_t mPriority = 0 ;
+    public: bool mActive = false ;
+    public: bool mBroadcast = false ; // BAM
+  } ;
+
+  private: typedef enum : uint8_t {
+    kTransmitIdle,
+    kSendBAMData,
+    kWaitForCTS,
+    kSendRTSCTSData,
+    kWaitForEndOfMessageAck
+  } TransmitState ;
+
+//······················································································································
+//   PRIVATE PROPERTIES
+//······················································································································
+
+  private: ACAN2517 & mCAN ;
+  private: const uint8_t mAddress ;
+
+  private: Handler * mHandlers = NULL ;
+  private: uint16_t mHandlerTableSize = 0 ; // Power of 2
+  private: uint16_t mHandlerCount = 0 ;
+  private: uint16_t mMaxHandlerCount = 0 ;
+  private: uint8_t mHashShift = 30 ;
+
+  private: ReceiveSession * mSessions = NULL ;
+  private: uint8_t mSessionCount = 0 ;
+  private: uint16_t mMaxPayloadLength = 0 ;
+
+  private: const uint8_t * mTransmitData = NULL ;
+  private: uint32_t mTransmitPGN = 0 ;
+  private: uint32_t mTransmitDate = 0 ; // ms: next BAM packet date, or time out deadline
+  private: uint16_t mTransmitLength = 0 ;
+  private: uint8_t mTransmitPacketCount = 0 ;
+  private: uint16_t mTransmitNextPacket = 0 ;
+  private: uint8_t mTransmitWindowEnd = 0 ;
+  private: uint8_t mTransmitDestination = 0 ;
+  private: uint8_t mTransmitPriority = 0 ;
+  private: TransmitState mTransmitState = kTransmitIdle ;
+  private: Result mSendResult = TransferOK ;
+
+  private: uint32_t mUnhandledFrameCount = 0 ;
+  private: uint32_t mTransportErrorCount = 0 ;
+
+//······················································································································
+//   PRIVATE METHODS
+//······················································································································
+
+  private: uint16_t hash (const uint32_t inPGN) const { // Fibonacci hashing
+    return (uint16_t) (((uint32_t) (inPGN * 2654435769UL)) >> mHashShift) ;
+  }
+
+  private: const Handler * findHandler (const uint32_t inPGN) const ;
+  private: void dispatch (const uint32_t inPGN,
+                          const uint8_t inPriority,
+                          const uint8_t inSourceAddress,
+                          const uint8_t * inData,
+                          const uint16_t inLength) ;
+
+  private: bool sendFrame (const uint32_t inPGN,
+                           const uint8_t inPriority,
+                           const uint8_t inDestinationAddress,
+                           const uint8_t * inData,
+                           const uint8_t inLength) ;
+  private: bool sendConnectionManagement (const uint8_t inDestinationAddress,
+                                          const uint8_t inControl,
+                                          const uint8_t inByte1,
+                                          const uint8_t inByte2,
+                                          const uint8_t inByte3,
+                                          const uint8_t inByte4,
+                                          const uint32_t inPGN) ;
+  private: bool sendDataPacket (void) ;
+  private: void endTransmit (const Result inResult) ;
+
+  private: ReceiveSession * findSession (const uint8_t inSourceAddress, const bool inBroadcast) ;
+  private: void handleConnectionManagement (const CANMessage & inFrame) ;
+  private: void handleDataTransfer (const CANMessage & inFrame) ;
+  private: void sendClearToSend (ReceiveSession & ioSession) ;
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517J1939 (const ACAN2517J1939 &) ;
+  private: ACAN2517J1939 & operator = (const ACAN2517J1939 &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
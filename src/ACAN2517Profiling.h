@@ -0,0 +1,194 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Profiling trace points for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// Trace points are compiled out unless ACAN2517_PROFILING is defined to 1 (build flag, or below). Durations
+// are counted in CPU cycles on Cortex-M3/M4/M7 (DWT cycle counter), in ns on host builds (std::chrono), and
+// in µs elsewhere (micros). If ACAN2517_PROFILING_DEBUG_PIN is defined, this digital output toggles at every
+// trace point, for logic analyzer correlation.
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_PROFILING_DEFINED
+#define ACAN2517_PROFILING_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_PROFILING
+  #define ACAN2517_PROFILING 0
+#endif
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#if ACAN2517_PROFILING
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <Arduino.h>
+
+#if !defined (ARDUINO)
+  #include <chrono>
+#endif
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517Profile class
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517Profile {
+
+//······················································································································
+//   STAGES
+//······················································································································
+
+  public: typedef enum : uint8_t {
+    Isr, // Whole isr
+    IsrReadInterruptFlags, // C1INT read
+    ReceiveInterrupt,
+    TransmitInterrupt,
+    TryToSend,
+    Receive,
+    kStageCount
+  } Stage ;
+
+//······················································································································
+//   PER STAGE STATISTICS
+//······················································································································
+
+  public: class StageStatistics {
+    public: uint32_t mCount ;
+    public: uint32_t mMin ;
+    public: uint32_t mMax ;
+    public: uint64_t mSum ;
+  } ;
+
+//······················································································································
+//   TIME SOURCE
+//······················································································································
+
+  #if defined (__ARM_ARCH_7M__) || defined (__ARM_ARCH_7EM__)
+    public: static const char * unit (void) { return "cycles" ; }
+
+    public: static void initTimeSource (void) {
+      * ((volatile uint32_t *) 0xE000EDFC) |= 1UL << 24 ; // DEMCR: TRCENA
+      * ((volatile uint32_t *) 0xE0001000) |= 1 ; // DWT_CTRL: CYCCNTENA
+    }
+
+    public: static inline uint32_t now (void) { return * ((volatile uint32_t *) 0xE0001004) ; } // DWT_CYCCNT
+  #elif !defined (ARDUINO)
+    public: static const char * unit (void) { return "ns" ; }
+
+    public: static void initTimeSource (void) {}
+
+    public: static inline uint32_t now (void) {
+      return (uint32_t) std::chrono::duration_cast <std::chrono::nanoseconds> (
+        std::chrono::steady_clock::now ().time_since_epoch ()
+      ).count () ;
+    }
+  #else
+    public: static const char * unit (void) { return "us" ; }
+
+    public: static void initTimeSource (void) {}
+
+    public: static inline uint32_t now (void) { return micros () ; }
+  #endif
+
+//······················································································································
+//   INIT (called by ACAN2517::begin)
+//······················································································································
+
+  public: static void init (void) {
+    initTimeSource () ;
+    #ifdef ACAN2517_PROFILING_DEBUG_PIN
+      pinMode (ACAN2517_PROFILING_DEBUG_PIN, OUTPUT) ;
+    #endif
+    reset () ;
+  }
+
+//······················································································································
+//   RECORD (trace points)
+//······················································································································
+
+  public: static inline void toggleDebugPin (void) {
+    #ifdef ACAN2517_PROFILING_DEBUG_PIN
+      static bool level = false ;
+      level = !level ;
+      digitalWrite (ACAN2517_PROFILING_DEBUG_PIN, level) ;
+    #endif
+  }
+
+  public: static inline void record (const Stage inStage, const uint32_t inDuration) {
+    StageStatistics & s = table () [inStage] ;
+    s.mCount += 1 ;
+    s.mSum += inDuration ;
+    if (s.mMin > inDuration) {
+      s.mMin = inDuration ;
+    }
+    if (s.mMax < inDuration) {
+      s.mMax = inDuration ;
+    }
+  }
+
+//······················································································································
+//   READ (interrupts are disabled during copy)
+//······················································································································
+
+  public: static StageStatistics statistics (const Stage inStage) {
+    noInterrupts () ;
+      const StageStatistics result = table () [inStage] ;
+    interrupts () ;
+    return result ;
+  }
+
+  public: static void reset (void) {
+    noInterrupts () ;
+      for (uint8_t i=0 ; i<kStageCount ; i++) {
+        StageStatistics & s = table () [i] ;
+        s.mCount = 0 ;
+        s.mMin = UINT32_MAX ;
+        s.mMax = 0 ;
+        s.mSum = 0 ;
+      }
+    interrupts () ;
+  }
+
+//······················································································································
+
+  private: static StageStatistics * table (void) {
+    static StageStatistics statisticsTable [kStageCount] ;
+    return statisticsTable ;
+  }
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   TRACE POINT MACROS
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#define ACAN2517_PROFILE_INIT() ACAN2517Profile::init ()
+
+#define ACAN2517_PROFILE_BEGIN(STAGE) \
+  ACAN2517Profile::toggleDebugPin () ; \
+  const uint32_t profileStart##STAGE = ACAN2517Profile::now ()
+
+#define ACAN2517_PROFILE_END(STAGE) \
+  ACAN2517Profile::record (ACAN2517Profile::STAGE, ACAN2517Profile::now () - profileStart##STAGE) ; \
+  ACAN2517Profile::toggleDebugPin ()
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#else
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#define ACAN2517_PROFILE_INIT()
+#define ACAN2517_PROFILE_BEGIN(STAGE)
+#define ACAN2517_PROFILE_END(STAGE)
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
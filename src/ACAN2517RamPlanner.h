@@ -0,0 +1,187 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Controller RAM layout planner for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_RAM_PLANNER_CLASS_DEFINED
+#define ACAN2517_RAM_PLANNER_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517Settings.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517RamPlanner class
+//  Partitions the 2048 bytes of controller RAM between declared FIFOs (object size, minimum and maximum
+//  entry counts, relative weight). Every FIFO gets its minimum; the remaining RAM is shared in proportion
+//  to weights (the largest fill level such that counts (level x weight, clamped to minimum ... maximum)
+//  fit in RAM); then the leftover is given, in declaration order, to FIFOs below their maximum. So the
+//  leftover is smaller than the object size of every FIFO below its maximum.
+//  All functions are constexpr (C++11): with a constexpr FIFO array, the plan is computed at compile time.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517RamPlanner {
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  public: static const uint16_t kRamSize = 2048 ;
+  public: static const uint8_t kMaxEntryCount = 32 ;
+
+//······················································································································
+//   MESSAGE OBJECT SIZE (DS20005678A, page 42): header (8 bytes), time stamp (4 bytes), payload
+//   (TEF object: payload length 0)
+//······················································································································
+
+  public: static constexpr uint8_t objectSize (const uint8_t inPayloadLength = 8, const bool inTimeStamp = false) {
+    return (uint8_t) (8 + (inTimeStamp ? 4 : 0) + inPayloadLength) ;
+  }
+
+//······················································································································
+//   FIFO DECLARATION
+//······················································································································
+
+  public: class FIFO {
+    public: const uint8_t mObjectSize ;
+    public: const uint8_t mMinimum ;
+    public: const uint8_t mMaximum ; // <= 32
+    public: const uint8_t mWeight ;
+
+    public: constexpr FIFO (const uint8_t inObjectSize,
+                            const uint8_t inMinimum,
+                            const uint8_t inMaximum,
+                            const uint8_t inWeight) :
+    mObjectSize (inObjectSize),
+    mMinimum (inMinimum),
+    mMaximum ((inMaximum > kMaxEntryCount) ? kMaxEntryCount : inMaximum),
+    mWeight (inWeight) {
+    }
+  } ;
+
+//······················································································································
+//   PLAN
+//······················································································································
+
+//--- False if minimums do not fit in RAM, or a minimum is greater than its maximum
+  public: static constexpr bool isFeasible (const FIFO * inFIFOs, const uint8_t inCount) {
+    return minimumsAreConsistent (inFIFOs, inCount) && (levelBytes (inFIFOs, inCount, 0) <= kRamSize) ;
+  }
+
+//--- Entry count of FIFO inIndex (minimum if plan is not feasible)
+  public: static constexpr uint8_t entryCount (const FIFO * inFIFOs, const uint8_t inCount, const uint8_t inIndex) {
+    return isFeasible (inFIFOs, inCount)
+      ? (uint8_t) (levelCount (inFIFOs [inIndex], level (inFIFOs, inCount))
+          + extraCount (inFIFOs [inIndex],
+                        level (inFIFOs, inCount),
+                        remainingBefore (inFIFOs, level (inFIFOs, inCount), 0, inIndex,
+                                         kRamSize - levelBytes (inFIFOs, inCount, level (inFIFOs, inCount)))))
+      : inFIFOs [inIndex].mMinimum ;
+  }
+
+  public: static constexpr uint16_t usedBytes (const FIFO * inFIFOs, const uint8_t inCount) {
+    return usedBytesFrom (inFIFOs, inCount, 0) ;
+  }
+
+  public: static constexpr uint16_t leftoverBytes (const FIFO * inFIFOs, const uint8_t inCount) {
+    return isFeasible (inFIFOs, inCount) ? (uint16_t) (kRamSize - usedBytes (inFIFOs, inCount)) : 0 ;
+  }
+
+//······················································································································
+//   DRIVER FIFOS: a three entry array, index 0: TXQ, 1: receive FIFO, 2: transmit FIFO (CAN 2.0B objects,
+//   no time stamp). Returns false (settings unchanged) if plan is not feasible.
+//······················································································································
+
+  public: static const uint8_t kTXQ = 0 ;
+  public: static const uint8_t kReceiveFIFO = 1 ;
+  public: static const uint8_t kTransmitFIFO = 2 ;
+
+  public: static bool applyToSettings (const FIFO * inFIFOs, ACAN2517Settings & ioSettings) {
+    const bool ok = isFeasible (inFIFOs, 3) ;
+    if (ok) {
+      ioSettings.mControllerTXQSize = entryCount (inFIFOs, 3, kTXQ) ;
+      ioSettings.mControllerReceiveFIFOSize = entryCount (inFIFOs, 3, kReceiveFIFO) ;
+      ioSettings.mControllerTransmitFIFOSize = entryCount (inFIFOs, 3, kTransmitFIFO) ;
+    }
+    return ok ;
+  }
+
+//······················································································································
+//   PRIVATE: FILL LEVEL (fixed point, 8 fractional bits; weight >= 1 reaches 32 entries at kMaxLevel)
+//······················································································································
+
+  private: static const uint32_t kMaxLevel = ((uint32_t) kMaxEntryCount) << 8 ;
+
+  private: static constexpr uint8_t levelCount (const FIFO & inFIFO, const uint32_t inLevel) {
+    return (((inLevel * inFIFO.mWeight) >> 8) < inFIFO.mMinimum) ? inFIFO.mMinimum
+      : (((inLevel * inFIFO.mWeight) >> 8) > inFIFO.mMaximum) ? inFIFO.mMaximum
+      : (uint8_t) ((inLevel * inFIFO.mWeight) >> 8) ;
+  }
+
+  private: static constexpr uint32_t levelBytes (const FIFO * inFIFOs, const uint8_t inCount, const uint32_t inLevel) {
+    return (inCount == 0) ? 0
+      : (((uint32_t) levelCount (inFIFOs [0], inLevel)) * inFIFOs [0].mObjectSize
+         + levelBytes (inFIFOs + 1, inCount - 1, inLevel)) ;
+  }
+
+//--- Largest level in inLow ... inHigh that fits in RAM (levelBytes is increasing with level)
+  private: static constexpr uint32_t searchLevel (const FIFO * inFIFOs,
+                                                  const uint8_t inCount,
+                                                  const uint32_t inLow,
+                                                  const uint32_t inHigh) {
+    return (inLow >= inHigh) ? inLow
+      : (levelBytes (inFIFOs, inCount, (inLow + inHigh + 1) / 2) <= kRamSize)
+        ? searchLevel (inFIFOs, inCount, (inLow + inHigh + 1) / 2, inHigh)
+        : searchLevel (inFIFOs, inCount, inLow, (inLow + inHigh + 1) / 2 - 1) ;
+  }
+
+  private: static constexpr uint32_t level (const FIFO * inFIFOs, const uint8_t inCount) {
+    return searchLevel (inFIFOs, inCount, 0, kMaxLevel) ;
+  }
+
+//······················································································································
+//   PRIVATE: LEFTOVER DISTRIBUTION
+//······················································································································
+
+  private: static constexpr uint8_t extraCount (const FIFO & inFIFO, const uint32_t inLevel, const uint32_t inRemaining) {
+    return ((uint32_t) (inFIFO.mMaximum - levelCount (inFIFO, inLevel)) < (inRemaining / inFIFO.mObjectSize))
+      ? (uint8_t) (inFIFO.mMaximum - levelCount (inFIFO, inLevel))
+      : (uint8_t) (inRemaining / inFIFO.mObjectSize) ;
+  }
+
+//--- Remaining bytes before FIFO inStop gets its extra entries
+  private: static constexpr uint32_t remainingBefore (const FIFO * inFIFOs,
+                                                      const uint32_t inLevel,
+                                                      const uint8_t inIndex,
+                                                      const uint8_t inStop,
+                                                      const uint32_t inRemaining) {
+    return (inIndex >= inStop) ? inRemaining
+      : remainingBefore (inFIFOs, inLevel, inIndex + 1, inStop,
+                         inRemaining - ((uint32_t) extraCount (inFIFOs [inIndex], inLevel, inRemaining)) * inFIFOs [inIndex].mObjectSize) ;
+  }
+
+//······················································································································
+//   PRIVATE: HELPERS
+//······················································································································
+
+  private: static constexpr bool minimumsAreConsistent (const FIFO * inFIFOs, const uint8_t inCount) {
+    return (inCount == 0)
+      || ((inFIFOs [0].mMinimum <= inFIFOs [0].mMaximum) && (inFIFOs [0].mObjectSize > 0)
+          && minimumsAreConsistent (inFIFOs + 1, inCount - 1)) ;
+  }
+
+  private: static constexpr uint16_t usedBytesFrom (const FIFO * inFIFOs, const uint8_t inCount, const uint8_t inIndex) {
+    return (inIndex >= inCount) ? 0
+      : (uint16_t) (((uint16_t) entryCount (inFIFOs, inCount, inIndex)) * inFIFOs [inIndex].mObjectSize
+                    + usedBytesFrom (inFIFOs, inCount, inIndex + 1)) ;
+  }
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,150 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// Driver receive buffer, with heap or caller supplied storage
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// ACANBuffer.h is common with the acan2515 library, and whichever library header is included first supplies
+// ACANBuffer: it should stay identical in both libraries. This class is specific to the ACAN2517 driver.
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_RECEIVE_BUFFER_CLASS_DEFINED
+#define ACAN2517_RECEIVE_BUFFER_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACANPackedFrame.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517ReceiveBuffer {
+
+//······················································································································
+// Default constructor
+//······················································································································
+
+  public: ACAN2517ReceiveBuffer (void)  :
+  mBuffer (NULL),
+  mSize (0),
+  mReadIndex (0),
+  mWriteIndex (0),
+  mCount (0),
+  mPeakCount (0),
+  mStaticStorage (false) {
+  }
+
+//······················································································································
+// Destructor
+//······················································································································
+
+  public: ~ ACAN2517ReceiveBuffer (void) {
+    if (!mStaticStorage) {
+      delete [] mBuffer ;
+    }
+  }
+
+//······················································································································
+// Private properties
+//······················································································································
+
+  private: ACANPackedFrame * mBuffer ; // Frames are stored packed (14 bytes instead of 16)
+  private: uint32_t mSize ;
+  private: uint32_t mReadIndex ;
+  private: uint32_t mWriteIndex ;
+  private: uint32_t mCount ;
+  private: uint32_t mPeakCount ; // > mSize if overflow did occur
+  private: bool mStaticStorage ;
+
+//······················································································································
+// Accessors
+//······················································································································
+
+  public: inline uint32_t size (void) const { return mSize ; }
+  public: inline uint32_t count (void) const { return mCount ; }
+  public: inline uint32_t peakCount (void) const { return mPeakCount ; }
+
+//······················································································································
+// initWithSize
+//······················································································································
+
+  public: void initWithSize (const uint32_t inSize) {
+    if (!mStaticStorage) { // With static storage, inSize is ignored
+      delete [] mBuffer ;
+      mBuffer = new ACANPackedFrame [inSize] ;
+      mSize = inSize ;
+    }
+    mReadIndex = 0 ;
+    mWriteIndex = 0 ;
+    mCount = 0 ;
+    mPeakCount = 0 ;
+  }
+
+//······················································································································
+// useStorage: caller supplied storage (no heap allocation), should be called before initWithSize
+//······················································································································
+
+  public: void useStorage (ACANPackedFrame * inStorage, const uint32_t inSize) {
+    if (!mStaticStorage) {
+      delete [] mBuffer ;
+    }
+    mBuffer = inStorage ;
+    mSize = inSize ;
+    mStaticStorage = true ;
+  }
+
+//······················································································································
+// append
+//······················································································································
+
+  public: bool append (const CANMessage & inMessage) {
+    ACANPackedFrame frame ;
+    frame.pack (inMessage) ;
+    return append (frame) ;
+  }
+
+  public: bool append (const ACANPackedFrame & inFrame) {
+    const bool ok = mCount < mSize ;
+    if (ok) {
+      mBuffer [mWriteIndex] = inFrame ;
+      mWriteIndex += 1 ;
+      if (mWriteIndex == mSize) {
+        mWriteIndex = 0 ;
+      }
+      mCount ++ ;
+      if (mPeakCount < mCount) {
+        mPeakCount = mCount ;
+      }
+    }
+    return ok ;
+  }
+
+//······················································································································
+// Remove
+//······················································································································
+
+  public: bool remove (CANMessage & outMessage) {
+    const bool ok = mCount > 0 ;
+    if (ok) {
+      mBuffer [mReadIndex].unpack (outMessage) ;
+      mCount -= 1 ;
+      mReadIndex += 1 ;
+      if (mReadIndex == mSize) {
+        mReadIndex = 0 ;
+      }
+    }
+    return ok ;
+  }
+
+//······················································································································
+// No copy
+//······················································································································
+
+  private: ACAN2517ReceiveBuffer (const ACAN2517ReceiveBuffer &) ;
+  private: ACAN2517ReceiveBuffer & operator = (const ACAN2517ReceiveBuffer &) ;
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,225 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// Receive last value cache
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_RECEIVE_CACHE_CLASS_DEFINED
+#define ACAN2517_RECEIVE_CACHE_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517ReceiveCache class
+//  A received frame goes to the cache (instead of the driver receive buffer) if it matches a filter marked
+//  by setLatestValueFilters, or if its identifier has been registered by addIdentifier. It overwrites the
+//  slot of its identifier (open addressing table), with its reception date.
+//  Every slot has its own sequence counter, odd while the isr writes it: readers do not disable
+//  interrupts, they retry until they get a consistent copy (single core targets).
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517ReceiveCache {
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  private: static const uint32_t kFreeSlot = UINT32_MAX ; // Not a valid key
+  private: static const uint32_t kExtendedFlag = 1UL << 31 ;
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517ReceiveCache (void) {}
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517ReceiveCache (void) {
+    delete [] mSlots ;
+  }
+
+//······················································································································
+//   INITIALIZATION (before installing in driver)
+//   inIdentifierCapacity is rounded up to a power of 2; table is kept at most 3/4 full
+//······················································································································
+
+  public: void initWithSize (const uint32_t inIdentifierCapacity) {
+    uint32_t size = 4 ;
+    mHashShift = 30 ;
+    while (((size * 3) / 4) < inIdentifierCapacity) {
+      size <<= 1 ;
+      mHashShift -= 1 ;
+    }
+    delete [] mSlots ;
+    mSlots = new Slot [size] ;
+    mTableSize = size ;
+    mMaxEntryCount = (size * 3) / 4 ;
+    mEntryCount = 0 ;
+    for (uint32_t i=0 ; i<mTableSize ; i++) {
+      mSlots [i].mKey = kFreeSlot ;
+    }
+  }
+
+//······················································································································
+//   CONFIGURATION (before installing in driver)
+//······················································································································
+
+//--- Bit n set: frames matching filter #n go to the cache, every new identifier gets a slot
+  public: void setLatestValueFilters (const uint32_t inFilterMask) {
+    mLatestValueFilterMask = inFilterMask ;
+  }
+
+//--- Frames with this identifier go to the cache, whatever the matching filter (returns false if full)
+  public: bool addIdentifier (const tFrameFormat inFormat, const uint32_t inIdentifier) {
+    const uint32_t key = (inFormat == kExtended) ? (inIdentifier | kExtendedFlag) : inIdentifier ;
+    return NULL != lookUp (key, true) ;
+  }
+
+//······················································································································
+//   STORE (called by driver receive interrupt; returns false if frame should go to receive buffer)
+//······················································································································
+
+  public: bool store (const CANMessage & inMessage, const uint32_t inDate) {
+    const uint32_t key = inMessage.ext ? (inMessage.id | kExtendedFlag) : inMessage.id ;
+    const bool insert = ((mLatestValueFilterMask >> inMessage.idx) & 1) != 0 ;
+    Slot * slot = lookUp (key, insert) ;
+    if (NULL != slot) {
+      slot->mSequence = slot->mSequence + 1 ;
+      __asm__ volatile ("" ::: "memory") ;
+        slot->mMessage = inMessage ;
+        slot->mDate = inDate ;
+      __asm__ volatile ("" ::: "memory") ;
+      slot->mSequence = slot->mSequence + 1 ;
+    }else if (insert) {
+      mOverflowCount += 1 ; // Table is full: frame goes to receive buffer
+    }
+    return NULL != slot ;
+  }
+
+//······················································································································
+//   READ (task context, interrupts are not disabled)
+//   Returns false if the identifier is not cached. outUpdateCount is 0 until a first frame is received,
+//   comparing it with a previous value tells if a new frame has been received.
+//······················································································································
+
+  public: bool read (const tFrameFormat inFormat,
+                     const uint32_t inIdentifier,
+                     CANMessage & outMessage,
+                     uint32_t & outDate,
+                     uint32_t & outUpdateCount) const {
+    const uint32_t key = (inFormat == kExtended) ? (inIdentifier | kExtendedFlag) : inIdentifier ;
+    const Slot * slot = find (key) ;
+    if (NULL != slot) {
+      uint32_t sequence ;
+      do{
+        do{
+          sequence = slot->mSequence ;
+        }while ((sequence & 1) != 0) ;
+        __asm__ volatile ("" ::: "memory") ;
+        outMessage = slot->mMessage ;
+        outDate = slot->mDate ;
+        __asm__ volatile ("" ::: "memory") ;
+      }while (slot->mSequence != sequence) ;
+      outUpdateCount = sequence / 2 ;
+    }
+    return NULL != slot ;
+  }
+
+//······················································································································
+//   ACCESSORS
+//······················································································································
+
+  public: uint32_t identifierCount (void) const { return mEntryCount ; }
+  public: uint32_t identifierCapacity (void) const { return mMaxEntryCount ; }
+  public: uint32_t overflowCount (void) const { return mOverflowCount ; }
+
+//······················································································································
+//   PRIVATE TYPES AND PROPERTIES
+//······················································································································
+
+  private: class Slot {
+    public: volatile uint32_t mKey ; // Set once (in isr or before install), never changed
+    public: volatile uint32_t mSequence = 0 ;
+    public: CANMessage mMessage ;
+    public: uint32_t mDate = 0 ;
+  } ;
+
+  private: Slot * mSlots = NULL ;
+  private: uint32_t mTableSize = 0 ; // Power of 2
+  private: uint32_t mMaxEntryCount = 0 ;
+  private: uint32_t mEntryCount = 0 ;
+  private: uint32_t mLatestValueFilterMask = 0 ;
+  private: volatile uint32_t mOverflowCount = 0 ;
+  private: uint8_t mHashShift = 30 ; // 32 - log2 (mTableSize)
+
+//······················································································································
+//   PRIVATE METHODS
+//······················································································································
+
+  private: uint32_t hash (const uint32_t inKey) const { // Fibonacci hashing
+    return ((uint32_t) (inKey * 2654435769UL)) >> mHashShift ;
+  }
+
+//--- Open addressing, linear probing; entries are never removed
+  private: Slot * lookUp (const uint32_t inKey, const bool inInsert) {
+    Slot * result = NULL ;
+    uint32_t idx = hash (inKey) ;
+    bool loop = mSlots != NULL ;
+    while (loop) {
+      Slot & slot = mSlots [idx] ;
+      if (slot.mKey == inKey) {
+        result = & slot ;
+        loop = false ;
+      }else if (slot.mKey == kFreeSlot) {
+        if (inInsert && (mEntryCount < mMaxEntryCount)) {
+          slot.mKey = inKey ; // Sequence is even and frame default: readers get update count 0
+          mEntryCount += 1 ;
+          result = & slot ;
+        }
+        loop = false ;
+      }else{
+        idx = (idx + 1) & (mTableSize - 1) ;
+      }
+    }
+    return result ;
+  }
+
+  private: const Slot * find (const uint32_t inKey) const {
+    const Slot * result = NULL ;
+    uint32_t idx = hash (inKey) ;
+    bool loop = mSlots != NULL ;
+    while (loop) {
+      const uint32_t key = mSlots [idx].mKey ;
+      if (key == inKey) {
+        result = & mSlots [idx] ;
+        loop = false ;
+      }else{
+        loop = key != kFreeSlot ;
+        idx = (idx + 1) & (mTableSize - 1) ;
+      }
+    }
+    return result ;
+  }
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517ReceiveCache (const ACAN2517ReceiveCache &) ;
+  private: ACAN2517ReceiveCache & operator = (const ACAN2517ReceiveCache &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,255 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// Periodic transmit scheduler
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_SCHEDULER_CLASS_DEFINED
+#define ACAN2517_SCHEDULER_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517Scheduler class
+//  Entries (frame, period, offset) are kept in a binary min-heap ordered by next due date (in µs, compared
+//  with wrap around, so periods should be lower than 2^31 µs). The driver pops due frames from the
+//  ACAN2517::runScheduler method (loop or task) and from its isr.
+//  Lateness (send date - due date) is recorded for every entry: its max - min is the period jitter.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517Scheduler {
+
+//······················································································································
+//   PER ENTRY STATISTICS
+//······················································································································
+
+  public: class EntryStatistics {
+    public: uint32_t mSentCount = 0 ;
+    public: uint32_t mMissedCount = 0 ; // Periods skipped because scheduler ran too late
+    public: uint32_t mDroppedCount = 0 ; // Driver transmit buffer was full
+    public: uint32_t mMinLateness = UINT32_MAX ; // In µs
+    public: uint32_t mMaxLateness = 0 ; // In µs
+
+    public: uint32_t jitter (void) const {
+      return (mSentCount == 0) ? 0 : (mMaxLateness - mMinLateness) ;
+    }
+  } ;
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  public: static const uint8_t kNoEntry = 0xFF ;
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517Scheduler (void) {}
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517Scheduler (void) {
+    delete [] mEntries ;
+    delete [] mHeap ;
+  }
+
+//······················································································································
+//   INITIALIZATION (before installing in driver)
+//······················································································································
+
+  public: void initWithSize (const uint8_t inCapacity) { // 1 ... 254
+    delete [] mEntries ;
+    delete [] mHeap ;
+    mCapacity = (inCapacity < kNoEntry) ? inCapacity : (kNoEntry - 1) ;
+    mEntries = new Entry [mCapacity] ;
+    mHeap = new uint8_t [mCapacity] ;
+    mEntryCount = 0 ;
+  }
+
+//······················································································································
+//   ADD ENTRY (returns entry index, or kNoEntry if scheduler is full or inPeriodMicros is zero)
+//   The first frame is due inOffsetMicros after the call; offsets spread frames with same period.
+//······················································································································
+
+  public: uint8_t addEntry (const CANMessage & inFrame,
+                            const uint32_t inPeriodMicros,
+                            const uint32_t inOffsetMicros = 0) {
+    uint8_t result = kNoEntry ;
+    if ((mEntryCount < mCapacity) && (inPeriodMicros > 0)) {
+      noInterrupts () ;
+        result = mEntryCount ;
+        Entry & entry = mEntries [result] ;
+        entry.mFrame = inFrame ;
+        entry.mPeriod = inPeriodMicros ;
+        entry.mDueDate = micros () + inOffsetMicros ;
+        entry.mStatistics = EntryStatistics () ;
+        mEntryCount += 1 ;
+        siftUp (mEntryCount - 1, result) ;
+      interrupts () ;
+    }
+    return result ;
+  }
+
+//······················································································································
+//   UPDATE FRAME CONTENT IN PLACE (sent at next due date)
+//······················································································································
+
+  public: void updateFrame (const uint8_t inEntryIndex, const CANMessage & inFrame) {
+    if (inEntryIndex < mEntryCount) {
+      noInterrupts () ;
+        mEntries [inEntryIndex].mFrame = inFrame ;
+      interrupts () ;
+    }
+  }
+
+  public: void updateData (const uint8_t inEntryIndex, const uint64_t inData64) {
+    if (inEntryIndex < mEntryCount) {
+      noInterrupts () ;
+        mEntries [inEntryIndex].mFrame.data64 = inData64 ;
+      interrupts () ;
+    }
+  }
+
+//······················································································································
+//   ACCESSORS
+//······················································································································
+
+  public: uint8_t entryCount (void) const { return mEntryCount ; }
+
+  public: EntryStatistics statistics (const uint8_t inEntryIndex) const {
+    EntryStatistics result ;
+    if (inEntryIndex < mEntryCount) {
+      noInterrupts () ;
+        result = mEntries [inEntryIndex].mStatistics ;
+      interrupts () ;
+    }
+    return result ;
+  }
+
+//--- Due date of the first entry, for choosing how long loop or a task may sleep (returns false if no entry)
+  public: bool nextDueDate (uint32_t & outDate) const {
+    noInterrupts () ;
+      const bool ok = mEntryCount > 0 ;
+      if (ok) {
+        outDate = mEntries [mHeap [0]].mDueDate ;
+      }
+    interrupts () ;
+    return ok ;
+  }
+
+//······················································································································
+//   POP DUE FRAME (called by driver, with interrupts disabled or in isr context)
+//   If the first entry is due at inNow, its frame is copied, and it is rescheduled one period later
+//   (whole periods already elapsed are skipped and counted as missed).
+//······················································································································
+
+  public: bool popDueFrame (const uint32_t inNow, CANMessage & outFrame, uint8_t & outEntryIndex) {
+    const bool due = (mEntryCount > 0) && (((int32_t) (inNow - mEntries [mHeap [0]].mDueDate)) >= 0) ;
+    if (due) {
+      outEntryIndex = mHeap [0] ;
+      Entry & entry = mEntries [outEntryIndex] ;
+      outFrame = entry.mFrame ;
+      const uint32_t lateness = inNow - entry.mDueDate ;
+      if (entry.mStatistics.mMinLateness > lateness) {
+        entry.mStatistics.mMinLateness = lateness ;
+      }
+      if (entry.mStatistics.mMaxLateness < lateness) {
+        entry.mStatistics.mMaxLateness = lateness ;
+      }
+      const uint32_t missed = lateness / entry.mPeriod ;
+      entry.mStatistics.mMissedCount += missed ;
+      entry.mDueDate += (missed + 1) * entry.mPeriod ;
+      siftDown (outEntryIndex) ;
+    }
+    return due ;
+  }
+
+//--- Called by driver after popDueFrame
+  public: void recordSend (const uint8_t inEntryIndex, const bool inSent) {
+    if (inSent) {
+      mEntries [inEntryIndex].mStatistics.mSentCount += 1 ;
+    }else{
+      mEntries [inEntryIndex].mStatistics.mDroppedCount += 1 ;
+    }
+  }
+
+//······················································································································
+//   PRIVATE TYPES AND PROPERTIES
+//······················································································································
+
+  private: class Entry {
+    public: CANMessage mFrame ;
+    public: uint32_t mPeriod ;
+    public: uint32_t mDueDate ;
+    public: EntryStatistics mStatistics ;
+  } ;
+
+  private: Entry * mEntries = NULL ;
+  private: uint8_t * mHeap = NULL ; // Entry indexes, min-heap on mDueDate
+  private: uint8_t mCapacity = 0 ;
+  private: uint8_t mEntryCount = 0 ;
+
+//······················································································································
+//   HEAP HELPERS
+//······················································································································
+
+  private: bool isEarlier (const uint8_t inLeftEntry, const uint8_t inRightEntry) const {
+    return ((int32_t) (mEntries [inLeftEntry].mDueDate - mEntries [inRightEntry].mDueDate)) < 0 ;
+  }
+
+  private: void siftUp (uint8_t inPosition, const uint8_t inEntryIndex) {
+    bool loop = inPosition > 0 ;
+    while (loop) {
+      const uint8_t parent = (inPosition - 1) / 2 ;
+      loop = isEarlier (inEntryIndex, mHeap [parent]) ;
+      if (loop) {
+        mHeap [inPosition] = mHeap [parent] ;
+        inPosition = parent ;
+        loop = inPosition > 0 ;
+      }
+    }
+    mHeap [inPosition] = inEntryIndex ;
+  }
+
+  private: void siftDown (const uint8_t inEntryIndex) { // inEntryIndex is at root, its due date has increased
+    uint8_t position = 0 ;
+    bool loop = true ;
+    while (loop) {
+      uint16_t child = 2 * position + 1 ;
+      loop = child < mEntryCount ;
+      if (loop) {
+        if (((child + 1) < mEntryCount) && isEarlier (mHeap [child + 1], mHeap [child])) {
+          child += 1 ;
+        }
+        loop = isEarlier (mHeap [child], inEntryIndex) ;
+        if (loop) {
+          mHeap [position] = mHeap [child] ;
+          position = (uint8_t) child ;
+        }
+      }
+    }
+    mHeap [position] = inEntryIndex ;
+  }
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517Scheduler (const ACAN2517Scheduler &) ;
+  private: ACAN2517Scheduler & operator = (const ACAN2517Scheduler &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
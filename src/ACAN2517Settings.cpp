@@ -135,6 +135,104 @@ uint32_t ACAN2517Settings::samplePointFromBitStart (void) const {
   return (samplePoint * partPerCent) / TQCount ;
 }
 
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   BIT TIMING SOLVER
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+bool ACAN2517Settings::isBetterBitTiming (const BitTimingCandidate & inLeft,
+                                          const BitTimingCandidate & inRight) {
+  bool result ;
+  if (inLeft.mPPMError != inRight.mPPMError) {
+    result = inLeft.mPPMError < inRight.mPPMError ;
+  }else if (inLeft.mSamplePointDistance != inRight.mSamplePointDistance) {
+    result = inLeft.mSamplePointDistance < inRight.mSamplePointDistance ;
+  }else if (inLeft.mOscillatorTolerancePPM != inRight.mOscillatorTolerancePPM) {
+    result = inLeft.mOscillatorTolerancePPM > inRight.mOscillatorTolerancePPM ;
+  }else{
+    result = inLeft.mBitRatePrescaler < inRight.mBitRatePrescaler ;
+  }
+  return result ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+uint32_t ACAN2517Settings::findBitTimings (const BitTimingRequirements & inRequirements,
+                                           BitTimingCandidate outCandidates [],
+                                           const uint32_t inArraySize) const {
+  const uint32_t maxTQCount = MAX_PHASE_SEGMENT_1 + MAX_PHASE_SEGMENT_2 + 1 ;
+  const uint64_t ppm = (uint64_t) (1000UL * 1000UL) ; // UL suffix is required for Arduino Uno
+  uint32_t validCount = 0 ;
+  uint32_t storedCount = 0 ;
+  for (uint32_t BRP = 1 ; (BRP <= MAX_BRP) && (mDesiredBitRate > 0) ; BRP++) {
+    const uint32_t lowTQCount = mSysClock / mDesiredBitRate / BRP ;
+  //--- Only TQCount and TQCount + 1 can be close to desired bit rate
+    for (uint32_t TQCount = lowTQCount ; TQCount <= (lowTQCount + 1) ; TQCount++) {
+      if ((TQCount >= 4) && (TQCount <= maxTQCount)) {
+        const uint32_t W = TQCount * mDesiredBitRate * BRP ;
+        const uint64_t diff = (mSysClock > W) ? (mSysClock - W) : (W - mSysClock) ;
+        if ((diff * ppm) <= (((uint64_t) W) * inRequirements.mTolerancePPM)) {
+          BitTimingCandidate candidate ;
+          candidate.mBitRatePrescaler = (uint16_t) BRP ;
+          candidate.mPPMError = (uint32_t) ((diff * ppm) / W) ;
+        //--- Enumerate PS2, PS1 is the remaining time quanta
+          for (uint32_t PS2 = 1 ; (PS2 <= MAX_PHASE_SEGMENT_2) && ((PS2 + 3) <= TQCount) ; PS2++) {
+            const uint32_t PS1 = TQCount - 1 /* Sync Seg */ - PS2 ;
+            const uint32_t samplePoint = ((1 + PS1) * 1000) / TQCount ;
+            uint32_t SJW = (PS1 < PS2) ? PS1 : PS2 ;
+            if (SJW > MAX_SJW) {
+              SJW = MAX_SJW ;
+            }
+            if ((PS1 <= MAX_PHASE_SEGMENT_1)
+             && (samplePoint >= inRequirements.mMinSamplePoint)
+             && (samplePoint <= inRequirements.mMaxSamplePoint)
+             && (SJW >= inRequirements.mMinSJW)) {
+              validCount += 1 ;
+              candidate.mPhaseSegment1 = (uint16_t) PS1 ;
+              candidate.mPhaseSegment2 = (uint8_t) PS2 ;
+              candidate.mSJW = (uint8_t) SJW ;
+              candidate.mSamplePoint = (uint16_t) samplePoint ;
+              candidate.mSamplePointDistance = (uint16_t) ((samplePoint > inRequirements.mTargetSamplePoint)
+                ? (samplePoint - inRequirements.mTargetSamplePoint)
+                : (inRequirements.mTargetSamplePoint - samplePoint)) ;
+            //--- Oscillator tolerance: min (PS1, PS2) / (2 x (13 x NBT - PS2)), SJW / (20 x NBT)
+              const uint32_t minPS = (PS1 < PS2) ? PS1 : PS2 ;
+              const uint32_t df1 = (uint32_t) ((minPS * ppm) / (2 * (13 * TQCount - PS2))) ;
+              const uint32_t df2 = (uint32_t) ((SJW * ppm) / (20 * TQCount)) ;
+              candidate.mOscillatorTolerancePPM = (df1 < df2) ? df1 : df2 ;
+            //--- Insert in sorted array (insertion sort, best first)
+              uint32_t idx = storedCount ;
+              while ((idx > 0) && isBetterBitTiming (candidate, outCandidates [idx - 1])) {
+                if (idx < inArraySize) {
+                  outCandidates [idx] = outCandidates [idx - 1] ;
+                }
+                idx -= 1 ;
+              }
+              if (idx < inArraySize) {
+                outCandidates [idx] = candidate ;
+                if (storedCount < inArraySize) {
+                  storedCount += 1 ;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  return validCount ;
+}
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+void ACAN2517Settings::setBitTiming (const BitTimingCandidate & inCandidate,
+                                     const uint32_t inTolerancePPM) {
+  mBitRatePrescaler = inCandidate.mBitRatePrescaler ;
+  mPhaseSegment1 = inCandidate.mPhaseSegment1 ;
+  mPhaseSegment2 = inCandidate.mPhaseSegment2 ;
+  mSJW = inCandidate.mSJW ;
+  mBitRateClosedToDesiredRate = (mBitRatePrescaler > 0) && (ppmFromDesiredBitRate () <= inTolerancePPM) ;
+}
+
 //——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
 
 uint32_t ACAN2517Settings::CANBitSettingConsistency (void) const {
@@ -52,6 +52,12 @@ class ACAN2517Settings {
     UnlimitedNumber
   } RetransmissionAttempts ;
 
+  public: typedef enum : uint8_t {
+    BusOffAutomaticRecovery, // Controller recovers after 128 occurrences of 11 recessive bits (ISO 11898-1)
+    BusOffImmediateRestart, // Driver restarts controller through configuration mode as soon as bus off is detected
+    BusOffManualRecovery // Controller stays in configuration mode until ACAN2517::recoverFromBusOff is called
+  } BusOffRecovery ;
+
 //······················································································································
 //   CONSTRUCTOR
 //······················································································································
@@ -85,6 +91,26 @@ class ACAN2517Settings {
 
   public: CLKOpin mCLKOPin = CLKO_DIVIDED_BY_10 ;
 
+//······················································································································
+//    Chip select driven by direct port register writes (AVR, SAMD, Teensy 3.x), instead of digitalWrite
+//    (ignored on other architectures)
+//······················································································································
+
+  public: bool mUseFastChipSelect = false ;
+
+//······················································································································
+//    SPI clock, in Hz (0 or greater than SYSCLK / 2: SYSCLK / 2, the maximum allowed by MCP2517FD)
+//······················································································································
+
+  public: uint32_t mSPIClock = 0 ;
+
+//······················································································································
+//    SPI integrity: register and RAM accesses use CRC protected SPI instructions (READ_CRC, WRITE_CRC,
+//    WRITE_SAFE), controller RAM ECC is enabled; detected errors are counted by the driver
+//······················································································································
+
+  public: bool mSPIIntegrity = false ;
+
 //······················································································································
 //    Requested mode
 //······················································································································
@@ -98,6 +124,10 @@ class ACAN2517Settings {
 //--- Driver transmit buffer size
   public: uint16_t mDriverTransmitFIFOSize = 16 ; // >= 0
 
+//--- Driver transmit buffer order: false --> FIFO order, true --> lowest arbitration field first
+//    (frames with same identifier are sent in submission order)
+  public: bool mDriverTransmitBufferInPriorityOrder = false ;
+
 //--- Controller transmit FIFO size
   public: uint8_t mControllerTransmitFIFOSize = 32 ; // 1 ... 32
 
@@ -132,6 +162,19 @@ class ACAN2517Settings {
 //--- Controller receive FIFO size
   public: uint8_t mControllerReceiveFIFOSize = 32 ; // 1 ... 32
 
+//······················································································································
+//   BUS OFF RECOVERY
+//······················································································································
+
+//--- Recovery policy
+  public: BusOffRecovery mBusOffRecovery = BusOffAutomaticRecovery ;
+
+//--- On bus off, abort controller pending transmissions and empty driver transmit buffer
+//    (false --> with BusOffAutomaticRecovery, pending frames are sent after recovery; with BusOffImmediateRestart
+//    and BusOffManualRecovery, configuration mode resets controller FIFOs and TXQ, so only frames of the driver
+//    transmit buffer are sent after recovery)
+  public: bool mFlushTransmitBuffersOnBusOff = false ;
+
 //······················································································································
 //    SYSCLOCK frequency computation
 //······················································································································
@@ -160,6 +203,47 @@ class ACAN2517Settings {
 
   public: uint32_t samplePointFromBitStart (void) const ;
 
+//······················································································································
+//    Bit timing solver
+//    Enumerates every (BRP, PS1, PS2) setting whose bit rate is within the tolerance and whose sample
+//    point is in the requested range; SJW is set to its largest value min (PS1, PS2, 128), settings
+//    with a smaller SJW being dominated. Candidates are ranked by bit rate error, then distance of sample
+//    point from target, then decreasing oscillator tolerance, then increasing BRP. Returns the number
+//    of valid settings; the outArraySize best ones are stored in outCandidates, best first.
+//······················································································································
+
+  public: class BitTimingRequirements {
+    public: uint32_t mTolerancePPM = 1000 ;
+    public: uint16_t mMinSamplePoint = 750 ; // In per-mille of bit time
+    public: uint16_t mMaxSamplePoint = 900 ; // In per-mille of bit time
+    public: uint16_t mTargetSamplePoint = 875 ; // In per-mille of bit time (87.5% for CANopen)
+    public: uint8_t mMinSJW = 1 ; // 1 ... 128
+  } ;
+
+  public: class BitTimingCandidate {
+    public: uint16_t mBitRatePrescaler = 0 ; // 1...256
+    public: uint16_t mPhaseSegment1 = 0 ; // 2...256
+    public: uint8_t mPhaseSegment2 = 0 ; // 1...128
+    public: uint8_t mSJW = 0 ; // 1...128
+    public: uint32_t mPPMError = 0 ; // Distance from desired bit rate, in ppm
+    public: uint16_t mSamplePoint = 0 ; // In per-mille of bit time
+    public: uint16_t mSamplePointDistance = 0 ; // From target, in per-mille of bit time
+  //--- Maximum oscillator tolerance allowed by this setting, in ppm (ISO 11898-1, TSEG1 being
+  //    PROP_SEG + PHASE_SEG1, this is an upper bound that ignores propagation delay)
+    public: uint32_t mOscillatorTolerancePPM = 0 ;
+  } ;
+
+  public: uint32_t findBitTimings (const BitTimingRequirements & inRequirements,
+                                   BitTimingCandidate outCandidates [],
+                                   const uint32_t inArraySize) const ;
+
+//--- Select a candidate returned by findBitTimings; begin uses it as is
+  public: void setBitTiming (const BitTimingCandidate & inCandidate,
+                             const uint32_t inTolerancePPM = 1000) ;
+
+  public: static bool isBetterBitTiming (const BitTimingCandidate & inLeft,
+                                         const BitTimingCandidate & inRight) ;
+
 //······················································································································
 //    Bit settings are consistent ? (returns 0 if ok)
 //······················································································································
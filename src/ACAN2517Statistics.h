@@ -0,0 +1,346 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// Bus load and per identifier traffic statistics
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_STATISTICS_CLASS_DEFINED
+#define ACAN2517_STATISTICS_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517Statistics class
+//  Fed by the driver (received frames, and frames entered in controller transmit FIFO / TXQ), from isr and from
+//  task context (tryToSend): task context updates run inside the driver SPI transaction, where INT is masked by
+//  SPI.usingInterrupt (and under the deferred work lock in deferred work mode), so updates never interleave.
+//  Readers never disable interrupts: every update is bracketed by a sequence counter, readers retry until they
+//  get a consistent copy. Release / acquire fences order the counter and the data on multi core targets.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517Statistics {
+
+//······················································································································
+//   PER IDENTIFIER ENTRY
+//······················································································································
+
+  public: class IdentifierStatistics {
+    public: uint32_t mIdentifier = 0 ; // Bit 31: set for extended frame
+    public: uint32_t mFrameCount = 0 ;
+    public: uint32_t mLastDate = 0 ; // In µs
+    public: uint32_t mPeriodSum = 0 ; // In µs, sum of (mFrameCount - 1) periods (saturates)
+    public: uint32_t mMinPeriod = UINT32_MAX ; // In µs
+    public: uint32_t mMaxPeriod = 0 ; // In µs
+
+    public: bool extended (void) const { return (mIdentifier & kExtendedFlag) != 0 ; }
+    public: uint32_t identifier (void) const { return mIdentifier & ~ kExtendedFlag ; }
+    public: uint32_t averagePeriod (void) const {
+      return (mFrameCount < 2) ? 0 : (mPeriodSum / (mFrameCount - 1)) ;
+    }
+  //--- Peak to peak period jitter, in µs
+    public: uint32_t periodJitter (void) const {
+      return (mFrameCount < 2) ? 0 : (mMaxPeriod - mMinPeriod) ;
+    }
+  } ;
+
+//······················································································································
+//   CONSTANTS
+//······················································································································
+
+  public: static const uint32_t kExtendedFlag = 1UL << 31 ;
+
+  private: static const uint32_t kFreeSlot = UINT32_MAX ; // Not a valid key (bits 30-29 are never set)
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517Statistics (void) {}
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517Statistics (void) {
+    delete [] mTable ;
+  }
+
+//······················································································································
+//   INITIALIZATION (call before installing in driver)
+//   inIdentifierCapacity is rounded up to a power of 2; table is kept at most 3/4 full
+//······················································································································
+
+  public: void initWithSize (const uint32_t inIdentifierCapacity,
+                             const uint32_t inBitRate, // Use ACAN2517Settings::actualBitRate ()
+                             const uint32_t inWindowDurationMicros = 1000UL * 1000UL) {
+    uint32_t size = 4 ;
+    mHashShift = 30 ;
+    while (((size * 3) / 4) < inIdentifierCapacity) {
+      size <<= 1 ;
+      mHashShift -= 1 ;
+    }
+    delete [] mTable ;
+    mTable = new IdentifierStatistics [size] ;
+    mTableSize = size ;
+    mMaxEntryCount = (size * 3) / 4 ;
+    mBitRate = inBitRate ;
+    mWindowDuration = inWindowDurationMicros ;
+    reset () ;
+  }
+
+//······················································································································
+//   RESET (call with interrupts disabled, or before installing in driver)
+//······················································································································
+
+  public: void reset (void) {
+    for (uint32_t i=0 ; i<mTableSize ; i++) {
+      mTable [i] = IdentifierStatistics () ;
+      mTable [i].mIdentifier = kFreeSlot ;
+    }
+    mEntryCount = 0 ;
+    mUntrackedFrameCount = 0 ;
+    mReceivedFrameCount = 0 ;
+    mTransmittedFrameCount = 0 ;
+    mWindowStartDate = micros () ;
+    mWindowBitCount = 0 ;
+    mBusLoad = 0 ;
+    mPeakBusLoad = 0 ;
+  }
+
+//······················································································································
+//   FRAME BIT LENGTH
+//   Nominal length (SOF to EOF, plus 3 bit intermission) and worst case stuff bit count,
+//   (standard frame: 34 + 8n stuffable bits, extended frame: 54 + 8n stuffable bits).
+//······················································································································
+
+  public: static uint32_t frameBitLength (const CANMessage & inMessage) {
+    const uint32_t dataBits = inMessage.rtr ? 0 : (8 * ((inMessage.len > 8) ? 8 : inMessage.len)) ;
+    const uint32_t stuffableBits = (inMessage.ext ? 54 : 34) + dataBits ;
+    return stuffableBits + 13 /* CRC delimiter, ACK, EOF, IFS */ + (stuffableBits - 1) / 4 ;
+  }
+
+//······················································································································
+//   RECORD FRAME (called by driver, in isr context or in an SPI transaction that masks INT)
+//······················································································································
+
+  public: void recordFrame (const CANMessage & inMessage, const bool inReceived) {
+    const uint32_t now = micros () ;
+    beginUpdate () ;
+    //--- Global counters
+      if (inReceived) {
+        mReceivedFrameCount += 1 ;
+      }else{
+        mTransmittedFrameCount += 1 ;
+      }
+    //--- Bus load (per-mille)
+      const uint32_t elapsed = now - mWindowStartDate ;
+      if (elapsed >= mWindowDuration) {
+        mBusLoad = busLoadFor (mWindowBitCount, elapsed) ;
+        if (mPeakBusLoad < mBusLoad) {
+          mPeakBusLoad = mBusLoad ;
+        }
+        mWindowStartDate = now ;
+        mWindowBitCount = 0 ;
+      }
+      mWindowBitCount += frameBitLength (inMessage) ;
+    //--- Per identifier statistics
+      const uint32_t key = inMessage.ext ? (inMessage.id | kExtendedFlag) : inMessage.id ;
+      IdentifierStatistics * entry = lookUp (key) ;
+      if (NULL == entry) {
+        mUntrackedFrameCount += 1 ;
+      }else if (entry->mFrameCount == 0) {
+        entry->mFrameCount = 1 ;
+        entry->mLastDate = now ;
+      }else{
+        const uint32_t period = now - entry->mLastDate ;
+        entry->mLastDate = now ;
+        entry->mFrameCount += 1 ;
+        entry->mPeriodSum = (entry->mPeriodSum > (UINT32_MAX - period)) ? UINT32_MAX : (entry->mPeriodSum + period) ;
+        if (entry->mMinPeriod > period) {
+          entry->mMinPeriod = period ;
+        }
+        if (entry->mMaxPeriod < period) {
+          entry->mMaxPeriod = period ;
+        }
+      }
+    endUpdate () ;
+  }
+
+//······················································································································
+//   READERS (task context, interrupts are not disabled)
+//······················································································································
+
+//--- Bus load of last completed window, in per-mille. If no frame has closed the window for
+//    more than its duration, the load of the running window is returned.
+  public: uint32_t busLoad (void) const {
+    uint32_t result ;
+    uint32_t sequence ;
+    do{
+      sequence = beginRead () ;
+      const uint32_t elapsed = micros () - mWindowStartDate ;
+      result = (elapsed >= mWindowDuration) ? busLoadFor (mWindowBitCount, elapsed) : mBusLoad ;
+    }while (retryRead (sequence)) ;
+    return result ;
+  }
+
+  public: uint32_t peakBusLoad (void) const { return readWord (mPeakBusLoad) ; }
+  public: uint32_t receivedFrameCount (void) const { return readWord (mReceivedFrameCount) ; }
+  public: uint32_t transmittedFrameCount (void) const { return readWord (mTransmittedFrameCount) ; }
+  public: uint32_t untrackedFrameCount (void) const { return readWord (mUntrackedFrameCount) ; }
+  public: uint32_t identifierCount (void) const { return readWord (mEntryCount) ; }
+  public: uint32_t identifierCapacity (void) const { return mMaxEntryCount ; }
+
+//--- Copy statistics of an identifier (returns false if identifier has not been seen)
+  public: bool statisticsForIdentifier (const tFrameFormat inFormat,
+                                        const uint32_t inIdentifier,
+                                        IdentifierStatistics & outStatistics) const {
+    const uint32_t key = (inFormat == kExtended) ? (inIdentifier | kExtendedFlag) : inIdentifier ;
+    bool found = false ;
+    uint32_t sequence ;
+    do{
+      sequence = beginRead () ;
+      found = false ;
+      uint32_t idx = hash (key) ;
+      bool loop = mTable != NULL ;
+      while (loop) {
+        const uint32_t k = mTable [idx].mIdentifier ;
+        found = k == key ;
+        loop = !found && (k != kFreeSlot) ;
+        idx = (idx + 1) & (mTableSize - 1) ;
+      }
+      if (found) {
+        outStatistics = mTable [(idx - 1) & (mTableSize - 1)] ;
+      }
+    }while (retryRead (sequence)) ;
+    return found ;
+  }
+
+//--- Iterate over seen identifiers: inSlot is 0 ... slotCount () - 1, returns false for a free slot
+  public: uint32_t slotCount (void) const { return mTableSize ; }
+
+  public: bool statisticsAtSlot (const uint32_t inSlot, IdentifierStatistics & outStatistics) const {
+    bool used = false ;
+    if (inSlot < mTableSize) {
+      uint32_t sequence ;
+      do{
+        sequence = beginRead () ;
+        outStatistics = mTable [inSlot] ;
+        used = outStatistics.mIdentifier != kFreeSlot ;
+      }while (retryRead (sequence)) ;
+    }
+    return used ;
+  }
+
+//······················································································································
+//   PRIVATE METHODS
+//······················································································································
+
+  private: uint32_t hash (const uint32_t inKey) const { // Fibonacci hashing
+    return ((uint32_t) (inKey * 2654435769UL)) >> mHashShift ;
+  }
+
+//--- Open addressing, linear probing; entries are never removed (except by reset)
+  private: IdentifierStatistics * lookUp (const uint32_t inKey) {
+    IdentifierStatistics * result = NULL ;
+    uint32_t idx = hash (inKey) ;
+    bool loop = mTable != NULL ;
+    while (loop) {
+      IdentifierStatistics & entry = mTable [idx] ;
+      if (entry.mIdentifier == inKey) {
+        result = & entry ;
+        loop = false ;
+      }else if (entry.mIdentifier == kFreeSlot) {
+        if (mEntryCount < mMaxEntryCount) {
+          entry.mIdentifier = inKey ;
+          mEntryCount += 1 ;
+          result = & entry ;
+        }
+        loop = false ;
+      }else{
+        idx = (idx + 1) & (mTableSize - 1) ;
+      }
+    }
+    return result ;
+  }
+
+  private: uint32_t busLoadFor (const uint32_t inBitCount, const uint32_t inElapsedMicros) const {
+    const uint64_t capacity = ((uint64_t) mBitRate) * inElapsedMicros ; // bits x 10^6
+    return (capacity == 0) ? 0 : (uint32_t) ((((uint64_t) inBitCount) * 1000UL * 1000UL * 1000UL) / capacity) ;
+  }
+
+//--- Sequence counter: odd while an update is in progress
+//    Writer: odd counter store, release fence, data stores, release fence, even counter store.
+//    Reader: counter load, acquire fence, data loads, acquire fence, counter load.
+  private: void beginUpdate (void) {
+    mSequence = mSequence + 1 ;
+    __atomic_thread_fence (__ATOMIC_RELEASE) ;
+  }
+
+  private: void endUpdate (void) {
+    __atomic_thread_fence (__ATOMIC_RELEASE) ;
+    mSequence = mSequence + 1 ;
+  }
+
+  private: uint32_t beginRead (void) const {
+    uint32_t sequence ;
+    do{
+      sequence = mSequence ;
+    }while ((sequence & 1) != 0) ;
+    __atomic_thread_fence (__ATOMIC_ACQUIRE) ;
+    return sequence ;
+  }
+
+  private: bool retryRead (const uint32_t inSequence) const {
+    __atomic_thread_fence (__ATOMIC_ACQUIRE) ;
+    return mSequence != inSequence ;
+  }
+
+  private: uint32_t readWord (const uint32_t & inWord) const {
+    uint32_t result ;
+    uint32_t sequence ;
+    do{
+      sequence = beginRead () ;
+      result = inWord ;
+    }while (retryRead (sequence)) ;
+    return result ;
+  }
+
+//······················································································································
+//   PRIVATE PROPERTIES
+//······················································································································
+
+  private: IdentifierStatistics * mTable = NULL ;
+  private: uint32_t mTableSize = 0 ; // Power of 2
+  private: uint32_t mMaxEntryCount = 0 ;
+  private: uint32_t mEntryCount = 0 ;
+  private: uint8_t mHashShift = 30 ; // 32 - log2 (mTableSize)
+  private: uint32_t mBitRate = 0 ;
+  private: uint32_t mWindowDuration = 0 ; // In µs
+  private: uint32_t mWindowStartDate = 0 ;
+  private: uint32_t mWindowBitCount = 0 ;
+  private: uint32_t mBusLoad = 0 ; // Per-mille
+  private: uint32_t mPeakBusLoad = 0 ; // Per-mille
+  private: uint32_t mReceivedFrameCount = 0 ;
+  private: uint32_t mTransmittedFrameCount = 0 ;
+  private: uint32_t mUntrackedFrameCount = 0 ;
+  private: volatile uint32_t mSequence = 0 ;
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517Statistics (const ACAN2517Statistics &) ;
+  private: ACAN2517Statistics & operator = (const ACAN2517Statistics &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,270 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Multi producer transmit submission queue for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_SUBMISSION_QUEUE_CLASS_DEFINED
+#define ACAN2517_SUBMISSION_QUEUE_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Atomic operations: GCC builtins where 32-bit compare and swap is lock free (Cortex-M3 and above, ESP32,
+//  host), interrupt masking with saved interrupt state otherwise (AVR, Cortex-M0: single core targets).
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#if defined (__GCC_ATOMIC_INT_LOCK_FREE) && (__GCC_ATOMIC_INT_LOCK_FREE == 2)
+  #define ACAN2517_LOCK_FREE_SUBMISSION_QUEUE 1
+#else
+  #define ACAN2517_LOCK_FREE_SUBMISSION_QUEUE 0
+  #include <Arduino.h>
+#endif
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517SubmissionQueue class
+//  Bounded multi producer, single consumer queue (sequence numbered cells): push can be called concurrently
+//  from any task, any core. The consumer role is not bound to a task: the driver (a sending task, or isr)
+//  acquires it with tryAcquireConsumer, moves frames to the controller, and releases it.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517SubmissionQueue {
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517SubmissionQueue (void) {}
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: ~ ACAN2517SubmissionQueue (void) {
+    delete [] mCells ;
+  }
+
+//······················································································································
+//   INITIALIZATION (size is rounded up to a power of 2; call it before ACAN2517::setSubmissionQueue)
+//······················································································································
+
+  public: void initWithSize (const uint16_t inSize) {
+    delete [] mCells ;
+    uint32_t size = 1 ;
+    while (size < inSize) {
+      size <<= 1 ;
+    }
+    mCells = new Cell [size] ;
+    mMask = size - 1 ;
+    for (uint32_t i=0 ; i<size ; i++) {
+      mCells [i].mSequence = i ;
+    }
+    mHead = 0 ;
+    mTail = 0 ;
+    mConsumerFlag = 0 ;
+    mRejectedCount = 0 ;
+  }
+
+//······················································································································
+//   PRODUCER SIDE (any task, any core): returns false if queue is full
+//······················································································································
+
+  public: bool push (const CANMessage & inMessage) {
+    bool ok = mCells != NULL ;
+    bool loop = ok ;
+    uint32_t position = loadAcquire (mTail) ;
+    while (loop) {
+      Cell & cell = mCells [position & mMask] ;
+      const int32_t difference = (int32_t) (loadAcquire (cell.mSequence) - position) ;
+      if (difference == 0) { // Cell is free: try to reserve it
+        if (compareAndSwap (mTail, position, position + 1)) {
+          cell.mMessage = inMessage ;
+          storeRelease (cell.mSequence, position + 1) ; // Publish
+          loop = false ;
+        }
+      }else if (difference < 0) { // Queue is full
+        ok = false ;
+        loop = false ;
+      }else{ // Another producer did reserve the cell
+        position = loadAcquire (mTail) ;
+      }
+    }
+    if (!ok) {
+      fetchAndAdd (mRejectedCount, 1) ;
+    }
+    return ok ;
+  }
+
+//······················································································································
+//   CONSUMER ROLE
+//······················································································································
+
+  public: bool tryAcquireConsumer (void) {
+    uint32_t expected = 0 ;
+    return compareAndSwap (mConsumerFlag, expected, 1) ;
+  }
+
+  public: void releaseConsumer (void) {
+    storeRelease (mConsumerFlag, 0) ;
+  }
+
+//······················································································································
+//   CONSUMER SIDE (consumer role owner only)
+//······················································································································
+
+  public: bool peek (CANMessage & outMessage) const {
+    const uint32_t head = loadAcquire (mHead) ;
+    const Cell & cell = mCells [head & mMask] ;
+    const bool ok = loadAcquire (cell.mSequence) == (head + 1) ;
+    if (ok) {
+      outMessage = cell.mMessage ;
+    }
+    return ok ;
+  }
+
+  public: void pop (void) {
+    const uint32_t head = loadAcquire (mHead) ;
+    storeRelease (mCells [head & mMask].mSequence, head + mMask + 1) ; // Cell is free for next lap
+    storeRelease (mHead, head + 1) ;
+  }
+
+//······················································································································
+//   ACCESSORS (any context)
+//······················································································································
+
+  public: bool isEmpty (void) const {
+    const uint32_t head = loadAcquire (mHead) ;
+    return (mCells == NULL) || (loadAcquire (mCells [head & mMask].mSequence) != (head + 1)) ;
+  }
+
+  public: uint32_t size (void) const { return (mCells == NULL) ? 0 : (mMask + 1) ; }
+
+  public: uint32_t rejectedCount (void) const { return loadAcquire (mRejectedCount) ; }
+
+//······················································································································
+//   ATOMIC OPERATIONS
+//······················································································································
+
+  #if ACAN2517_LOCK_FREE_SUBMISSION_QUEUE
+    private: static inline uint32_t loadAcquire (const volatile uint32_t & inValue) {
+      return __atomic_load_n (&inValue, __ATOMIC_ACQUIRE) ;
+    }
+
+    private: static inline void storeRelease (volatile uint32_t & outValue, const uint32_t inValue) {
+      __atomic_store_n (&outValue, inValue, __ATOMIC_RELEASE) ;
+    }
+
+  //--- On failure, ioExpected gets the current value
+    private: static inline bool compareAndSwap (volatile uint32_t & ioValue, uint32_t & ioExpected, const uint32_t inDesired) {
+      return __atomic_compare_exchange_n (&ioValue, &ioExpected, inDesired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ;
+    }
+
+    private: static inline void fetchAndAdd (volatile uint32_t & ioValue, const uint32_t inIncrement) {
+      __atomic_fetch_add (&ioValue, inIncrement, __ATOMIC_RELAXED) ;
+    }
+  #else
+  //--- Interrupt state is saved and restored, as the driver isr is a consumer (SREG on AVR, PRIMASK on Cortex-M0, PS on ESP8266)
+    #if defined (__AVR__)
+      private: typedef uint8_t InterruptState ;
+
+      private: static inline InterruptState disableInterrupts (void) {
+        const InterruptState state = SREG ;
+        noInterrupts () ;
+        return state ;
+      }
+
+      private: static inline void restoreInterrupts (const InterruptState inState) {
+        SREG = inState ;
+      }
+    #elif defined (__arm__)
+      private: typedef uint32_t InterruptState ;
+
+      private: static inline InterruptState disableInterrupts (void) {
+        InterruptState state ;
+        __asm__ volatile ("mrs %0, primask" : "=r" (state) :: "memory") ;
+        __asm__ volatile ("cpsid i" ::: "memory") ;
+        return state ;
+      }
+
+      private: static inline void restoreInterrupts (const InterruptState inState) {
+        __asm__ volatile ("msr primask, %0" :: "r" (inState) : "memory") ;
+      }
+    #elif defined (ESP8266)
+      private: typedef uint32_t InterruptState ;
+
+      private: static inline InterruptState disableInterrupts (void) {
+        return xt_rsil (15) ;
+      }
+
+      private: static inline void restoreInterrupts (const InterruptState inState) {
+        xt_wsr_ps (inState) ;
+      }
+    #else
+      #error "ACAN2517SubmissionQueue: no interrupt state save / restore for this target"
+    #endif
+
+    private: static inline uint32_t loadAcquire (const volatile uint32_t & inValue) {
+      const InterruptState state = disableInterrupts () ;
+        const uint32_t result = inValue ;
+      restoreInterrupts (state) ;
+      return result ;
+    }
+
+    private: static inline void storeRelease (volatile uint32_t & outValue, const uint32_t inValue) {
+      const InterruptState state = disableInterrupts () ;
+        outValue = inValue ;
+      restoreInterrupts (state) ;
+    }
+
+    private: static inline bool compareAndSwap (volatile uint32_t & ioValue, uint32_t & ioExpected, const uint32_t inDesired) {
+      const InterruptState state = disableInterrupts () ;
+        const bool ok = ioValue == ioExpected ;
+        if (ok) {
+          ioValue = inDesired ;
+        }else{
+          ioExpected = ioValue ;
+        }
+      restoreInterrupts (state) ;
+      return ok ;
+    }
+
+    private: static inline void fetchAndAdd (volatile uint32_t & ioValue, const uint32_t inIncrement) {
+      const InterruptState state = disableInterrupts () ;
+        ioValue += inIncrement ;
+      restoreInterrupts (state) ;
+    }
+  #endif
+
+//······················································································································
+//   PRIVATE PROPERTIES
+//······················································································································
+
+  private: class Cell {
+    public: volatile uint32_t mSequence ; // == position: free; == position + 1: holds a frame
+    public: CANMessage mMessage ;
+  } ;
+
+  private: Cell * mCells = NULL ;
+  private: uint32_t mMask = 0 ;
+  private: volatile uint32_t mHead = 0 ; // Written by consumer role owner only
+  private: volatile uint32_t mTail = 0 ;
+  private: volatile uint32_t mConsumerFlag = 0 ;
+  private: volatile uint32_t mRejectedCount = 0 ;
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517SubmissionQueue (const ACAN2517SubmissionQueue &) ;
+  private: ACAN2517SubmissionQueue & operator = (const ACAN2517SubmissionQueue &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
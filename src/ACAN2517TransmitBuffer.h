@@ -0,0 +1,388 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// An utility class for:
+//   - ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// Driver transmit buffer, in FIFO or CAN arbitration order
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_TRANSMIT_BUFFER_CLASS_DEFINED
+#define ACAN2517_TRANSMIT_BUFFER_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACANPackedFrame.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  Frames are stored in a slot pool; the order of pending frames is kept by an array of slot indexes,
+//  used as a ring (FIFO order) or as a binary min-heap keyed by (arbitration key, sequence number),
+//  so that frames with equal identifiers keep their submission order.
+//  Frames entered with appendLatestValue are mailboxes: an open addressing index maps their identifier
+//  to their slot, and a new value for a pending identifier overwrites the slot in place.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517TransmitBuffer {
+
+//······················································································································
+// Ordering
+//······················································································································
+
+  public: typedef enum : uint8_t {
+    FIFOOrder,
+    PriorityOrder // Lowest arbitration field first
+  } Ordering ;
+
+//······················································································································
+// Default constructor
+//······················································································································
+
+  public: ACAN2517TransmitBuffer (void) {}
+
+//······················································································································
+// Destructor
+//······················································································································
+
+  public: ~ ACAN2517TransmitBuffer (void) {
+    if (!mStaticStorage) {
+      delete [] mSlots ;
+      delete [] mOrder ;
+      delete [] mFreeSlots ;
+      delete [] mIndex ;
+    }
+  }
+
+//······················································································································
+// Private types and properties
+//······················································································································
+
+  private: class Slot {
+    public: uint32_t mKey ;
+    public: ACANPackedFrame mFrame ;
+    public: bool mMailbox ;
+    public: uint32_t mSequence ;
+  } ;
+
+  private: static const uint16_t kNoSlot = 0xFFFF ;
+
+  private: Slot * mSlots = NULL ;
+  private: uint16_t * mOrder = NULL ; // Ring or heap of slot indexes
+  private: uint16_t * mFreeSlots = NULL ; // Stack of free slot indexes
+  private: uint16_t * mIndex = NULL ; // Mailbox identifier --> slot index (kNoSlot: free entry)
+  private: uint16_t mIndexMask = 0 ; // Index size - 1, index size is a power of 2 >= 2 x mSize
+  private: uint16_t mSize = 0 ;
+  private: uint16_t mCount = 0 ;
+  private: uint16_t mPeakCount = 0 ;
+  private: uint16_t mReadIndex = 0 ; // FIFO order only
+  private: uint32_t mSequence = 0 ;
+  private: Ordering mOrdering = FIFOOrder ;
+  private: uint32_t mReplacedCount = 0 ;
+  private: bool mStaticStorage = false ;
+
+//······················································································································
+// Accessors
+//······················································································································
+
+  public: inline uint32_t size (void) const { return mSize ; }
+  public: inline uint32_t count (void) const { return mCount ; }
+  public: inline uint32_t peakCount (void) const { return mPeakCount ; }
+  public: inline uint32_t replacedCount (void) const { return mReplacedCount ; }
+  public: inline Ordering ordering (void) const { return mOrdering ; }
+
+//······················································································································
+// initWithSize
+//······················································································································
+
+  public: void initWithSize (const uint16_t inSize, const Ordering inOrdering) {
+    if (!mStaticStorage) { // With static storage, inSize is ignored
+      delete [] mSlots ;
+      delete [] mOrder ;
+      delete [] mFreeSlots ;
+      delete [] mIndex ;
+      mSlots = new Slot [inSize] ;
+      mOrder = new uint16_t [inSize] ;
+      mFreeSlots = new uint16_t [inSize] ;
+      const uint32_t size = indexSize (inSize) ;
+      mIndex = new uint16_t [size] ;
+      mIndexMask = (uint16_t) (size - 1) ;
+      mSize = inSize ;
+    }
+    mOrdering = inOrdering ;
+    mPeakCount = 0 ;
+    mReplacedCount = 0 ;
+    clear () ;
+  }
+
+//······················································································································
+// Static storage (no heap allocation): useStorage should be called before initWithSize
+//······················································································································
+
+  public: static constexpr uint32_t indexSize (const uint32_t inSize, const uint32_t inCandidate = 2) {
+    return (inCandidate >= (2 * inSize)) ? inCandidate : indexSize (inSize, inCandidate << 1) ;
+  }
+
+  public: template <uint16_t SIZE> class Storage {
+    private: Slot mSlots [(SIZE > 0) ? SIZE : 1] ;
+    private: uint16_t mOrder [(SIZE > 0) ? SIZE : 1] ;
+    private: uint16_t mFreeSlots [(SIZE > 0) ? SIZE : 1] ;
+    private: uint16_t mIndex [indexSize (SIZE)] ;
+
+    friend class ACAN2517TransmitBuffer ;
+  } ;
+
+  public: template <uint16_t SIZE> void useStorage (Storage <SIZE> & inStorage) {
+    if (!mStaticStorage) {
+      delete [] mSlots ;
+      delete [] mOrder ;
+      delete [] mFreeSlots ;
+      delete [] mIndex ;
+    }
+    mSlots = inStorage.mSlots ;
+    mOrder = inStorage.mOrder ;
+    mFreeSlots = inStorage.mFreeSlots ;
+    mIndex = inStorage.mIndex ;
+    mIndexMask = (uint16_t) (indexSize (SIZE) - 1) ;
+    mSize = SIZE ;
+    mStaticStorage = true ;
+  }
+
+//······················································································································
+// Clear (peak count is kept)
+//······················································································································
+
+  public: void clear (void) {
+    for (uint16_t i=0 ; i<mSize ; i++) {
+      mFreeSlots [i] = mSize - 1 - i ;
+    }
+    for (uint32_t i=0 ; i<=mIndexMask ; i++) {
+      mIndex [i] = kNoSlot ;
+    }
+    mCount = 0 ;
+    mReadIndex = 0 ;
+  }
+
+//······················································································································
+// Arbitration key: lower key wins arbitration. Bits 31-21: base identifier, bit 20: RTR (standard)
+// or SRR (extended), bit 19: IDE, bits 18-1: identifier extension, bit 0: RTR (extended).
+//······················································································································
+
+  public: static uint32_t arbitrationKey (const CANMessage & inMessage) {
+    uint32_t key ;
+    if (inMessage.ext) {
+      key  = ((inMessage.id >> 18) & 0x7FF) << 21 ;
+      key |= (1UL << 20) | (1UL << 19) ; // SRR, IDE are recessive
+      key |= (inMessage.id & 0x3FFFF) << 1 ;
+      key |= inMessage.rtr ? 1 : 0 ;
+    }else{
+      key  = (inMessage.id & 0x7FF) << 21 ;
+      key |= inMessage.rtr ? (1UL << 20) : 0 ;
+    }
+    return key ;
+  }
+
+//······················································································································
+// append
+//······················································································································
+
+  public: bool append (const CANMessage & inMessage) {
+    return appendInFreeSlot (inMessage, false) != kNoSlot ;
+  }
+
+//······················································································································
+// appendLatestValue: if a mailbox frame with same identifier is pending, its content is replaced
+// (it keeps its position), otherwise the frame is appended as a mailbox
+//······················································································································
+
+  public: bool appendLatestValue (const CANMessage & inMessage) {
+    const uint32_t key = mailboxKey (inMessage) ;
+    uint16_t position = mailboxHash (key) ;
+    bool found = false ;
+    while (!found && (mIndex [position] != kNoSlot)) {
+      found = mailboxKey (mSlots [mIndex [position]].mFrame) == key ;
+      if (!found) {
+        position = (position + 1) & mIndexMask ;
+      }
+    }
+    bool ok = found ;
+    if (found) {
+      mSlots [mIndex [position]].mFrame.pack (inMessage) ;
+      mReplacedCount += 1 ;
+    }else{
+      const uint16_t slotIndex = appendInFreeSlot (inMessage, true) ;
+      ok = slotIndex != kNoSlot ;
+      if (ok) {
+        mIndex [position] = slotIndex ;
+      }
+    }
+    return ok ;
+  }
+
+//······················································································································
+
+  private: uint16_t appendInFreeSlot (const CANMessage & inMessage, const bool inMailbox) {
+    uint16_t slotIndex = kNoSlot ;
+    if (mCount < mSize) {
+      slotIndex = mFreeSlots [mSize - 1 - mCount] ; // Pop free slot
+      Slot & slot = mSlots [slotIndex] ;
+      slot.mFrame.pack (inMessage) ;
+      slot.mMailbox = inMailbox ;
+      slot.mKey = (mOrdering == PriorityOrder) ? arbitrationKey (inMessage) : 0 ;
+      slot.mSequence = mSequence ;
+      mSequence += 1 ;
+      if (mOrdering == PriorityOrder) {
+        siftUp (mCount, slotIndex) ;
+      }else{
+        uint16_t writeIndex = mReadIndex + mCount ;
+        if (writeIndex >= mSize) {
+          writeIndex -= mSize ;
+        }
+        mOrder [writeIndex] = slotIndex ;
+      }
+      mCount += 1 ;
+      if (mPeakCount < mCount) {
+        mPeakCount = mCount ;
+      }
+    }
+    return slotIndex ;
+  }
+
+//······················································································································
+// Peek (frame that remove returns next; it stays in buffer)
+//······················································································································
+
+  public: bool peek (CANMessage & outMessage) const {
+    const bool ok = mCount > 0 ;
+    if (ok) {
+      const uint16_t slotIndex = (mOrdering == PriorityOrder) ? mOrder [0] : mOrder [mReadIndex] ;
+      mSlots [slotIndex].mFrame.unpack (outMessage) ;
+    }
+    return ok ;
+  }
+
+//······················································································································
+// Remove (first in FIFO order, or most urgent in priority order)
+//······················································································································
+
+  public: bool remove (CANMessage & outMessage) {
+    const bool ok = mCount > 0 ;
+    if (ok) {
+      uint16_t slotIndex ;
+      if (mOrdering == PriorityOrder) {
+        slotIndex = mOrder [0] ;
+        mCount -= 1 ;
+        if (mCount > 0) {
+          siftDown (mOrder [mCount]) ;
+        }
+      }else{
+        slotIndex = mOrder [mReadIndex] ;
+        mReadIndex += 1 ;
+        if (mReadIndex == mSize) {
+          mReadIndex = 0 ;
+        }
+        mCount -= 1 ;
+      }
+      mSlots [slotIndex].mFrame.unpack (outMessage) ;
+      if (mSlots [slotIndex].mMailbox) {
+        removeFromIndex (slotIndex) ;
+      }
+      mFreeSlots [mSize - 1 - mCount] = slotIndex ; // Push free slot
+    }
+    return ok ;
+  }
+
+//······················································································································
+// Mailbox index helpers
+//······················································································································
+
+  private: static uint32_t mailboxKey (const CANMessage & inMessage) {
+    return inMessage.id | (inMessage.ext ? (1UL << 31) : 0) | (inMessage.rtr ? (1UL << 30) : 0) ;
+  }
+
+  private: static uint32_t mailboxKey (const ACANPackedFrame & inFrame) {
+    return inFrame.identifier () | (inFrame.isExtended () ? (1UL << 31) : 0) | (inFrame.isRemote () ? (1UL << 30) : 0) ;
+  }
+
+  private: uint16_t mailboxHash (const uint32_t inKey) const { // Fibonacci hashing
+    return (uint16_t) ((((uint32_t) (inKey * 2654435769UL)) >> 16) & mIndexMask) ;
+  }
+
+//--- Linear probing deletion: following entries of the cluster are shifted back
+  private: void removeFromIndex (const uint16_t inSlotIndex) {
+    uint16_t hole = mailboxHash (mailboxKey (mSlots [inSlotIndex].mFrame)) ;
+    while (mIndex [hole] != inSlotIndex) {
+      hole = (hole + 1) & mIndexMask ;
+    }
+    uint16_t position = hole ;
+    bool loop = true ;
+    while (loop) {
+      position = (position + 1) & mIndexMask ;
+      loop = mIndex [position] != kNoSlot ;
+      if (loop) {
+        const uint16_t home = mailboxHash (mailboxKey (mSlots [mIndex [position]].mFrame)) ;
+        const bool stays = (hole <= position)
+          ? ((hole < home) && (home <= position))
+          : ((hole < home) || (home <= position)) ;
+        if (!stays) {
+          mIndex [hole] = mIndex [position] ;
+          hole = position ;
+        }
+      }
+    }
+    mIndex [hole] = kNoSlot ;
+  }
+
+//······················································································································
+// Heap helpers
+//······················································································································
+
+  private: bool isMoreUrgent (const uint16_t inLeftSlot, const uint16_t inRightSlot) const {
+    const Slot & left = mSlots [inLeftSlot] ;
+    const Slot & right = mSlots [inRightSlot] ;
+    return (left.mKey < right.mKey)
+      || ((left.mKey == right.mKey) && (((int32_t) (left.mSequence - right.mSequence)) < 0)) ;
+  }
+
+  private: void siftUp (uint16_t inPosition, const uint16_t inSlotIndex) {
+    while (inPosition > 0) {
+      const uint16_t parent = (inPosition - 1) / 2 ;
+      if (!isMoreUrgent (inSlotIndex, mOrder [parent])) {
+        break ;
+      }
+      mOrder [inPosition] = mOrder [parent] ;
+      inPosition = parent ;
+    }
+    mOrder [inPosition] = inSlotIndex ;
+  }
+
+  private: void siftDown (const uint16_t inSlotIndex) { // Place inSlotIndex from root, heap has mCount entries
+    uint16_t position = 0 ;
+    bool loop = true ;
+    while (loop) {
+      uint16_t child = 2 * position + 1 ;
+      if (child >= mCount) {
+        loop = false ;
+      }else{
+        if (((child + 1) < mCount) && isMoreUrgent (mOrder [child + 1], mOrder [child])) {
+          child += 1 ;
+        }
+        loop = isMoreUrgent (mOrder [child], inSlotIndex) ;
+        if (loop) {
+          mOrder [position] = mOrder [child] ;
+          position = child ;
+        }
+      }
+    }
+    mOrder [position] = inSlotIndex ;
+  }
+
+//······················································································································
+// No copy
+//······················································································································
+
+  private: ACAN2517TransmitBuffer (const ACAN2517TransmitBuffer &) ;
+  private: ACAN2517TransmitBuffer & operator = (const ACAN2517TransmitBuffer &) ;
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,65 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Wait primitives for blocking receive and send of ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_WAIT_CLASS_DEFINED
+#define ACAN2517_WAIT_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <Arduino.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517Wait class
+//  signal is invoked by isr (by serviceDeferred in deferred work mode) when frames have been received or
+//  transmit room is available. wait is invoked by blocking receive and send; it returns when signal has been
+//  invoked since previous wait return (signal should be latched, as a binary semaphore), or after at most
+//  inMaxMicros µs. An early return is harmless: the caller checks its condition and waits again.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517Wait {
+
+//······················································································································
+//   DESTRUCTOR
+//······················································································································
+
+  public: virtual ~ ACAN2517Wait (void) {}
+
+//······················································································································
+//   SIGNAL / WAIT
+//······················································································································
+
+  public: virtual void signal (void) = 0 ;
+
+  public: virtual void wait (const uint32_t inMaxMicros) = 0 ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517WaitForEvent class (bare metal)
+//  On Cortex-M, signal sets the event register (SEV) and wait sleeps with WFE until an event or an interrupt
+//  (the system tick interrupt bounds the sleep duration). On other targets, wait calls yield.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517WaitForEvent : public ACAN2517Wait {
+
+  #if defined (__ARM_ARCH_6M__) || defined (__ARM_ARCH_7M__) || defined (__ARM_ARCH_7EM__)
+    public: virtual void signal (void) { __asm__ volatile ("sev" ::: "memory") ; }
+
+    public: virtual void wait (const uint32_t /* inMaxMicros */) { __asm__ volatile ("wfe" ::: "memory") ; }
+  #else
+    public: virtual void signal (void) {}
+
+    public: virtual void wait (const uint32_t /* inMaxMicros */) { yield () ; }
+  #endif
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
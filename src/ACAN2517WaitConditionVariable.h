@@ -0,0 +1,71 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// std::condition_variable based wait primitive for ACAN2517 CAN driver for MCP2517FD (CAN 2.0B mode)
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+// Intended for host testing, and for cores that provide std::condition_variable; it is not included by
+// ACAN2517.h.
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN2517_WAIT_CONDITION_VARIABLE_CLASS_DEFINED
+#define ACAN2517_WAIT_CONDITION_VARIABLE_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <ACAN2517Wait.h>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACAN2517WaitConditionVariable class
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACAN2517WaitConditionVariable : public ACAN2517Wait {
+
+//······················································································································
+//   CONSTRUCTOR
+//······················································································································
+
+  public: ACAN2517WaitConditionVariable (void) {}
+
+//······················································································································
+//   SIGNAL / WAIT
+//······················································································································
+
+  public: virtual void signal (void) {
+    { std::lock_guard <std::mutex> guard (mMutex) ;
+      mSignaled = true ;
+    }
+    mCondition.notify_all () ;
+  }
+
+  public: virtual void wait (const uint32_t inMaxMicros) {
+    std::unique_lock <std::mutex> guard (mMutex) ;
+    mCondition.wait_for (guard, std::chrono::microseconds (inMaxMicros), [this] { return mSignaled ; }) ;
+    mSignaled = false ;
+  }
+
+//······················································································································
+//   PRIVATE PROPERTIES
+//······················································································································
+
+  private: std::mutex mMutex ;
+  private: std::condition_variable mCondition ;
+  private: bool mSignaled = false ;
+
+//······················································································································
+//   NO COPY
+//······················································································································
+
+  private: ACAN2517WaitConditionVariable (const ACAN2517WaitConditionVariable &) ;
+  private: ACAN2517WaitConditionVariable & operator = (const ACAN2517WaitConditionVariable &) ;
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
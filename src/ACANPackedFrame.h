@@ -0,0 +1,93 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Packed frame representation, for driver buffers
+// by Pierre Molinaro
+// https://github.com/pierremolinaro/acan2517
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN_PACKED_FRAME_CLASS_DEFINED
+#define ACAN_PACKED_FRAME_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//  ACANPackedFrame class
+//  A frame in 14 bytes (CANMessage: 16 bytes), with 16-bit alignment so that no padding is added in arrays.
+//  Layout follows the MCP2517FD message object (DS20005678A, page 42):
+//    - mWords [0 ... 1]: T0 / R0 word (identifier);
+//    - mWords [2]: low half of T1 / R1 word: DLC (bits 3-0), IDE (bit 4), RTR (bit 5), FILHIT (bits 15-11);
+//    - mWords [3 ... 6]: data.
+//  So the receive isr stores controller words without decoding them; CANMessage fields are extracted by
+//  unpack.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+class ACANPackedFrame {
+
+//······················································································································
+//   CONTROLLER WORDS
+//······················································································································
+
+  public: inline void setObjectWords (const uint32_t inIdentifierWord,
+                                      const uint32_t inFlagWord,
+                                      const uint32_t inData0,
+                                      const uint32_t inData1) {
+    mWords [0] = (uint16_t) inIdentifierWord ;
+    mWords [1] = (uint16_t) (inIdentifierWord >> 16) ;
+    mWords [2] = (uint16_t) inFlagWord ;
+    mWords [3] = (uint16_t) inData0 ;
+    mWords [4] = (uint16_t) (inData0 >> 16) ;
+    mWords [5] = (uint16_t) inData1 ;
+    mWords [6] = (uint16_t) (inData1 >> 16) ;
+  }
+
+//······················································································································
+//   PACK / UNPACK
+//······················································································································
+
+  public: inline void pack (const CANMessage & inMessage) {
+    uint32_t flags = inMessage.len & 0x0F ;
+    if (inMessage.ext) {
+      flags |= 1 << 4 ;
+    }
+    if (inMessage.rtr) {
+      flags |= 1 << 5 ;
+    }
+    flags |= ((uint32_t) (inMessage.idx & 0x1F)) << 11 ;
+    setObjectWords (inMessage.id, flags, inMessage.data32 [0], inMessage.data32 [1]) ;
+  }
+
+  public: inline void unpack (CANMessage & outMessage) const {
+    outMessage.id = identifier () ;
+    outMessage.ext = isExtended () ;
+    outMessage.rtr = isRemote () ;
+    outMessage.len = mWords [2] & 0x0F ;
+    outMessage.idx = (uint8_t) (mWords [2] >> 11) ;
+    outMessage.data32 [0] = mWords [3] | (((uint32_t) mWords [4]) << 16) ;
+    outMessage.data32 [1] = mWords [5] | (((uint32_t) mWords [6]) << 16) ;
+  }
+
+//······················································································································
+//   ACCESSORS
+//······················································································································
+
+  public: inline uint32_t identifier (void) const { return mWords [0] | (((uint32_t) mWords [1]) << 16) ; }
+
+  public: inline bool isExtended (void) const { return (mWords [2] & (1 << 4)) != 0 ; }
+
+  public: inline bool isRemote (void) const { return (mWords [2] & (1 << 5)) != 0 ; }
+
+  public: inline uint8_t filterIndex (void) const { return (uint8_t) (mWords [2] >> 11) ; }
+
+//······················································································································
+//   PRIVATE PROPERTY
+//······················································································································
+
+  private: uint16_t mWords [7] ;
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif
@@ -0,0 +1,150 @@
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+// Compile time signal descriptors for CANMessage payloads
+// by Pierre Molinaro
+//
+// A signal is declared by its start bit, length, byte order and signedness; extraction and insertion
+// compile down to a shift and a mask on the 32-bit half or on the 64-bit payload that contains it.
+// The extras/dbc2acan.py script generates descriptors from a DBC file.
+//
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#ifndef ACAN_SIGNAL_CLASS_DEFINED
+#define ACAN_SIGNAL_CLASS_DEFINED
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#include <CANMessage.h>
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   BYTE ORDER
+//   kIntel: DBC "@1", start bit is the least significant bit (bit n is bit n % 8 of data [n / 8]).
+//   kMotorola: DBC "@0", start bit is the most significant bit, in the same bit numbering.
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+typedef enum {kIntel, kMotorola} tSignalByteOrder ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   RAW VALUE TYPES (uint32_t / int32_t up to 32 bits, uint64_t / int64_t above)
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+template <bool WIDE, bool IS_SIGNED> class ACANSignalRawType { public: typedef uint32_t Type ; } ;
+template <> class ACANSignalRawType <false, true> { public: typedef int32_t Type ; } ;
+template <> class ACANSignalRawType <true, false> { public: typedef uint64_t Type ; } ;
+template <> class ACANSignalRawType <true, true> { public: typedef int64_t Type ; } ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+//   ACANSignal class
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+template <uint8_t START_BIT, uint8_t LENGTH, tSignalByteOrder SIGNAL_ORDER, bool IS_SIGNED>
+class ACANSignal {
+
+//······················································································································
+//   TYPES
+//······················································································································
+
+  public: typedef typename ACANSignalRawType <(LENGTH > 32), IS_SIGNED>::Type RawType ;
+  private: typedef typename ACANSignalRawType <(LENGTH > 32), false>::Type UnsignedType ;
+
+//······················································································································
+//   LAYOUT (computed at compile time)
+//   For kMotorola, positions are counted in the big endian 64-bit payload value (bit 63 is the most
+//   significant bit of data [0]).
+//······················································································································
+
+  private: static const uint8_t kMotorolaMSB = 63 - (8 * (START_BIT / 8) + (7 - START_BIT % 8)) ;
+  private: static const uint8_t kShift = (SIGNAL_ORDER == kIntel) ? START_BIT : (kMotorolaMSB + 1 - LENGTH) ;
+  private: static const uint8_t kLastBit = kShift + LENGTH - 1 ;
+  private: static const bool kInOneWord = (kShift / 32) == (kLastBit / 32) ;
+
+//--- Word index for 32-bit access: little endian payload for kIntel, big endian payload for kMotorola
+  private: static const uint8_t kWordIndex = (SIGNAL_ORDER == kIntel) ? (kShift / 32) : (1 - kShift / 32) ;
+
+  public: static const uint64_t kMask = (LENGTH == 64) ? ~ (uint64_t) 0 : ((((uint64_t) 1) << LENGTH) - 1) ;
+
+  static_assert ((LENGTH >= 1) && (LENGTH <= 64), "signal length should be 1 ... 64") ;
+  static_assert (START_BIT < 64, "signal start bit should be 0 ... 63") ;
+  static_assert ((SIGNAL_ORDER == kIntel) ? ((START_BIT + LENGTH) <= 64) : (kMotorolaMSB + 1 >= LENGTH),
+                 "signal does not fit in 8 bytes") ;
+
+//······················································································································
+//   PAYLOAD ACCESS (payload is read as a little endian value, byte swapped for kMotorola)
+//······················································································································
+
+  private: static uint32_t word (const CANMessage & inMessage) {
+    #if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+      const uint32_t v = __builtin_bswap32 (inMessage.data32 [kWordIndex]) ;
+    #else
+      const uint32_t v = inMessage.data32 [kWordIndex] ;
+    #endif
+    return (SIGNAL_ORDER == kIntel) ? v : __builtin_bswap32 (v) ;
+  }
+
+  private: static void setWord (CANMessage & ioMessage, const uint32_t inValue) {
+    const uint32_t v = (SIGNAL_ORDER == kIntel) ? inValue : __builtin_bswap32 (inValue) ;
+    #if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+      ioMessage.data32 [kWordIndex] = __builtin_bswap32 (v) ;
+    #else
+      ioMessage.data32 [kWordIndex] = v ;
+    #endif
+  }
+
+  private: static uint64_t payload (const CANMessage & inMessage) {
+    #if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+      const uint64_t v = __builtin_bswap64 (inMessage.data64) ;
+    #else
+      const uint64_t v = inMessage.data64 ;
+    #endif
+    return (SIGNAL_ORDER == kIntel) ? v : __builtin_bswap64 (v) ;
+  }
+
+  private: static void setPayload (CANMessage & ioMessage, const uint64_t inValue) {
+    const uint64_t v = (SIGNAL_ORDER == kIntel) ? inValue : __builtin_bswap64 (inValue) ;
+    #if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+      ioMessage.data64 = __builtin_bswap64 (v) ;
+    #else
+      ioMessage.data64 = v ;
+    #endif
+  }
+
+//······················································································································
+//   EXTRACTION
+//······················································································································
+
+  public: static RawType rawValue (const CANMessage & inMessage) {
+    UnsignedType v ;
+    if (kInOneWord) {
+      v = (UnsignedType) ((word (inMessage) >> (kShift % 32)) & (uint32_t) kMask) ;
+    }else{
+      v = (UnsignedType) ((payload (inMessage) >> kShift) & kMask) ;
+    }
+    if (IS_SIGNED && (LENGTH < (8 * sizeof (UnsignedType)))) { // Sign extension
+      const UnsignedType signBit = ((UnsignedType) 1) << ((LENGTH - 1) % (8 * sizeof (UnsignedType))) ;
+      v = (v ^ signBit) - signBit ;
+    }
+    return (RawType) v ;
+  }
+
+//······················································································································
+//   INSERTION (other bits of payload are unchanged)
+//······················································································································
+
+  public: static void setRawValue (CANMessage & ioMessage, const RawType inValue) {
+    if (kInOneWord) {
+      const uint32_t mask = ((uint32_t) kMask) << (kShift % 32) ;
+      const uint32_t bits = (((uint32_t) inValue) << (kShift % 32)) & mask ;
+      setWord (ioMessage, (word (ioMessage) & ~ mask) | bits) ;
+    }else{
+      const uint64_t mask = kMask << kShift ;
+      const uint64_t bits = (((uint64_t) (UnsignedType) inValue) << kShift) & mask ;
+      setPayload (ioMessage, (payload (ioMessage) & ~ mask) | bits) ;
+    }
+  }
+
+//······················································································································
+
+} ;
+
+//——————————————————————————————————————————————————————————————————————————————————————————————————————————————————————
+
+#endif